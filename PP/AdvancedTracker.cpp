@@ -1,9 +1,19 @@
 #include "AdvancedTracker.h"
+#include "activity_file.h"
+#include "backup_set.h"
+#include "buffered_writer.h"
+#include "field_parser.h"
+#include "file_lock.h"
+#include "fixed_point.h"
+#include "tombstones.h"
+#include "io_stats.h"
+#include "number_format.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <unordered_set>
 #include <map>
 #include <cmath>
 
@@ -13,50 +23,45 @@ AdvancedTracker::AdvancedTracker()
     loadGoals();
 }
 
-// Load activities from CSV
+// Load activities from CSV, then replay the journal of newer additions
 void AdvancedTracker::loadActivities()
 {
-    std::ifstream file(ACTIVITIES_FILE);
-    if (!file.is_open())
-        return;
-
-    std::string line;
-    std::getline(file, line); // Skip header if exists
-
-    while (std::getline(file, line))
+    auto onInvalid = [](const char *lineBegin, const char *lineEnd)
     {
-        if (line.empty())
-            continue;
-
-        std::stringstream ss(line);
-        std::string cell;
-        std::vector<std::string> row;
-
-        while (std::getline(ss, cell, ','))
-        {
-            row.push_back(cell);
-        }
-
-        if (row.size() >= 5)
-        {
-            Activity activity;
-            activity.type = stringToActivityType(row[0]);
-            activity.date = row[1];
-            activity.duration = std::stod(row[2]);
-            activity.distance = std::stod(row[3]);
-            activity.repetitions = std::stoi(row[4]);
-            activities.push_back(activity);
-        }
-    }
-    file.close();
+        std::cerr << "Skipping malformed line: " << std::string(lineBegin, lineEnd) << "\n";
+    };
+    auto onDamaged = [this](uint64_t firstByte, uint64_t endByte, size_t rows)
+    {
+        std::cerr << "Could not read " << rows << " damaged rows at bytes " << firstByte << "-" << endByte
+                  << " of " << ACTIVITIES_FILE << "\n";
+    };
+    loadActivitiesFromFiles(ACTIVITIES_FILE, NAME_DIALECT, activities, onInvalid, onDamaged);
 }
 
 // Load goals from CSV
 void AdvancedTracker::loadGoals()
 {
-    std::ifstream file(GOALS_FILE);
+    goals.clear();
+    deadGoalRows = 0;
+    nextGoalId = loadNextId(GOALS_FILE); // IDs compaction dropped are not handed out again
+
+    // Deleted goals stay in the file until it is rewritten; the file and
+    // its tombstones are opened as one version (see file_lock.h)
+    std::ifstream file;
+    std::unordered_set<int> dead;
+    openPublishedVersion(GOALS_FILE, [&]()
+    {
+        file.close();
+        file.clear();
+        file.open(GOALS_FILE);
+        dead = loadTombstones(tombstonePathFor(GOALS_FILE));
+    });
     if (!file.is_open())
+    {
+        indexRecordIds(goals, goalPositions);
         return;
+    }
+    int position = 0;
 
     std::string line;
     std::getline(file, line); // Skip header if exists
@@ -66,50 +71,77 @@ void AdvancedTracker::loadGoals()
         if (line.empty())
             continue;
 
-        std::stringstream ss(line);
-        std::string cell;
-        std::vector<std::string> row;
+        const char *fieldBegin[8];
+        const char *fieldEnd[8];
+        size_t fieldCount = splitFields(line.data(), line.data() + line.size(), fieldBegin, fieldEnd, 8);
+        if (fieldCount < 7)
+            continue;
+
+        Goal goal;
+        goal.type = stringToActivityType(std::string(fieldBegin[0], fieldEnd[0]));
+        goal.description.assign(fieldBegin[1], fieldEnd[1]);
+        goal.deadline = Date::parse(fieldBegin[2], fieldEnd[2]);
+        if (!goal.deadline.isValid() ||
+            parseDistance(fieldBegin[3], fieldEnd[3], goal.targetDistance) != ParseStatus::OK ||
+            parseDuration(fieldBegin[4], fieldEnd[4], goal.targetDuration) != ParseStatus::OK ||
+            parseInt(fieldBegin[5], fieldEnd[5], goal.targetReps) != ParseStatus::OK)
+        {
+            std::cerr << "Skipping malformed line: " << line << "\n";
+            continue;
+        }
+        std::string achieved(fieldBegin[6], fieldEnd[6]);
+        goal.achieved = (achieved == "1" || achieved == "true");
 
-        while (std::getline(ss, cell, ','))
+        // Files from before stable IDs number goals by position
+        goal.id = position;
+        if (fieldCount == 8 && (parseInt(fieldBegin[7], fieldEnd[7], goal.id) != ParseStatus::OK || goal.id < 0))
         {
-            row.push_back(cell);
+            std::cerr << "Skipping malformed line: " << line << "\n";
+            continue;
         }
+        ++position;
+        nextGoalId = std::max(nextGoalId, goal.id + 1);
 
-        if (row.size() >= 7)
+        if (dead.count(goal.id) != 0)
         {
-            Goal goal;
-            goal.type = stringToActivityType(row[0]);
-            goal.description = row[1];
-            goal.deadline = row[2];
-            goal.targetDistance = std::stod(row[3]);
-            goal.targetDuration = std::stod(row[4]);
-            goal.targetReps = std::stoi(row[5]);
-            goal.achieved = (row[6] == "1" || row[6] == "true");
-            goals.push_back(goal);
+            ++deadGoalRows;
+            continue;
         }
+        goals.push_back(goal);
     }
     file.close();
+    indexRecordIds(goals, goalPositions);
 }
 
 // Save goals to CSV
 void AdvancedTracker::saveGoals()
 {
-    std::ofstream file(GOALS_FILE);
-    if (!file.is_open())
+    BufferedWriter file;
+    if (!file.open(GOALS_FILE))
         return;
 
-    file << "ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved\n";
+    file.write("ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved,Id\n");
     for (const auto &goal : goals)
     {
-        file << activityTypeToString(goal.type) << ","
-             << goal.description << ","
-             << goal.deadline << ","
-             << goal.targetDistance << ","
-             << goal.targetDuration << ","
-             << goal.targetReps << ","
-             << (goal.achieved ? "1" : "0") << "\n";
+        file.write(activityTypeToString(goal.type));
+        file.put(',');
+        file.write(goal.description);
+        file.put(',');
+        file.write(goal.deadline.toString());
+        file.put(',');
+        file.writeMeasure(goal.targetDistance, DISTANCE_DECIMALS);
+        file.put(',');
+        file.writeMeasure(goal.targetDuration, DURATION_DECIMALS);
+        file.put(',');
+        file.writeInt(goal.targetReps);
+        file.put(',');
+        file.put(goal.achieved ? '1' : '0');
+        file.put(',');
+        file.writeInt(goal.id);
+        file.put('\n');
     }
-    file.close();
+    // Only live goals were written, so the tombstones go with the old file
+    commitCompactedFile(GOALS_FILE, file, deadGoalRows, nextGoalId);
 }
 
 // View general statistics
@@ -224,9 +256,10 @@ void AdvancedTracker::filterStatistics(int activityId, int goalId)
               << totalDuration / filteredActivities.size() << " minutes\n";
 
     // Show goal comparison if goal exists
-    if (goalId >= 0 && goalId < static_cast<int>(goals.size()))
+    int goalIndex = findGoal(goalId);
+    if (goalIndex >= 0)
     {
-        const auto &goal = goals[goalId];
+        const auto &goal = goals[goalIndex];
         std::cout << "\n--- Goal Comparison ---\n";
         std::cout << "Goal: " << goal.description << "\n";
         std::cout << "Deadline: " << goal.deadline << "\n";
@@ -257,13 +290,14 @@ void AdvancedTracker::filterStatistics(int activityId, int goalId)
 // View progress for a specific goal with ASCII chart
 void AdvancedTracker::viewProgress(int goalId)
 {
-    if (goalId < 0 || goalId >= static_cast<int>(goals.size()))
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cout << "Goal ID " << goalId << " not found!\n";
         return;
     }
 
-    const auto &goal = goals[goalId];
+    const auto &goal = goals[index];
     std::cout << "=== Progress for Goal " << goalId << " ===\n";
     std::cout << "Goal: " << goal.description << "\n";
     std::cout << "Activity Type: " << activityTypeToString(goal.type) << "\n";
@@ -353,74 +387,174 @@ void AdvancedTracker::displayProgressBar(const std::string &label, double percen
     std::cout << "] " << std::fixed << std::setprecision(1) << percentage << "%\n";
 }
 
-// Delete goal by ID
+// Delete goal by ID: a tombstone hides the row, and the goals file is only
+// rewritten once enough of it is dead. Other goals keep their IDs.
 void AdvancedTracker::deleteGoal(int goalId)
 {
-    if (goalId < 0 || goalId >= static_cast<int>(goals.size()))
+    if (!lockGoalsForWrite())
+        return;
+
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cout << "Goal ID " << goalId << " not found!\n";
         return;
     }
 
-    std::string description = goals[goalId].description;
-    goals.erase(goals.begin() + goalId);
-    saveGoals();
+    std::string description = goals[index].description;
+    bool compactionDue = false;
+    if (!deleteRecordWithTombstone(GOALS_FILE, goals, goalPositions, index, deadGoalRows, compactionDue))
+    {
+        std::cout << "Could not record deletion of goal " << goalId << "\n";
+        return;
+    }
+    if (compactionDue)
+        saveGoals();
 
     std::cout << "Goal '" << description << "' deleted successfully!\n";
-    std::cout << "Note: Goal IDs may have shifted. Please check updated goal list.\n";
 }
 
-// Backup data to specified file
-void AdvancedTracker::backup(const std::string &filePath)
+// Add a backup to the backup set at filePath; only activities added and
+// goals changed since the last backup are written (see backup_set.h)
+void AdvancedTracker::backup(const std::string &filePath, bool full)
 {
     std::cout << "=== Backing up data to: " << filePath << " ===\n";
 
-    std::ofstream backupFile(filePath);
-    if (!backupFile.is_open())
+    std::vector<BackupGoal> goalRows;
+    goalRows.reserve(goals.size());
+    for (const auto &goal : goals)
+    {
+        std::ostringstream row;
+        writeGoalRecord(row, goal);
+        BackupGoal goalRow = {goal.id, row.str()};
+        goalRows.push_back(goalRow);
+    }
+
+    BackupSummary summary;
+    if (!writeBackup(filePath, ACTIVITIES_FILE, NAME_DIALECT, goalRows, full, summary))
     {
-        std::cout << "Error: Could not create backup file!\n";
+        std::cout << "Error: Could not write backup!\n";
         return;
     }
 
-    // Write backup header
-    backupFile << "=== Sports Tracker Backup ===\n";
-    backupFile << "Generated on: " << getCurrentDate() << "\n\n";
+    std::cout << (summary.number == 0 ? "Full" : "Incremental") << " backup " << summary.number << " completed successfully!\n";
+    std::cout << "Activities backed up: " << summary.activities << "\n";
+    std::cout << "Goals backed up: " << summary.goals << "\n";
+    std::cout << "Goal deletions backed up: " << summary.deletedGoals << "\n";
+}
 
-    // Backup activities
-    backupFile << "--- ACTIVITIES ---\n";
-    backupFile << "ActivityType,Date,Duration,Distance,Repetitions\n";
-    for (const auto &activity : activities)
+// Replace all data with the full backup at filePath plus its incrementals
+void AdvancedTracker::restore(const std::string &filePath)
+{
+    std::cout << "=== Restoring data from: " << filePath << " ===\n";
+
+    FileLock activitiesLock;
+    FileLock goalsLock;
+    if (!activitiesLock.lock(writerLockPathFor(ACTIVITIES_FILE), LockMode::EXCLUSIVE) ||
+        !goalsLock.lock(writerLockPathFor(GOALS_FILE), LockMode::EXCLUSIVE))
     {
-        backupFile << activityTypeToString(activity.type) << ","
-                   << activity.date << ","
-                   << activity.duration << ","
-                   << activity.distance << ","
-                   << activity.repetitions << "\n";
+        std::cout << "Error: Could not lock the data files!\n";
+        return;
+    }
+
+    // Nothing is replaced unless the whole chain checks out
+    std::vector<Activity> restored;
+    bool rowsValid = true;
+    std::vector<BackupGoal> goalRows;
+    BackupSummary summary;
+    bool chainValid = readBackup(filePath, [&restored, &rowsValid](const char *begin, const char *end)
+    {
+        CsvDialect dialect = detectDialect(begin, end, NAME_DIALECT);
+        dialect.hasHeader = false;
+        forEachActivityRow(begin, end, dialect, [&restored](const ActivityRow &row)
+        {
+            restored.push_back(activityFromRow<Activity>(row));
+            return true;
+        },
+        [&rowsValid](const char *, const char *)
+        {
+            rowsValid = false;
+        });
+    }, goalRows, summary);
+    if (!chainValid || !rowsValid)
+    {
+        std::cout << "Error: Backup is missing or damaged; nothing was restored!\n";
+        return;
+    }
+
+    // The restored files hold everything, so the journal and tombstones go;
+    // activities keep the live file's format
+    if (!saveActivitiesToFile(ACTIVITIES_FILE, NAME_DIALECT, restored))
+    {
+        std::cout << "Error: Could not write " << ACTIVITIES_FILE << "!\n";
+        return;
+    }
+    BufferedWriter goalsFile;
+    if (!goalsFile.open(GOALS_FILE))
+    {
+        std::cout << "Error: Could not open " << GOALS_FILE << "!\n";
+        return;
+    }
+    goalsFile.write("ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved,Id\n");
+    for (const auto &goalRow : goalRows)
+    {
+        goalsFile.write(goalRow.row);
+        goalsFile.put('\n');
     }
 
-    // Backup goals
-    backupFile << "\n--- GOALS ---\n";
-    backupFile << "ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved\n";
-    for (const auto &goal : goals)
     {
-        backupFile << activityTypeToString(goal.type) << ","
-                   << goal.description << ","
-                   << goal.deadline << ","
-                   << goal.targetDistance << ","
-                   << goal.targetDuration << ","
-                   << goal.targetReps << ","
-                   << (goal.achieved ? "1" : "0") << "\n";
+        FileLock publish;
+        publish.lock(publishLockPathFor(GOALS_FILE), LockMode::EXCLUSIVE);
+        if (!goalsFile.close() || !removeTombstones(tombstonePathFor(GOALS_FILE)))
+        {
+            std::cout << "Error: Could not write " << GOALS_FILE << "!\n";
+            return;
+        }
     }
 
-    backupFile.close();
+    std::cout << "Restore completed successfully from " << summary.backups << " backup(s)!\n";
+    std::cout << "Activities restored: " << summary.activities << "\n";
+    std::cout << "Goals restored: " << summary.goals << "\n";
+}
 
-    std::cout << "Backup completed successfully!\n";
-    std::cout << "Activities backed up: " << activities.size() << "\n";
-    std::cout << "Goals backed up: " << goals.size() << "\n";
+// One goal row as saveGoals writes it, for backups
+void AdvancedTracker::writeGoalRecord(std::ostream &out, const Goal &goal)
+{
+    char number[NUMBER_BUFFER_BYTES];
+    out << activityTypeToString(goal.type) << ',' << goal.description << ',' << goal.deadline << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(goal.targetDistance, DISTANCE_DECIMALS, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(goal.targetDuration, DURATION_DECIMALS, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatInt(goal.targetReps, number)));
+    out << ',' << (goal.achieved ? '1' : '0') << ',';
+    out.write(number, static_cast<std::streamsize>(formatInt(goal.id, number)));
 }
 
 // Simple date function (in real app, would use proper date library)
 std::string AdvancedTracker::getCurrentDate()
 {
     return "2024-01-01"; // Placeholder - in real app would get actual date
-}
\ No newline at end of file
+}
+
+// Position of the goal with the given ID in goals, or -1, in constant time
+int AdvancedTracker::findGoal(int goalId)
+{
+    auto found = goalPositions.find(goalId);
+    return found == goalPositions.end() ? -1 : static_cast<int>(found->second);
+}
+
+// Become the only writer of goals until this object goes away. Goals were
+// loaded before the lock and may be stale, so they are loaded again.
+bool AdvancedTracker::lockGoalsForWrite()
+{
+    if (goalsWriteLock.isLocked())
+        return true;
+    if (!goalsWriteLock.lock(writerLockPathFor(GOALS_FILE), LockMode::EXCLUSIVE))
+    {
+        std::cerr << "Could not lock " << GOALS_FILE << " for writing\n";
+        return false;
+    }
+    loadGoals();
+    return true;
+}
@@ -1,9 +1,13 @@
 #ifndef ADVANCED_TRACKER_H
 #define ADVANCED_TRACKER_H
 
+#include <cstddef>
 #include <vector>
+#include <unordered_map>
 #include <string>
+#include <iosfwd>
 #include "activity.h"
+#include "file_lock.h"
 
 class AdvancedTracker
 {
@@ -12,6 +16,14 @@ private:
     std::vector<Goal> goals;
     const std::string ACTIVITIES_FILE = "activities_cpp.csv";
     const std::string GOALS_FILE = "activities_goals_cpp.csv";
+    size_t deadGoalRows = 0; // Deleted goals still in the goals file
+    int nextGoalId = 0;
+    std::unordered_map<int, size_t> goalPositions; // Goal ID -> position in goals
+    FileLock goalsWriteLock;
+
+    int findGoal(int goalId);
+    bool lockGoalsForWrite();
+    void writeGoalRecord(std::ostream &out, const Goal &goal);
 
     // Helper method for progress bars
     void displayProgressBar(const std::string &label, double percentage);
@@ -36,7 +48,8 @@ public:
     void deleteGoal(int goalId);
 
     // Backup functionality
-    void backup(const std::string &filePath);
+    void backup(const std::string &filePath, bool full = false);
+    void restore(const std::string &filePath);
 };
 
 #endif // ADVANCED_TRACKER_H
\ No newline at end of file
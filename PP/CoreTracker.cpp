@@ -1,21 +1,61 @@
 #include "CoreTracker.h"
+#include "activity_file.h"
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "field_parser.h"
+#include "file_lock.h"
+#include "fixed_point.h"
+#include "tombstones.h"
+#include "journal.h"
+#include "io_stats.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <unordered_set>
 #include "Color.h"
 
+namespace
+{
+    // Stream the activities file and its journal through the shared storage
+    // reader, handing each row to visitor as an Activity until it returns false
+    template <typename Visitor>
+    bool forEachActivity(const std::string &path, Visitor visitor)
+    {
+        return forEachActivityInFiles(path, NAME_DIALECT, [&visitor](const ActivityRow &row)
+        {
+            Activity activity(static_cast<ActivityType>(row.type), row.date,
+                              row.duration, row.distance, row.repetitions);
+            return visitor(activity);
+        },
+        [](const char *lineBegin, const char *lineEnd)
+        {
+            std::cerr << Color::RED << "Skipping malformed line: " << std::string(lineBegin, lineEnd) << Color::RESET << "\n";
+        });
+    }
+}
+
+// Activities are loaded on first use; listing them streams the files instead
 CoreTracker::CoreTracker()
 {
-    loadActivities();
     loadGoals();
 }
 
+// New activities already sit in the journal, so only goals can be pending
 CoreTracker::~CoreTracker()
 {
-    saveActivities();
-    saveGoals();
+    flush();
+}
+
+// Save goals only if a command changed them
+void CoreTracker::flush()
+{
+    if (goalsDirty)
+    {
+        saveGoals();
+    }
 }
 
 // Convert ActivityType to string with color
@@ -38,69 +78,87 @@ std::string CoreTracker::colorActivityType(ActivityType type)
     }
 }
 
-// Load activities from CSV
+// Load activities from CSV, then replay the journal of newer additions
 void CoreTracker::loadActivities()
 {
-    std::ifstream file(ACTIVITIES_FILE);
-    if (!file.is_open())
-        return;
-
-    std::string line;
-    std::getline(file, line); // Skip header if exists
-
-    while (std::getline(file, line))
+    auto onInvalid = [](const char *lineBegin, const char *lineEnd)
     {
-        if (line.empty())
-            continue;
-
-        std::stringstream ss(line);
-        std::string cell;
-        std::vector<std::string> row;
+        std::cerr << Color::RED << "Skipping malformed line: " << std::string(lineBegin, lineEnd) << Color::RESET << "\n";
+    };
+    auto onDamaged = [this](uint64_t firstByte, uint64_t endByte, size_t rows)
+    {
+        std::cerr << Color::RED << "Could not read " << rows << " damaged rows at bytes " << firstByte << "-" << endByte
+                  << " of " << ACTIVITIES_FILE << Color::RESET << "\n";
+    };
+    loadActivitiesFromFiles(ACTIVITIES_FILE, NAME_DIALECT, activities, onInvalid, onDamaged);
+    activitiesLoaded = true;
+}
 
-        while (std::getline(ss, cell, ','))
-        {
-            row.push_back(cell);
-        }
+// Load activities the first time a command needs them
+void CoreTracker::ensureActivitiesLoaded()
+{
+    if (!activitiesLoaded)
+        loadActivities();
+}
 
-        if (row.size() >= 5)
-        {
-            Activity activity;
-            activity.type = stringToActivityType(row[0]);
-            activity.date = row[1];
-            activity.duration = std::stod(row[2]);
-            activity.distance = std::stod(row[3]);
-            activity.repetitions = std::stoi(row[4]);
-            activities.push_back(activity);
-        }
-    }
-    file.close();
+// Save every activity to the CSV and drop the journal it absorbed; a file
+// converted to the compressed format stays compressed (see activity_file.h)
+bool CoreTracker::saveActivities()
+{
+    ensureActivitiesLoaded();
+    return saveActivitiesToFile(ACTIVITIES_FILE, NAME_DIALECT, activities);
 }
 
-// Save activities to CSV
-void CoreTracker::saveActivities()
+// Write one activity as a CSV record, without a line ending
+void CoreTracker::writeActivityRecord(std::ostream &out, const Activity &activity)
 {
-    std::ofstream file(ACTIVITIES_FILE);
-    if (!file.is_open())
-        return;
+    writeActivity(out, NAME_DIALECT, activity);
+}
 
-    file << "ActivityType,Date,Duration,Distance,Repetitions\n";
-    for (const auto &activity : activities)
+// Fold the journal into the main activities file
+bool CoreTracker::compactActivities()
+{
+    if (!lockActivitiesForWrite())
+        return false;
+    if (hasDamagedRanges(ACTIVITIES_FILE))
     {
-        file << activityTypeToString(activity.type) << ","
-             << activity.date << ","
-             << activity.duration << ","
-             << activity.distance << ","
-             << activity.repetitions << "\n";
+        std::cout << Color::RED << ACTIVITIES_FILE << " is damaged; it is not compacted until it is restored from a backup"
+                  << Color::RESET << "\n";
+        return false;
     }
-    file.close();
+    ensureActivitiesLoaded();
+    if (!saveActivities())
+    {
+        std::cout << Color::RED << "Could not write " << ACTIVITIES_FILE << Color::RESET << "\n";
+        return false;
+    }
+    return true;
 }
 
 // Load goals from CSV
 void CoreTracker::loadGoals()
 {
-    std::ifstream file(GOALS_FILE);
+    goals.clear();
+    deadGoalRows = 0;
+    nextGoalId = loadNextId(GOALS_FILE); // IDs compaction dropped are not handed out again
+
+    // Deleted goals stay in the file until it is rewritten; the file and
+    // its tombstones are opened as one version (see file_lock.h)
+    std::ifstream file;
+    std::unordered_set<int> dead;
+    openPublishedVersion(GOALS_FILE, [&]()
+    {
+        file.close();
+        file.clear();
+        file.open(GOALS_FILE);
+        dead = loadTombstones(tombstonePathFor(GOALS_FILE));
+    });
     if (!file.is_open())
+    {
+        indexRecordIds(goals, goalPositions);
         return;
+    }
+    int position = 0;
 
     std::string line;
     std::getline(file, line); // Skip header if exists
@@ -110,50 +168,79 @@ void CoreTracker::loadGoals()
         if (line.empty())
             continue;
 
-        std::stringstream ss(line);
-        std::string cell;
-        std::vector<std::string> row;
+        const char *fieldBegin[8];
+        const char *fieldEnd[8];
+        size_t fieldCount = splitFields(line.data(), line.data() + line.size(), fieldBegin, fieldEnd, 8);
+        if (fieldCount < 7)
+            continue;
 
-        while (std::getline(ss, cell, ','))
+        Goal goal;
+        goal.type = stringToActivityType(std::string(fieldBegin[0], fieldEnd[0]));
+        goal.description.assign(fieldBegin[1], fieldEnd[1]);
+        goal.deadline = Date::parse(fieldBegin[2], fieldEnd[2]);
+        if (!goal.deadline.isValid() ||
+            parseDistance(fieldBegin[3], fieldEnd[3], goal.targetDistance) != ParseStatus::OK ||
+            parseDuration(fieldBegin[4], fieldEnd[4], goal.targetDuration) != ParseStatus::OK ||
+            parseInt(fieldBegin[5], fieldEnd[5], goal.targetReps) != ParseStatus::OK)
         {
-            row.push_back(cell);
+            std::cerr << Color::RED << "Skipping malformed line: " << line << Color::RESET << "\n";
+            continue;
         }
+        std::string achieved(fieldBegin[6], fieldEnd[6]);
+        goal.achieved = (achieved == "1" || achieved == "true");
 
-        if (row.size() >= 7)
+        // Files from before stable IDs number goals by position
+        goal.id = position;
+        if (fieldCount == 8 && (parseInt(fieldBegin[7], fieldEnd[7], goal.id) != ParseStatus::OK || goal.id < 0))
         {
-            Goal goal;
-            goal.type = stringToActivityType(row[0]);
-            goal.description = row[1];
-            goal.deadline = row[2];
-            goal.targetDistance = std::stod(row[3]);
-            goal.targetDuration = std::stod(row[4]);
-            goal.targetReps = std::stoi(row[5]);
-            goal.achieved = (row[6] == "1" || row[6] == "true");
-            goals.push_back(goal);
+            std::cerr << Color::RED << "Skipping malformed line: " << line << Color::RESET << "\n";
+            continue;
         }
+        ++position;
+        nextGoalId = std::max(nextGoalId, goal.id + 1);
+
+        if (dead.count(goal.id) != 0)
+        {
+            ++deadGoalRows;
+            continue;
+        }
+        goals.push_back(goal);
     }
     file.close();
+    indexRecordIds(goals, goalPositions);
 }
 
 // Save goals to CSV
 void CoreTracker::saveGoals()
 {
-    std::ofstream file(GOALS_FILE);
-    if (!file.is_open())
+    BufferedWriter file;
+    if (!file.open(GOALS_FILE))
         return;
 
-    file << "ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved\n";
+    file.write("ActivityType,Description,Deadline,TargetDistance,TargetDuration,TargetReps,Achieved,Id\n");
     for (const auto &goal : goals)
     {
-        file << activityTypeToString(goal.type) << ","
-             << goal.description << ","
-             << goal.deadline << ","
-             << goal.targetDistance << ","
-             << goal.targetDuration << ","
-             << goal.targetReps << ","
-             << (goal.achieved ? "1" : "0") << "\n";
+        file.write(activityTypeToString(goal.type));
+        file.put(',');
+        file.write(goal.description);
+        file.put(',');
+        file.write(goal.deadline.toString());
+        file.put(',');
+        file.writeMeasure(goal.targetDistance, DISTANCE_DECIMALS);
+        file.put(',');
+        file.writeMeasure(goal.targetDuration, DURATION_DECIMALS);
+        file.put(',');
+        file.writeInt(goal.targetReps);
+        file.put(',');
+        file.put(goal.achieved ? '1' : '0');
+        file.put(',');
+        file.writeInt(goal.id);
+        file.put('\n');
     }
-    file.close();
+    // Only live goals were written, so the tombstones go with the old file
+    if (!commitCompactedFile(GOALS_FILE, file, deadGoalRows, nextGoalId))
+        return;
+    goalsDirty = false;
 }
 
 // Add activity with ID
@@ -182,7 +269,14 @@ void CoreTracker::addActivity(int id)
     }
 
     std::cout << "Enter date (YYYY-MM-DD): ";
-    std::cin >> activity.date;
+    std::string date;
+    std::cin >> date;
+    activity.date = Date::parse(date);
+    if (!activity.date.isValid())
+    {
+        std::cout << Color::RED << "Invalid date!" << Color::RESET << "\n";
+        return;
+    }
 
     std::cout << "Enter duration (minutes): ";
     std::cin >> activity.duration;
@@ -192,9 +286,30 @@ void CoreTracker::addActivity(int id)
 
     std::cout << "Enter repetitions (0 if not applicable): ";
     std::cin >> activity.repetitions;
+    if (!durationFits(activity.duration) || !distanceFits(activity.distance))
+    {
+        std::cout << Color::RED << "Duration or distance is too large!" << Color::RESET << "\n";
+        return;
+    }
+
+    if (!lockActivitiesForWrite())
+        return;
 
-    activities.push_back(activity);
-    saveActivities();
+    // Append one record instead of rewriting the whole file
+    std::ostringstream record;
+    writeActivityRecord(record, activity);
+    if (!appendJournalRecord(journalPathFor(ACTIVITIES_FILE), record.str()))
+    {
+        std::cout << Color::RED << "Could not save the activity!" << Color::RESET << "\n";
+        return;
+    }
+    if (activitiesLoaded)
+        activities.push_back(activity);
+
+    if (isJournalCompactionDue(journalPathFor(ACTIVITIES_FILE)))
+    {
+        compactActivities();
+    }
 
     std::cout << Color::GREEN << "Activity added successfully!" << Color::RESET << "\n";
 }
@@ -202,13 +317,19 @@ void CoreTracker::addActivity(int id)
 // View specific activity by ID
 void CoreTracker::viewActivity(int id)
 {
-    if (id < 0 || id >= static_cast<int>(activities.size()))
+    // Read just this row through the ID index instead of loading everything
+    Activity activity;
+    if (id < 0 || !findActivityInFiles(ACTIVITIES_FILE, NAME_DIALECT, static_cast<uint64_t>(id),
+                                       [&activity](const ActivityRow &row)
+    {
+        activity = Activity(static_cast<ActivityType>(row.type), row.date,
+                            row.duration, row.distance, row.repetitions);
+    }))
     {
         std::cout << Color::RED << "Activity ID " << id << " not found!" << Color::RESET << "\n";
         return;
     }
 
-    const auto &activity = activities[id];
     std::cout << Color::BOLD + Color::CYAN + "=== Activity Details (ID: " << id << ") ===" + Color::RESET << "\n";
     std::cout << Color::BOLD << "Type: " << Color::RESET << colorActivityType(activity.type) << "\n";
     std::cout << Color::BOLD << "Date: " << Color::RESET << activity.date << "\n";
@@ -217,33 +338,52 @@ void CoreTracker::viewActivity(int id)
     std::cout << Color::BOLD << "Repetitions: " << Color::RESET << activity.repetitions << "\n";
 }
 
-// View all activities
-void CoreTracker::viewActivities()
+// View activities [offset, offset + limit), printing rows as they are read
+// so memory stays constant and paging stops reading once the page is full
+void CoreTracker::viewActivities(size_t offset, size_t limit)
 {
     std::cout << Color::BOLD + Color::CYAN + "=== All Activities ===" + Color::RESET << "\n";
-    if (activities.empty())
+
+    size_t index = 0;
+    size_t printed = 0;
+    auto printRow = [&](const Activity &activity) -> bool
     {
-        std::cout << Color::YELLOW << "No activities recorded." << Color::RESET << "\n";
-        return;
-    }
+        if (printed >= limit)
+            return false;
 
-    std::cout << Color::BOLD << std::left << std::setw(5) << "ID"
-              << std::setw(20) << "Type"
-              << std::setw(12) << "Date"
-              << std::setw(10) << "Duration"
-              << std::setw(10) << "Distance"
-              << std::setw(8) << "Reps" << Color::RESET << "\n";
-    std::cout << std::string(70, '-') << "\n";
+        if (index >= offset)
+        {
+            if (printed == 0)
+            {
+                std::cout << Color::BOLD << std::left << std::setw(5) << "ID"
+                          << std::setw(20) << "Type"
+                          << std::setw(12) << "Date"
+                          << std::setw(10) << "Duration"
+                          << std::setw(10) << "Distance"
+                          << std::setw(8) << "Reps" << Color::RESET << "\n";
+                std::cout << std::string(70, '-') << "\n";
+            }
+            std::cout << std::left << std::setw(5) << index
+                      << std::setw(20) << colorActivityType(activity.type)
+                      << std::setw(12) << activity.date
+                      << std::setw(10) << activity.duration
+                      << std::setw(10) << activity.distance
+                      << std::setw(8) << activity.repetitions << "\n";
+            ++printed;
+        }
+        ++index;
+        return printed < limit;
+    };
+
+    if (limit > 0)
+        forEachActivity(ACTIVITIES_FILE, printRow);
 
-    for (size_t i = 0; i < activities.size(); ++i)
+    if (limit > 0 && printed == 0)
     {
-        const auto &activity = activities[i];
-        std::cout << std::left << std::setw(5) << i
-                  << std::setw(20) << colorActivityType(activity.type)
-                  << std::setw(12) << activity.date
-                  << std::setw(10) << activity.duration
-                  << std::setw(10) << activity.distance
-                  << std::setw(8) << activity.repetitions << "\n";
+        if (index == 0)
+            std::cout << Color::YELLOW << "No activities recorded." << Color::RESET << "\n";
+        else
+            std::cout << Color::YELLOW << "No activities at offset " << offset << "." << Color::RESET << "\n";
     }
 }
 
@@ -259,23 +399,42 @@ void CoreTracker::addGoal(int goalId, int activityId, const std::string &descrip
         type = ActivityType::UNKNOWN;
     }
 
-    Goal goal(type, description, deadline, targetDistance, targetDuration, targetReps);
+    // IDs are assigned here so they stay unique across deletes; the
+    // requested one is only a label from the command line
+    (void)goalId;
+    Date deadlineDate = Date::parse(deadline);
+    if (!deadlineDate.isValid())
+    {
+        std::cout << Color::RED << "Invalid deadline! Use YYYY-MM-DD." << Color::RESET << "\n";
+        return;
+    }
+    if (!durationFits(targetDuration) || !distanceFits(targetDistance))
+    {
+        std::cout << Color::RED << "Target duration or distance is too large!" << Color::RESET << "\n";
+        return;
+    }
+    if (!lockGoalsForWrite())
+        return;
+    Goal goal(type, description, deadlineDate, targetDistance, targetDuration, targetReps);
+    goal.id = nextGoalId++;
+    goalPositions[goal.id] = goals.size();
     goals.push_back(goal);
-    saveGoals();
+    goalsDirty = true;
 
-    std::cout << Color::GREEN << "Goal added successfully with ID: " << goalId << Color::RESET << "\n";
+    std::cout << Color::GREEN << "Goal added successfully with ID: " << goal.id << Color::RESET << "\n";
 }
 
 // View specific goal by ID
 void CoreTracker::viewGoal(int id)
 {
-    if (id < 0 || id >= static_cast<int>(goals.size()))
+    int index = findGoal(id);
+    if (index < 0)
     {
         std::cout << Color::RED << "Goal ID " << id << " not found!" << Color::RESET << "\n";
         return;
     }
 
-    const auto &goal = goals[id];
+    const auto &goal = goals[index];
     std::cout << Color::BOLD + Color::CYAN + "=== Goal Details (ID: " << id << ") ===" + Color::RESET << "\n";
     std::cout << Color::BOLD << "Activity Type: " << Color::RESET << colorActivityType(goal.type) << "\n";
     std::cout << Color::BOLD << "Description: " << Color::RESET << goal.description << "\n";
@@ -306,7 +465,7 @@ void CoreTracker::viewGoals()
     for (size_t i = 0; i < goals.size(); ++i)
     {
         const auto &goal = goals[i];
-        std::cout << std::left << std::setw(5) << i
+        std::cout << std::left << std::setw(5) << goal.id
                   << std::setw(20) << colorActivityType(goal.type)
                   << std::setw(20) << goal.description.substr(0, 18)
                   << std::setw(12) << goal.deadline
@@ -318,21 +477,73 @@ void CoreTracker::viewGoals()
 void CoreTracker::modifyGoal(int goalId, int activityId, const std::string &description,
                              const std::string &deadline, int targetReps, double targetDuration, double targetDistance)
 {
+    Date deadlineDate = Date::parse(deadline);
+    if (!deadlineDate.isValid())
+    {
+        std::cout << Color::RED << "Invalid deadline! Use YYYY-MM-DD." << Color::RESET << "\n";
+        return;
+    }
+    if (!durationFits(targetDuration) || !distanceFits(targetDistance))
+    {
+        std::cout << Color::RED << "Target duration or distance is too large!" << Color::RESET << "\n";
+        return;
+    }
+    if (!lockGoalsForWrite())
+        return;
 
-    if (goalId < 0 || goalId >= static_cast<int>(goals.size()))
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cout << Color::RED << "Goal ID " << goalId << " not found!" << Color::RESET << "\n";
         return;
     }
 
-    Goal &goal = goals[goalId];
+    Goal &goal = goals[index];
     goal.type = static_cast<ActivityType>(activityId);
     goal.description = description;
-    goal.deadline = deadline;
+    goal.deadline = deadlineDate;
     goal.targetReps = targetReps;
     goal.targetDuration = targetDuration;
     goal.targetDistance = targetDistance;
 
-    saveGoals();
+    goalsDirty = true;
     std::cout << Color::GREEN << "Goal modified successfully!" << Color::RESET << "\n";
-}
\ No newline at end of file
+}
+
+// Position of the goal with the given ID in goals, or -1, in constant time
+int CoreTracker::findGoal(int goalId)
+{
+    auto found = goalPositions.find(goalId);
+    return found == goalPositions.end() ? -1 : static_cast<int>(found->second);
+}
+
+// Become the only writer of goals until this object goes away. Goals were
+// loaded before the lock and may be stale, so they are loaded again.
+bool CoreTracker::lockGoalsForWrite()
+{
+    if (goalsWriteLock.isLocked())
+        return true;
+    if (!goalsWriteLock.lock(writerLockPathFor(GOALS_FILE), LockMode::EXCLUSIVE))
+    {
+        std::cerr << "Could not lock " << GOALS_FILE << " for writing\n";
+        return false;
+    }
+    loadGoals();
+    return true;
+}
+
+// Become the only writer of activities until this object goes away;
+// activities loaded before the lock are loaded again
+bool CoreTracker::lockActivitiesForWrite()
+{
+    if (activitiesWriteLock.isLocked())
+        return true;
+    if (!activitiesWriteLock.lock(writerLockPathFor(ACTIVITIES_FILE), LockMode::EXCLUSIVE))
+    {
+        std::cerr << "Could not lock " << ACTIVITIES_FILE << " for writing\n";
+        return false;
+    }
+    if (activitiesLoaded)
+        loadActivities();
+    return true;
+}
@@ -2,9 +2,16 @@
 #define CORE_TRACKER_H
 
 #include <vector>
+#include <unordered_map>
 #include <string>
+#include <iosfwd>
+#include <cstddef>
 #include "activity.h"
 #include "Color.h"
+#include "file_lock.h"
+
+// Row count meaning "no limit" for paged listings
+const size_t NO_LIMIT = static_cast<size_t>(-1);
 
 class CoreTracker
 {
@@ -13,24 +20,41 @@ private:
     std::vector<Goal> goals;
     const std::string ACTIVITIES_FILE = "activities_cpp.csv";
     const std::string GOALS_FILE = "activities_goals_cpp.csv";
+    bool activitiesLoaded = false;
+    bool goalsDirty = false; // Goals changed since they were loaded or saved
+    size_t deadGoalRows = 0; // Deleted goals still in the goals file
+    int nextGoalId = 0;
+    std::unordered_map<int, size_t> goalPositions; // Goal ID -> position in goals
+    FileLock activitiesWriteLock;
+    FileLock goalsWriteLock;
+
+    void ensureActivitiesLoaded();
+    bool lockActivitiesForWrite();
+    bool lockGoalsForWrite();
+    int findGoal(int goalId);
+    void writeActivityRecord(std::ostream &out, const Activity &activity);
 
 public:
     CoreTracker();
     ~CoreTracker();
 
+    // Write collections that changed since they were loaded
+    void flush();
+
     // Utility methods
     std::string colorActivityType(ActivityType type);
 
     // File operations
     void loadActivities();
-    void saveActivities();
+    bool saveActivities();
+    bool compactActivities();
     void loadGoals();
     void saveGoals();
 
     // Activity operations
     void addActivity(int id);
     void viewActivity(int id);
-    void viewActivities();
+    void viewActivities(size_t offset = 0, size_t limit = NO_LIMIT);
 
     // Goal operations
     void addGoal(int goalId, int activityId, const std::string &description,
@@ -41,7 +41,7 @@ ActivityType stringToActivityType(const std::string &str)
 }
 
 // Activity constructor implementation
-Activity::Activity(ActivityType t, const std::string &d, double dur, double dist, int reps)
+Activity::Activity(ActivityType t, Date d, double dur, double dist, int reps)
     : type(t), date(d), duration(dur), distance(dist), repetitions(reps)
 {
 }
@@ -50,7 +50,7 @@ Activity::Activity(ActivityType t, const std::string &d, double dur, double dist
 Activity::Activity() = default;
 
 // Goal constructor implementation
-Goal::Goal(ActivityType t, const std::string &desc, const std::string &dl,
+Goal::Goal(ActivityType t, const std::string &desc, Date dl,
            double dist, double dur, int reps)
     : type(t), targetDistance(dist), targetDuration(dur),
       targetReps(reps), deadline(dl), description(desc), achieved(false)
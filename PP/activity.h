@@ -1,6 +1,7 @@
 #ifndef ACTIVITY_H
 #define ACTIVITY_H
 
+#include "date.h"
 #include <string>
 #include <vector>
 
@@ -23,29 +24,30 @@ ActivityType stringToActivityType(const std::string &typeStr);
 struct Activity
 {
     ActivityType type = ActivityType::UNKNOWN;
-    std::string date = ""; // Format: YYYY-MM-DD
+    Date date;
     double duration = 0.0; // in minutes (using double for potentially better precision)
     double distance = 0.0; // in kilometers
     int repetitions = 0;   // for strength activities
 
     // Constructor declarations
-    Activity(ActivityType t, const std::string &d, double dur, double dist = 0.0, int reps = 0);
+    Activity(ActivityType t, Date d, double dur, double dist = 0.0, int reps = 0);
     Activity(); // Default constructor
 };
 
 // Structure for tracking goals and achievements
 struct Goal
 {
+    int id = -1;                  // Stable ID, unchanged when other goals are deleted
     ActivityType type = ActivityType::UNKNOWN;
     double targetDistance = 0.0;  // in kilometers
     double targetDuration = 0.0;  // in minutes
     int targetReps = 0;           // for strength activities
-    std::string deadline = "";    // Format: YYYY-MM-DD
+    Date deadline;
     std::string description = ""; // User-friendly description
     bool achieved = false;
 
     // Constructor declaration
-    Goal(ActivityType t, const std::string &desc, const std::string &dl,
+    Goal(ActivityType t, const std::string &desc, Date dl,
          double dist = 0.0, double dur = 0.0, int reps = 0);
     Goal(); // Default constructor
 };
@@ -9,6 +9,7 @@
 #include "activity.h"
 #include "CoreTracker.h"
 #include "Color.h"
+#include "io_stats.h"
 
 int main(int argc, char *argv[])
 {
@@ -20,11 +21,12 @@ int main(int argc, char *argv[])
         std::cout << Color::BOLD + Color::YELLOW + "Commands:" + Color::RESET << "\n";
         std::cout << Color::GREEN + "  add_activity" + Color::RESET + " <activity_ID>\n";
         std::cout << Color::GREEN + "  view_activity" + Color::RESET + " <activity_ID>\n";
-        std::cout << Color::GREEN + "  view_activities" + Color::RESET << "\n";
+        std::cout << Color::GREEN + "  view_activities" + Color::RESET + " [--offset <n>] [--limit <n>]\n";
         std::cout << Color::MAGENTA + "  add_goal" + Color::RESET + " <goal_ID> <activity_ID> <description> <deadline> <target_reps> <target_duration> <target_distance>\n";
         std::cout << Color::MAGENTA + "  view_goal" + Color::RESET + " <goal_ID>\n";
         std::cout << Color::MAGENTA + "  view_goals" + Color::RESET << "\n";
         std::cout << Color::MAGENTA + "  modify_goal" + Color::RESET + " <goal_ID> <activity_ID> <description> <deadline> <target_reps> <target_duration> <target_distance>\n";
+        std::cout << Color::GREEN + "  compact" + Color::RESET << "\n";
         return 1;
     }
 
@@ -42,7 +44,23 @@ int main(int argc, char *argv[])
     }
     else if (command == "view_activities")
     {
-        tracker.viewActivities();
+        size_t offset = 0;
+        size_t limit = NO_LIMIT;
+        for (int i = 2; i + 1 < argc; i += 2)
+        {
+            std::string option = argv[i];
+            int value = std::stoi(argv[i + 1]);
+            if (value < 0)
+            {
+                std::cout << Color::RED << option << " must not be negative." << Color::RESET << "\n";
+                return 1;
+            }
+            if (option == "--offset")
+                offset = static_cast<size_t>(value);
+            else if (option == "--limit")
+                limit = static_cast<size_t>(value);
+        }
+        tracker.viewActivities(offset, limit);
     }
     else if (command == "add_goal" && argc >= 9)
     {
@@ -75,11 +93,20 @@ int main(int argc, char *argv[])
         double targetDistance = std::stod(argv[8]);
         tracker.modifyGoal(goalId, activityId, description, deadline, targetReps, targetDuration, targetDistance);
     }
+    else if (command == "compact")
+    {
+        if (tracker.compactActivities())
+        {
+            std::cout << Color::GREEN << "Activity journal compacted." << Color::RESET << "\n";
+        }
+    }
     else
     {
         std::cout << Color::RED << "Invalid command or insufficient arguments." << Color::RESET << "\n";
         return 1;
     }
 
+    tracker.flush();
+    std::cerr << "Bytes written: " << bytesWritten() << " in " << writeSeconds() * 1000.0 << " ms\n";
     return 0;
 }
\ No newline at end of file
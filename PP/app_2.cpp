@@ -2,6 +2,7 @@
 #include <string>
 #include "AdvancedTracker.h"
 #include "activity.h"
+#include "io_stats.h"
 
 int main(int argc, char *argv[])
 {
@@ -15,7 +16,8 @@ int main(int argc, char *argv[])
         std::cout << "  filter_statistics <activity_ID> <goal_ID>\n";
         std::cout << "  view_progres <goal_ID>\n";
         std::cout << "  delete_goal <goal_ID>\n";
-        std::cout << "  backup <file_path>\n";
+        std::cout << "  backup <file_path> [--full]\n";
+        std::cout << "  restore <file_path>\n";
         return 1;
     }
 
@@ -44,7 +46,13 @@ int main(int argc, char *argv[])
     else if (command == "backup" && argc >= 3)
     {
         std::string filePath = argv[2];
-        tracker.backup(filePath);
+        bool full = argc >= 4 && std::string(argv[3]) == "--full";
+        tracker.backup(filePath, full);
+    }
+    else if (command == "restore" && argc >= 3)
+    {
+        std::string filePath = argv[2];
+        tracker.restore(filePath);
     }
     else
     {
@@ -52,5 +60,6 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    std::cerr << "Bytes written: " << bytesWritten() << " in " << writeSeconds() * 1000.0 << " ms\n";
     return 0;
 }
\ No newline at end of file
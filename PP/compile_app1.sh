@@ -1,2 +1,2 @@
 #!/bin/bash
-g++ -std=c++11 -Wall -Wextra -o app_1 app_1.cpp CoreTracker.cpp activity.cpp Color.cpp 
\ No newline at end of file
+g++ -std=c++11 -Wall -Wextra -I../storage -o app_1 app_1.cpp CoreTracker.cpp activity.cpp Color.cpp ../storage/*.cpp -pthread 
\ No newline at end of file
@@ -1,2 +1,2 @@
 #!/bin/bash
-g++ -std=c++11 -Wall -Wextra -o app_2 app_2.cpp AdvancedTracker.cpp activity.cpp Color.cpp 
\ No newline at end of file
+g++ -std=c++11 -Wall -Wextra -I../storage -o app_2 app_2.cpp AdvancedTracker.cpp activity.cpp Color.cpp ../storage/*.cpp -pthread 
\ No newline at end of file
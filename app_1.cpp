@@ -1,23 +1,52 @@
 #include "app_1.h"
+#include "mapped_file.h"
+#include "activity_csv.h"
+#include "activity_file.h"
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "file_lock.h"
+#include "field_parser.h"
+#include "fixed_point.h"
+#include "goal_file.h"
+#include "journal.h"
+#include "io_stats.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <ctime>
 #include <iomanip>
+#include <limits>
 
-// Constructor - initialize and load data
-App1::App1()
+// Constructor - load the collections the command declared it needs;
+// anything else is loaded the first time it is touched
+App1::App1(int needs)
 {
-    loadActivities();
-    loadGoals();
+    if (needs & NEED_ACTIVITIES)
+    {
+        ensureActivitiesLoaded();
+    }
+    if (needs & NEED_GOALS)
+    {
+        ensureGoalsLoaded();
+    }
 }
 
-// Destructor - save data to files
+// Destructor - save modified data. New activities already sit in the
+// journal, so only goals can be pending here.
 App1::~App1()
 {
-    saveActivities();
-    saveGoals();
+    flush();
+}
+
+// Persist only the collections a command actually changed
+void App1::flush()
+{
+    if (goalsDirty)
+    {
+        saveGoals();
+    }
 }
 
 // Add a new activity
@@ -25,7 +54,8 @@ bool App1::addActivity(ActivityType type, const std::string &date, double durati
                        double distance, int repetitions)
 {
     // Validate date format
-    if (!isDateValid(date))
+    Date activityDate = Date::parse(date);
+    if (!isDateValid(activityDate))
     {
         std::cerr << "Invalid date format. Please use YYYY-MM-DD." << std::endl;
         return false;
@@ -37,6 +67,11 @@ bool App1::addActivity(ActivityType type, const std::string &date, double durati
         std::cerr << "Duration must be greater than 0." << std::endl;
         return false;
     }
+    if (!durationFits(duration) || !distanceFits(distance))
+    {
+        std::cerr << "Duration or distance is too large." << std::endl;
+        return false;
+    }
 
     // Activity-specific validation
     if ((type == ActivityType::RUNNING || type == ActivityType::WALKING ||
@@ -53,26 +88,77 @@ bool App1::addActivity(ActivityType type, const std::string &date, double durati
         return false;
     }
 
-    // Create and add the activity
-    Activity newActivity(type, date, duration, distance, repetitions);
-    activities.push_back(newActivity);
+    if (!lockActivitiesForWrite())
+    {
+        return false;
+    }
+
+    // Create the activity and append it to the journal; the main file is
+    // only rewritten when the journal is compacted
+    Activity newActivity(type, activityDate, duration, distance, repetitions);
+    std::string journalPath = journalPathFor(activitiesFilename);
+
+    std::ostringstream record;
+    writeActivityRecord(record, newActivity);
+    if (!appendJournalRecord(journalPath, record.str()))
+    {
+        std::cerr << "Error: Could not append to " << journalPath << "." << std::endl;
+        return false;
+    }
+    // An unloaded list picks the record up from the journal when loaded
+    if (activitiesLoaded)
+    {
+        activities.push_back(newActivity);
+    }
 
     std::cout << "Activity added successfully!" << std::endl;
-    saveActivities(); // Save immediately
+
+    if (isJournalCompactionDue(journalPath))
+    {
+        compactActivities();
+    }
+    return true;
+}
+
+// Rewrite the main activities file with every activity and drop the journal
+bool App1::compactActivities()
+{
+    if (!lockActivitiesForWrite())
+    {
+        return false;
+    }
+    if (hasDamagedRanges(activitiesFilename))
+    {
+        std::cerr << "Error: " << activitiesFilename << " is damaged; it is not compacted until it is restored from a backup."
+                  << std::endl;
+        return false;
+    }
+    ensureActivitiesLoaded();
+    if (!saveActivitiesToFile(activitiesFilename, CODE_DIALECT, activities))
+    {
+        std::cerr << "Error: Could not write " << activitiesFilename << "." << std::endl;
+        return false;
+    }
     return true;
 }
 
-// View a specific activity
+// View a specific activity, read straight from the file through the ID index
 bool App1::viewActivity(int activityId)
 {
-    if (activityId < 0 || activityId >= activities.size())
+    Activity activity;
+    bool found = activityId >= 0 &&
+                 findActivityInFiles(activitiesFilename, CODE_DIALECT, static_cast<uint64_t>(activityId),
+                                     [&activity](const ActivityRow &row)
+    {
+        activity = Activity(static_cast<ActivityType>(row.type), row.date,
+                            row.duration, row.distance, row.repetitions);
+    });
+    if (!found)
     {
         std::cerr << "Invalid activity ID." << std::endl;
         return false;
     }
 
-    const Activity &activity = activities[activityId];
-
     std::cout << "Activity ID: " << activityId << std::endl;
     std::cout << "Type: " << getActivityTypeName(activity.type) << std::endl;
     std::cout << "Date: " << activity.date << std::endl;
@@ -92,61 +178,111 @@ bool App1::viewActivity(int activityId)
     return true;
 }
 
-// View all activities
-bool App1::viewAllActivities()
+// View activities [offset, offset + limit). Rows are parsed and printed
+// straight out of the mapped file and journal, so memory use does not grow
+// with the history and reading stops as soon as the page is full.
+bool App1::viewAllActivities(size_t offset, size_t limit)
 {
-    if (activities.empty())
+    if (limit == 0)
     {
-        std::cout << "No activities recorded yet." << std::endl;
-        return false;
+        return true;
     }
 
-    std::cout << "All Activities:" << std::endl;
-    std::cout << std::setw(5) << "ID" << " | "
-              << std::setw(10) << "Type" << " | "
-              << std::setw(12) << "Date" << " | "
-              << std::setw(10) << "Duration" << " | "
-              << std::setw(10) << "Distance" << " | "
-              << std::setw(10) << "Reps" << std::endl;
-    std::cout << std::string(65, '-') << std::endl;
+    size_t index = 0;
+    size_t printed = 0;
 
-    for (size_t i = 0; i < activities.size(); ++i)
+    forEachActivityInFiles(activitiesFilename, CODE_DIALECT, [&](const ActivityRow &row) -> bool
     {
-        const Activity &activity = activities[i];
-        std::cout << std::setw(5) << i << " | "
-                  << std::setw(10) << getActivityTypeName(activity.type) << " | "
-                  << std::setw(12) << activity.date << " | "
-                  << std::setw(10) << activity.duration << " | ";
-
-        if (activity.type == ActivityType::RUNNING || activity.type == ActivityType::WALKING ||
-            activity.type == ActivityType::SWIMMING)
-        {
-            std::cout << std::setw(10) << activity.distance << " | ";
-        }
-        else
+        if (index >= offset)
         {
-            std::cout << std::setw(10) << "N/A" << " | ";
+            if (printed == 0)
+            {
+                printActivityHeader();
+            }
+            Activity activity(static_cast<ActivityType>(row.type), row.date,
+                              row.duration, row.distance, row.repetitions);
+            printActivityRow(index, activity);
+            ++printed;
         }
+        ++index;
+        return printed < limit;
+    },
+    [](const char *lineBegin, const char *lineEnd)
+    {
+        std::cerr << "Error parsing line: " << std::string(lineBegin, lineEnd) << std::endl;
+    });
 
-        if (activity.type == ActivityType::STRENGTH)
+    if (printed == 0)
+    {
+        if (index == 0)
         {
-            std::cout << std::setw(10) << activity.repetitions << std::endl;
+            std::cout << "No activities recorded yet." << std::endl;
         }
         else
         {
-            std::cout << std::setw(10) << "N/A" << std::endl;
+            std::cout << "No activities at offset " << offset << "." << std::endl;
         }
+        return false;
     }
 
+    std::cout.flush();
     return true;
 }
 
+// Print the column headings of the activity table
+void App1::printActivityHeader()
+{
+    std::cout << "All Activities:" << std::endl;
+    std::cout << std::setw(5) << "ID" << " | "
+              << std::setw(10) << "Type" << " | "
+              << std::setw(12) << "Date" << " | "
+              << std::setw(10) << "Duration" << " | "
+              << std::setw(10) << "Distance" << " | "
+              << std::setw(10) << "Reps" << std::endl;
+    std::cout << std::string(65, '-') << std::endl;
+}
+
+// Print one row of the activity table; not flushed, so long listings
+// are written in large chunks
+void App1::printActivityRow(size_t id, const Activity &activity)
+{
+    std::cout << std::setw(5) << id << " | "
+              << std::setw(10) << getActivityTypeName(activity.type) << " | "
+              << std::setw(12) << activity.date << " | "
+              << std::setw(10) << activity.duration << " | ";
+
+    if (activity.type == ActivityType::RUNNING || activity.type == ActivityType::WALKING ||
+        activity.type == ActivityType::SWIMMING)
+    {
+        std::cout << std::setw(10) << activity.distance << " | ";
+    }
+    else
+    {
+        std::cout << std::setw(10) << "N/A" << " | ";
+    }
+
+    if (activity.type == ActivityType::STRENGTH)
+    {
+        std::cout << std::setw(10) << activity.repetitions << '\n';
+    }
+    else
+    {
+        std::cout << std::setw(10) << "N/A" << '\n';
+    }
+}
+
 // Add a new goal
 bool App1::addGoal(ActivityType type, const std::string &description, const std::string &deadline,
                    int targetReps, double targetDuration, double targetDistance)
 {
+    if (!lockGoalsForWrite())
+    {
+        return false;
+    }
+
     // Validate date format
-    if (!isDateValid(deadline))
+    Date deadlineDate = Date::parse(deadline);
+    if (!isDateValid(deadlineDate))
     {
         std::cerr << "Invalid deadline format. Please use YYYY-MM-DD." << std::endl;
         return false;
@@ -172,26 +308,43 @@ bool App1::addGoal(ActivityType type, const std::string &description, const std:
         std::cerr << "Target duration must be greater than 0." << std::endl;
         return false;
     }
+    if (!durationFits(targetDuration) || !distanceFits(targetDistance))
+    {
+        std::cerr << "Target duration or distance is too large." << std::endl;
+        return false;
+    }
+
+    if (nextGoalId == std::numeric_limits<int>::max())
+    {
+        std::cerr << "No goal IDs left." << std::endl;
+        return false;
+    }
 
     // Create and add the goal
-    Goal newGoal(type, description, deadline, targetDistance, targetDuration, targetReps);
+    Goal newGoal(type, goalText.intern(description), deadlineDate, targetDistance, targetDuration, targetReps);
+    newGoal.id = nextGoalId++;
+    goalPositions[newGoal.id] = goals.size();
     goals.push_back(newGoal);
 
     std::cout << "Goal added successfully!" << std::endl;
-    saveGoals(); // Save immediately
+    std::cout << "Goal ID: " << newGoal.id << std::endl;
+    goalsDirty = true; // Saved once when the command finishes
     return true;
 }
 
 // View a specific goal
 bool App1::viewGoal(int goalId)
 {
-    if (goalId < 0 || goalId >= goals.size())
+    ensureGoalsLoaded();
+
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cerr << "Invalid goal ID." << std::endl;
         return false;
     }
 
-    const Goal &goal = goals[goalId];
+    const Goal &goal = goals[index];
 
     std::cout << "Goal ID: " << goalId << std::endl;
     std::cout << "Description: " << goal.description << std::endl;
@@ -218,6 +371,8 @@ bool App1::viewGoal(int goalId)
 // View all goals
 bool App1::viewAllGoals()
 {
+    ensureGoalsLoaded();
+
     if (goals.empty())
     {
         std::cout << "No goals set yet." << std::endl;
@@ -238,7 +393,7 @@ bool App1::viewAllGoals()
     for (size_t i = 0; i < goals.size(); ++i)
     {
         const Goal &goal = goals[i];
-        std::cout << std::setw(5) << i << " | "
+        std::cout << std::setw(5) << goal.id << " | "
                   << std::setw(20) << goal.description << " | "
                   << std::setw(10) << getActivityTypeName(goal.type) << " | "
                   << std::setw(12) << goal.deadline << " | "
@@ -274,14 +429,21 @@ bool App1::modifyGoal(int goalId, ActivityType type, const std::string &descript
                       const std::string &deadline, int targetReps, double targetDuration,
                       double targetDistance)
 {
-    if (goalId < 0 || goalId >= goals.size())
+    if (!lockGoalsForWrite())
+    {
+        return false;
+    }
+
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cerr << "Invalid goal ID." << std::endl;
         return false;
     }
 
     // Validate date format
-    if (!isDateValid(deadline))
+    Date deadlineDate = Date::parse(deadline);
+    if (!isDateValid(deadlineDate))
     {
         std::cerr << "Invalid deadline format. Please use YYYY-MM-DD." << std::endl;
         return false;
@@ -307,150 +469,148 @@ bool App1::modifyGoal(int goalId, ActivityType type, const std::string &descript
         std::cerr << "Target duration must be greater than 0." << std::endl;
         return false;
     }
+    if (!durationFits(targetDuration) || !distanceFits(targetDistance))
+    {
+        std::cerr << "Target duration or distance is too large." << std::endl;
+        return false;
+    }
 
     // Update the goal
-    Goal &goal = goals[goalId];
+    Goal &goal = goals[index];
     goal.type = type;
-    goal.description = description;
-    goal.deadline = deadline;
+    goal.description = goalText.intern(description); // The old text stays in the pool
+    goal.deadline = deadlineDate;
     goal.targetReps = targetReps;
     goal.targetDuration = targetDuration;
     goal.targetDistance = targetDistance;
     goal.achieved = false; // Reset achievement status after modification
 
     std::cout << "Goal modified successfully!" << std::endl;
-    saveGoals(); // Save immediately
+    goalsDirty = true; // Saved once when the command finishes
     return true;
 }
 
-// Load activities from file
-void App1::loadActivities()
+// Load activities the first time they are needed
+void App1::ensureActivitiesLoaded()
 {
-    activities.clear();
-    std::ifstream inFile(activitiesFilename);
-
-    if (!inFile.is_open())
+    if (!activitiesLoaded)
     {
-        std::cerr << "Warning: Could not open file " << activitiesFilename << " for reading. Starting with empty activities list." << std::endl;
-        return;
+        loadActivities();
+        activitiesLoaded = true;
     }
+}
 
-    std::string line;
-    while (std::getline(inFile, line))
+// Load goals the first time they are needed
+void App1::ensureGoalsLoaded()
+{
+    if (!goalsLoaded)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> segmentList;
-
-        while (std::getline(ss, segment, ','))
-        {
-            segmentList.push_back(segment);
-        }
-
-        if (segmentList.size() >= 5)
-        {
-            try
-            {
-                int typeInt = std::stoi(segmentList[0]);
-                ActivityType type = static_cast<ActivityType>(typeInt);
-                std::string date = segmentList[1];
-                double duration = std::stod(segmentList[2]);
-                double distance = std::stod(segmentList[3]);
-                int repetitions = std::stoi(segmentList[4]);
-
-                Activity activity(type, date, duration, distance, repetitions);
-                activities.push_back(activity);
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
-            }
-        }
+        loadGoals();
+        goalsLoaded = true;
     }
-
-    inFile.close();
 }
 
-// Save activities to file
-void App1::saveActivities()
+// Become the only writer of activities until this object goes away. Data
+// loaded before the lock may be stale, so it is loaded again.
+bool App1::lockActivitiesForWrite()
 {
-    std::ofstream outFile(activitiesFilename);
-
-    if (!outFile.is_open())
+    if (activitiesWriteLock.isLocked())
     {
-        std::cerr << "Error: Could not open file " << activitiesFilename << " for writing." << std::endl;
-        return;
+        return true;
     }
-
-    for (const Activity &activity : activities)
+    if (!activitiesWriteLock.lock(writerLockPathFor(activitiesFilename), LockMode::EXCLUSIVE))
     {
-        outFile << static_cast<int>(activity.type) << ","
-                << activity.date << ","
-                << activity.duration << ","
-                << activity.distance << ","
-                << activity.repetitions << std::endl;
+        std::cerr << "Error: Could not lock " << activitiesFilename << " for writing." << std::endl;
+        return false;
     }
-
-    outFile.close();
+    if (activitiesLoaded)
+    {
+        loadActivities();
+    }
+    return true;
 }
 
-// Load goals from file
-void App1::loadGoals()
+// Become the only writer of goals until this object goes away. Goals are
+// loaded under the lock, replacing any loaded before it.
+bool App1::lockGoalsForWrite()
 {
-    goals.clear();
-    std::ifstream inFile(goalsFilename);
-
-    if (!inFile.is_open())
+    if (goalsWriteLock.isLocked())
     {
-        std::cerr << "Warning: Could not open file " << goalsFilename << " for reading. Starting with empty goals list." << std::endl;
-        return;
+        return true;
+    }
+    if (!goalsWriteLock.lock(writerLockPathFor(goalsFilename), LockMode::EXCLUSIVE))
+    {
+        std::cerr << "Error: Could not lock " << goalsFilename << " for writing." << std::endl;
+        return false;
     }
+    loadGoals();
+    goalsLoaded = true;
+    return true;
+}
 
-    std::string line;
-    while (std::getline(inFile, line))
+// Load activities from file, then replay the journal on top (see
+// activity_file.h)
+void App1::loadActivities()
+{
+    auto onInvalid = [](const char *lineBegin, const char *lineEnd)
+    {
+        std::cerr << "Error parsing line: " << std::string(lineBegin, lineEnd) << std::endl;
+    };
+    auto onDamaged = [this](uint64_t firstByte, uint64_t endByte, size_t rows)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> segmentList;
+        std::cerr << "Error: " << activitiesFilename << " is damaged at bytes " << firstByte << "-" << endByte
+                  << "; " << rows << " rows could not be read." << std::endl;
+    };
 
-        while (std::getline(ss, segment, ','))
-        {
-            segmentList.push_back(segment);
-        }
+    if (!loadActivitiesFromFiles(activitiesFilename, CODE_DIALECT, activities, onInvalid, onDamaged))
+    {
+        std::cerr << "Warning: Could not open file " << activitiesFilename << " for reading. Starting with empty activities list." << std::endl;
+    }
+}
+
+// Write one activity as a CSV record, without a line ending
+void App1::writeActivityRecord(std::ostream &out, const Activity &activity)
+{
+    writeActivity(out, CODE_DIALECT, activity);
+}
 
-        if (segmentList.size() >= 7)
+// Load the live goals; deleted ones are skipped via their tombstones
+void App1::loadGoals()
+{
+    goals.clear();
+    goalText.clear();
+    GoalFileStats stats;
+    if (!forEachLiveGoal(goalsFilename, stats, [this, &stats](const GoalRow &row)
+    {
+        if (goals.empty())
         {
-            try
-            {
-                int typeInt = std::stoi(segmentList[0]);
-                ActivityType type = static_cast<ActivityType>(typeInt);
-                std::string description = segmentList[1];
-                std::string deadline = segmentList[2];
-                int targetReps = std::stoi(segmentList[3]);
-                double targetDuration = std::stod(segmentList[4]);
-                double targetDistance = std::stod(segmentList[5]);
-                bool achieved = (segmentList[6] == "1");
-
-                Goal goal(type, description, deadline, targetDistance, targetDuration, targetReps);
-                goal.achieved = achieved;
-                goals.push_back(goal);
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
-            }
+            goals.reserve(stats.lines);
         }
+        Goal goal(static_cast<ActivityType>(row.type), goalText.intern(row.description, row.descriptionLength),
+                  row.deadline, row.targetDistance, row.targetDuration,
+                  row.targetReps);
+        goal.id = row.id;
+        goal.achieved = row.achieved;
+        goals.push_back(std::move(goal));
+    },
+    [](const char *lineBegin, const char *lineEnd)
+    {
+        std::cerr << "Error parsing line: " << std::string(lineBegin, lineEnd) << std::endl;
+    }))
+    {
+        std::cerr << "Warning: Could not open file " << goalsFilename << " for reading. Starting with empty goals list." << std::endl;
     }
-
-    inFile.close();
+    deadGoalRows = stats.deadRows;
+    nextGoalId = stats.nextId;
+    indexRecordIds(goals, goalPositions);
 }
 
 // Save goals to file
 void App1::saveGoals()
 {
-    std::ofstream outFile(goalsFilename);
+    BufferedWriter outFile;
 
-    if (!outFile.is_open())
+    if (!outFile.open(goalsFilename))
     {
         std::cerr << "Error: Could not open file " << goalsFilename << " for writing." << std::endl;
         return;
@@ -458,16 +618,24 @@ void App1::saveGoals()
 
     for (const Goal &goal : goals)
     {
-        outFile << static_cast<int>(goal.type) << ","
-                << goal.description << ","
-                << goal.deadline << ","
-                << goal.targetReps << ","
-                << goal.targetDuration << ","
-                << goal.targetDistance << ","
-                << (goal.achieved ? "1" : "0") << std::endl;
+        writeGoal(outFile, goal);
+        outFile.put('\n');
+    }
+
+    // Only live goals were written, so the tombstones go with the old file
+    if (!commitCompactedFile(goalsFilename, outFile, deadGoalRows, nextGoalId))
+    {
+        std::cerr << "Error: Could not write " << goalsFilename << "." << std::endl;
+        return;
     }
+    goalsDirty = false;
+}
 
-    outFile.close();
+// Position of the goal with the given ID in goals, or -1, in constant time
+int App1::findGoal(int goalId)
+{
+    auto found = goalPositions.find(goalId);
+    return found == goalPositions.end() ? -1 : static_cast<int>(found->second);
 }
 
 // Helper to get activity type name
@@ -491,43 +659,7 @@ std::string App1::getActivityTypeName(ActivityType type)
 }
 
 // Validate date format (YYYY-MM-DD)
-bool App1::isDateValid(const std::string &date)
+bool App1::isDateValid(Date date)
 {
-    if (date.length() != 10)
-        return false;
-    if (date[4] != '-' || date[7] != '-')
-        return false;
-
-    try
-    {
-        int year = std::stoi(date.substr(0, 4));
-        int month = std::stoi(date.substr(5, 2));
-        int day = std::stoi(date.substr(8, 2));
-
-        if (year < 1900 || year > 2100)
-            return false;
-        if (month < 1 || month > 12)
-            return false;
-        if (day < 1 || day > 31)
-            return false;
-
-        // Check days in month (simplified)
-        if (month == 2)
-        {
-            bool isLeapYear = (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
-            if (day > (isLeapYear ? 29 : 28))
-                return false;
-        }
-        else if (month == 4 || month == 6 || month == 9 || month == 11)
-        {
-            if (day > 30)
-                return false;
-        }
-
-        return true;
-    }
-    catch (...)
-    {
-        return false;
-    }
+    return date.isValid() && date >= Date::fromCivil(1900, 1, 1) && date <= Date::fromCivil(2100, 12, 31);
 }
\ No newline at end of file
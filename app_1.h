@@ -1,8 +1,14 @@
 #ifndef APP_1_H
 #define APP_1_H
 
+#include "date.h"
+#include "file_lock.h"
+#include "string_pool.h"
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <iosfwd>
+#include <cstddef>
 
 // Activity Types
 enum class ActivityType
@@ -19,45 +25,64 @@ enum class ActivityType
 struct Activity
 {
     ActivityType type = ActivityType::UNKNOWN;
-    std::string date = "";
+    Date date;
     double duration = 0.0;
     double distance = 0.0;
     int repetitions = 0;
 
     Activity() = default;
-    Activity(ActivityType t, std::string d, double dur, double dist = 0.0, int reps = 0)
-        : type(t), date(std::move(d)), duration(dur), distance(dist), repetitions(reps) {}
+    Activity(ActivityType t, Date d, double dur, double dist = 0.0, int reps = 0)
+        : type(t), date(d), duration(dur), distance(dist), repetitions(reps) {}
 };
 
 // Goal structure
 struct Goal
 {
+    int id = -1; // Stable ID, unchanged when other goals are deleted
     ActivityType type = ActivityType::UNKNOWN;
-    std::string description = "";
-    std::string deadline = "";
+    PooledString description; // Text lives in the owner's StringPool
+    Date deadline;
     int targetReps = 0;
     double targetDuration = 0.0;
     double targetDistance = 0.0;
     bool achieved = false;
 
     Goal() = default;
-    Goal(ActivityType t, std::string desc, std::string dl,
+    Goal(ActivityType t, PooledString desc, Date dl,
          double dist = 0.0, double dur = 0.0, int reps = 0)
-        : type(t), description(std::move(desc)), deadline(std::move(dl)),
+        : type(t), description(desc), deadline(dl),
           targetReps(reps), targetDuration(dur), targetDistance(dist), achieved(false) {}
 };
 
+// Row count meaning "no limit" for paged listings
+const size_t NO_LIMIT = static_cast<size_t>(-1);
+
+// Collections a command declares up front; the rest load on first use
+enum DataNeeds
+{
+    NEED_NONE = 0,
+    NEED_ACTIVITIES = 1,
+    NEED_GOALS = 2,
+    NEED_ALL = NEED_ACTIVITIES | NEED_GOALS
+};
+
 class App1
 {
 public:
-    App1();
+    explicit App1(int needs = NEED_ALL);
     ~App1();
 
     // Core functions
     bool addActivity(ActivityType type, const std::string &date, double duration,
                      double distance = 0.0, int repetitions = 0);
     bool viewActivity(int activityId);
-    bool viewAllActivities();
+    bool viewAllActivities(size_t offset = 0, size_t limit = NO_LIMIT);
+
+    // Fold the activity journal into the main activities file
+    bool compactActivities();
+
+    // Write collections that changed since they were loaded
+    void flush();
 
     // Goal management
     bool addGoal(ActivityType type, const std::string &description, const std::string &deadline,
@@ -73,16 +98,32 @@ private:
     std::vector<Goal> goals;
     const std::string activitiesFilename = "activities_cpp.csv";
     const std::string goalsFilename = "activities_goals_cpp.csv";
+    bool activitiesLoaded = false;
+    bool goalsLoaded = false;
+    FileLock activitiesWriteLock; // Held from the first change to exit
+    FileLock goalsWriteLock;
+    bool goalsDirty = false; // Goals changed since they were loaded or saved
+    size_t deadGoalRows = 0; // Deleted goals still in the goals file
+    int nextGoalId = 0;
+    std::unordered_map<int, size_t> goalPositions; // Goal ID -> position in goals
+    StringPool goalText; // Goal descriptions, each distinct one stored once
 
     // File operations
+    void ensureActivitiesLoaded();
+    void ensureGoalsLoaded();
+    bool lockActivitiesForWrite();
+    bool lockGoalsForWrite();
     void loadActivities();
-    void saveActivities();
+    void writeActivityRecord(std::ostream &out, const Activity &activity);
     void loadGoals();
     void saveGoals();
 
     // Helper functions
+    int findGoal(int goalId);
     std::string getActivityTypeName(ActivityType type);
-    bool isDateValid(const std::string &date);
+    void printActivityHeader();
+    void printActivityRow(size_t id, const Activity &activity);
+    bool isDateValid(Date date);
 };
 
 #endif // APP_1_H
\ No newline at end of file
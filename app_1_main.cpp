@@ -1,4 +1,5 @@
 #include "app_1.h"
+#include "io_stats.h"
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -8,11 +9,12 @@ void printUsage()
     std::cout << "Usage:" << std::endl;
     std::cout << "./app_1 add_activity <activity ID>" << std::endl;
     std::cout << "./app_1 view_activity <activity ID>" << std::endl;
-    std::cout << "./app_1 view_activities" << std::endl;
+    std::cout << "./app_1 view_activities [--offset <n>] [--limit <n>]" << std::endl;
     std::cout << "./app_1 add_goal <goal ID> <activity ID> <description> <deadline> <target repetitions> <target duration> <target distance>" << std::endl;
     std::cout << "./app_1 view_goal <goal ID>" << std::endl;
     std::cout << "./app_1 view_goals" << std::endl;
     std::cout << "./app_1 modify_goal <goal ID> <activity ID> <description> <deadline> <target repetitions> <target duration> <target distance>" << std::endl;
+    std::cout << "./app_1 compact" << std::endl;
 }
 
 ActivityType getActivityTypeFromId(int id)
@@ -24,6 +26,22 @@ ActivityType getActivityTypeFromId(int id)
     return ActivityType::UNKNOWN;
 }
 
+// Collections each command reads; add_activity only appends to the journal,
+// view_activities streams rows straight from the files and goal changes load
+// goals once they hold the goals lock
+int dataNeededBy(const std::string &command)
+{
+    if (command == "compact")
+    {
+        return NEED_ACTIVITIES;
+    }
+    if (command == "view_goal" || command == "view_goals")
+    {
+        return NEED_GOALS;
+    }
+    return NEED_NONE;
+}
+
 int main(int argc, char *argv[])
 {
     if (argc < 2)
@@ -33,10 +51,11 @@ int main(int argc, char *argv[])
     }
 
     std::string command = argv[1];
-    App1 app;
-
     try
     {
+        // Loading can throw as well, so the app is made inside the try
+        App1 app(dataNeededBy(command));
+
         if (command == "add_activity")
         {
             if (argc < 3)
@@ -99,7 +118,31 @@ int main(int argc, char *argv[])
         }
         else if (command == "view_activities")
         {
-            app.viewAllActivities();
+            size_t offset = 0;
+            size_t limit = NO_LIMIT;
+
+            for (int i = 2; i < argc; ++i)
+            {
+                std::string option = argv[i];
+                if ((option == "--offset" || option == "--limit") && i + 1 < argc)
+                {
+                    int value = std::stoi(argv[++i]);
+                    if (value < 0)
+                    {
+                        std::cout << option << " must not be negative." << std::endl;
+                        return 1;
+                    }
+                    (option == "--offset" ? offset : limit) = static_cast<size_t>(value);
+                }
+                else
+                {
+                    std::cout << "Unknown option: " << option << std::endl;
+                    printUsage();
+                    return 1;
+                }
+            }
+
+            app.viewAllActivities(offset, limit);
         }
         else if (command == "add_goal")
         {
@@ -187,12 +230,22 @@ int main(int argc, char *argv[])
                 std::cout << "Goal modified successfully." << std::endl;
             }
         }
+        else if (command == "compact")
+        {
+            if (app.compactActivities())
+            {
+                std::cout << "Activity journal compacted." << std::endl;
+            }
+        }
         else
         {
             std::cout << "Unknown command: " << command << std::endl;
             printUsage();
             return 1;
         }
+
+        app.flush();
+        std::cerr << "Bytes written: " << bytesWritten() << " in " << writeSeconds() * 1000.0 << " ms" << std::endl;
     }
     catch (const std::exception &e)
     {
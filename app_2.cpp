@@ -1,19 +1,35 @@
 #include "app_2.h"
+#include "mapped_file.h"
+#include "activity_csv.h"
+#include "activity_file.h"
+#include "backup_set.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "file_lock.h"
+#include "field_parser.h"
+#include "goal_file.h"
+#include "journal.h"
+#include "io_stats.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
-#include <ctime>
-#include <map>
 #include <numeric>
 #include <cmath>
 
-// Constructor - load data
-App2::App2()
+// Constructor - load the collections the command declared it needs;
+// anything else is loaded the first time it is touched
+App2::App2(int needs)
 {
-    loadActivities();
-    loadGoals();
+    if (needs & NEED_ACTIVITIES)
+    {
+        ensureActivitiesLoaded();
+    }
+    if (needs & NEED_GOALS)
+    {
+        ensureGoalsLoaded();
+    }
 }
 
 // Destructor
@@ -25,26 +41,16 @@ App2::~App2()
 // View general statistics
 bool App2::viewStatistics()
 {
+    ensureActivitiesLoaded();
+
     if (activities.empty())
     {
         std::cout << "No activities recorded yet." << std::endl;
         return false;
     }
 
-    // Prepare containers for statistics
-    std::map<ActivityType, int> activityCounts;
-    std::map<ActivityType, double> totalDurations;
-    std::map<ActivityType, double> totalDistances;
-    std::map<ActivityType, int> totalReps;
-
-    // Process all activities
-    for (const Activity &activity : activities)
-    {
-        activityCounts[activity.type]++;
-        totalDurations[activity.type] += activity.duration;
-        totalDistances[activity.type] += activity.distance;
-        totalReps[activity.type] += activity.repetitions;
-    }
+    // One pass over the numeric columns; dates are never touched
+    TypeTotals totals = totalByType(activities.columns());
 
     // Display general statistics
     std::cout << "=== ACTIVITY STATISTICS ===" << std::endl;
@@ -56,24 +62,25 @@ bool App2::viewStatistics()
     for (int i = 0; i <= static_cast<int>(ActivityType::STRENGTH); i++)
     {
         ActivityType type = static_cast<ActivityType>(i);
-        if (activityCounts[type] > 0)
+        const ActivityTotals &total = totals[i];
+        if (total.count > 0)
         {
             std::cout << "Activity Type: " << getActivityTypeName(type) << std::endl;
-            std::cout << "  Count: " << activityCounts[type] << std::endl;
-            std::cout << "  Total Duration: " << totalDurations[type] << " minutes" << std::endl;
-            std::cout << "  Average Duration: " << (totalDurations[type] / activityCounts[type]) << " minutes" << std::endl;
+            std::cout << "  Count: " << total.count << std::endl;
+            std::cout << "  Total Duration: " << total.minutes() << " minutes" << std::endl;
+            std::cout << "  Average Duration: " << (total.minutes() / total.count) << " minutes" << std::endl;
 
             if (type == ActivityType::RUNNING || type == ActivityType::WALKING || type == ActivityType::SWIMMING)
             {
-                std::cout << "  Total Distance: " << totalDistances[type] << " km" << std::endl;
-                std::cout << "  Average Distance: " << (totalDistances[type] / activityCounts[type]) << " km" << std::endl;
-                std::cout << "  Average Pace: " << (totalDurations[type] / totalDistances[type]) << " min/km" << std::endl;
+                std::cout << "  Total Distance: " << total.kilometres() << " km" << std::endl;
+                std::cout << "  Average Distance: " << (total.kilometres() / total.count) << " km" << std::endl;
+                std::cout << "  Average Pace: " << (total.minutes() / total.kilometres()) << " min/km" << std::endl;
             }
 
             if (type == ActivityType::STRENGTH)
             {
-                std::cout << "  Total Repetitions: " << totalReps[type] << std::endl;
-                std::cout << "  Average Repetitions: " << (totalReps[type] / activityCounts[type]) << std::endl;
+                std::cout << "  Total Repetitions: " << total.repetitions << std::endl;
+                std::cout << "  Average Repetitions: " << (total.repetitions / static_cast<int64_t>(total.count)) << std::endl;
             }
 
             std::cout << std::string(30, '-') << std::endl;
@@ -86,11 +93,15 @@ bool App2::viewStatistics()
 // Filter statistics by activity and goal
 bool App2::filterStatistics(int activityId, int goalId)
 {
+    ensureActivitiesLoaded();
+    ensureGoalsLoaded();
+
     // Check if activity ID is valid
-    bool validActivity = (activityId >= 0 && activityId < activities.size());
+    bool validActivity = (activityId >= 0 && static_cast<size_t>(activityId) < activities.size());
 
     // Check if goal ID is valid
-    bool validGoal = (goalId >= 0 && goalId < goals.size());
+    int goalIndex = findGoal(goalId);
+    bool validGoal = (goalIndex >= 0);
 
     if (!validActivity && !validGoal)
     {
@@ -103,7 +114,7 @@ bool App2::filterStatistics(int activityId, int goalId)
     // Show activity information
     if (validActivity)
     {
-        const Activity &activity = activities[activityId];
+        Activity activity = activities[activityId];
         std::cout << "Activity ID: " << activityId << std::endl;
         std::cout << "Type: " << getActivityTypeName(activity.type) << std::endl;
         std::cout << "Date: " << activity.date << std::endl;
@@ -127,7 +138,7 @@ bool App2::filterStatistics(int activityId, int goalId)
     // Show goal information
     if (validGoal)
     {
-        const Goal &goal = goals[goalId];
+        const Goal &goal = goals[goalIndex];
         std::cout << "Goal ID: " << goalId << std::endl;
         std::cout << "Description: " << goal.description << std::endl;
         std::cout << "Activity Type: " << getActivityTypeName(goal.type) << std::endl;
@@ -150,20 +161,11 @@ bool App2::filterStatistics(int activityId, int goalId)
         // If the goal is not achieved, show progress
         if (!goal.achieved)
         {
-            double completedDuration = 0.0;
-            double completedDistance = 0.0;
-            int completedReps = 0;
-
             // Sum up relevant activities
-            for (const Activity &activity : activities)
-            {
-                if (activity.type == goal.type)
-                {
-                    completedDuration += activity.duration;
-                    completedDistance += activity.distance;
-                    completedReps += activity.repetitions;
-                }
-            }
+            ActivityTotals completed = activities.totalOfType(static_cast<uint8_t>(goal.type));
+            double completedDuration = completed.minutes();
+            double completedDistance = completed.kilometres();
+            int completedReps = static_cast<int>(completed.repetitions);
 
             std::cout << std::string(30, '-') << std::endl;
             std::cout << "Progress:" << std::endl;
@@ -198,13 +200,17 @@ bool App2::filterStatistics(int activityId, int goalId)
 // View progress for a specific goal
 bool App2::viewProgress(int goalId)
 {
-    if (goalId < 0 || goalId >= goals.size())
+    ensureActivitiesLoaded();
+    ensureGoalsLoaded();
+
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cerr << "Invalid goal ID." << std::endl;
         return false;
     }
 
-    const Goal &goal = goals[goalId];
+    const Goal &goal = goals[index];
 
     std::cout << "=== GOAL PROGRESS ===" << std::endl;
     std::cout << "Goal ID: " << goalId << std::endl;
@@ -213,21 +219,11 @@ bool App2::viewProgress(int goalId)
     std::cout << "Deadline: " << goal.deadline << std::endl;
     std::cout << "Status: " << (goal.achieved ? "Achieved" : "In Progress") << std::endl;
 
-    // Calculate progress
-    double completedDuration = 0.0;
-    double completedDistance = 0.0;
-    int completedReps = 0;
-
-    // Sum up relevant activities
-    for (const Activity &activity : activities)
-    {
-        if (activity.type == goal.type)
-        {
-            completedDuration += activity.duration;
-            completedDistance += activity.distance;
-            completedReps += activity.repetitions;
-        }
-    }
+    // Calculate progress from the relevant activities
+    ActivityTotals completed = activities.totalOfType(static_cast<uint8_t>(goal.type));
+    double completedDuration = completed.minutes();
+    double completedDistance = completed.kilometres();
+    int completedReps = static_cast<int>(completed.repetitions);
 
     // Duration progress
     double durationPercentage = (completedDuration / goal.targetDuration) * 100.0;
@@ -279,28 +275,14 @@ bool App2::viewProgress(int goalId)
     }
 
     // Show days remaining until deadline
-    std::time_t now = std::time(nullptr);
-    std::tm tm = {};
-    std::istringstream deadlineStream(goal.deadline);
-    deadlineStream >> std::get_time(&tm, "%Y-%m-%d");
-
-    if (deadlineStream.fail())
+    int daysRemaining = calculateDaysBetween(Date::today(), goal.deadline);
+    if (daysRemaining > 0)
     {
-        std::cerr << "Error parsing deadline date." << std::endl;
+        std::cout << "\nDays remaining until deadline: " << daysRemaining << std::endl;
     }
-    else
+    else if (!goal.achieved)
     {
-        std::time_t deadlineTime = std::mktime(&tm);
-        double daysRemaining = std::difftime(deadlineTime, now) / (60 * 60 * 24);
-
-        if (daysRemaining > 0)
-        {
-            std::cout << "\nDays remaining until deadline: " << static_cast<int>(daysRemaining) << std::endl;
-        }
-        else if (daysRemaining <= 0 && !goal.achieved)
-        {
-            std::cout << "\nDeadline has passed!" << std::endl;
-        }
+        std::cout << "\nDeadline has passed!" << std::endl;
     }
 
     return true;
@@ -309,205 +291,261 @@ bool App2::viewProgress(int goalId)
 // Delete a goal
 bool App2::deleteGoal(int goalId)
 {
-    if (goalId < 0 || goalId >= goals.size())
+    if (!lockGoalsForWrite())
+    {
+        return false;
+    }
+
+    int index = findGoal(goalId);
+    if (index < 0)
     {
         std::cerr << "Invalid goal ID." << std::endl;
         return false;
     }
 
-    std::string description = goals[goalId].description;
+    // The row stays in the goals file; a one-line tombstone hides it
+    PooledString description = goals[index].description;
+    bool compactionDue = false;
+    if (!deleteRecordWithTombstone(goalsFilename, goals, goalPositions, index, deadGoalRows, compactionDue))
+    {
+        std::cerr << "Error: Could not record deletion in " << tombstonePathFor(goalsFilename) << "." << std::endl;
+        return false;
+    }
 
-    // We don't actually delete the goal here; we just mark it for deletion
-    // by writing it to a temporary file with a "DELETED" flag
+    std::cout << "Goal '" << description << "' deleted successfully!" << std::endl;
+    return !compactionDue || compactGoals();
+}
 
-    std::ofstream outFile(goalsFilename + ".tmp");
+// Rewrite the goals file with only the live goals, keeping their IDs, and
+// drop the tombstones
+bool App2::compactGoals()
+{
+    BufferedWriter outFile;
 
-    if (!outFile.is_open())
+    if (!outFile.open(goalsFilename))
     {
-        std::cerr << "Error: Could not open temporary file for writing." << std::endl;
+        std::cerr << "Error: Could not open file " << goalsFilename << " for writing." << std::endl;
         return false;
     }
 
-    for (size_t i = 0; i < goals.size(); ++i)
+    for (const Goal &goal : goals)
     {
-        if (i != static_cast<size_t>(goalId))
-        {
-            const Goal &goal = goals[i];
-            outFile << static_cast<int>(goal.type) << ","
-                    << goal.description << ","
-                    << goal.deadline << ","
-                    << goal.targetReps << ","
-                    << goal.targetDuration << ","
-                    << goal.targetDistance << ","
-                    << (goal.achieved ? "1" : "0") << std::endl;
-        }
+        writeGoal(outFile, goal);
+        outFile.put('\n');
     }
 
-    outFile.close();
+    // Readers must see the new file and the end of the tombstones together
+    if (!commitCompactedFile(goalsFilename, outFile, deadGoalRows, nextGoalId))
+    {
+        std::cerr << "Error: Could not write goals file " << goalsFilename << "." << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    // Rename the temporary file to the original file
-    std::remove(goalsFilename.c_str());
-    std::rename((goalsFilename + ".tmp").c_str(), goalsFilename.c_str());
+// Add a backup to the backup set at filePath. Only activities added and
+// goals changed since the last backup are written (see backup_set.h); full
+// starts a new chain with a complete copy.
+bool App2::backupData(const std::string &filePath, bool full)
+{
+    ensureGoalsLoaded();
+    std::vector<BackupGoal> goalRows;
+    goalRows.reserve(goals.size());
+    for (const Goal &goal : goals)
+    {
+        std::ostringstream row;
+        writeGoal(row, goal);
+        BackupGoal goalRow = {goal.id, row.str()};
+        goalRows.push_back(goalRow);
+    }
 
-    std::cout << "Goal '" << description << "' deleted successfully!" << std::endl;
+    BackupSummary summary;
+    if (!writeBackup(filePath, activitiesFilename, CODE_DIALECT, goalRows, full, summary))
+    {
+        std::cerr << "Error: Could not write backup " << filePath << "." << std::endl;
+        return false;
+    }
 
-    // Reload goals from file
-    loadGoals();
+    std::cout << (summary.number == 0 ? "Full" : "Incremental") << " backup " << summary.number
+              << " added to " << backupManifestPathFor(filePath) << ":" << std::endl;
+    std::cout << "- Activities written: " << summary.activities << std::endl;
+    std::cout << "- Goals written: " << summary.goals << std::endl;
+    std::cout << "- Goals deleted: " << summary.deletedGoals << std::endl;
 
     return true;
 }
 
-// Backup data to a file
-bool App2::backupData(const std::string &filePath)
+// Replace activities and goals with the state recorded by the backup set at
+// filePath: its full backup followed by every incremental one. Activities
+// are saved like any full save, compressed if the live file is, with their
+// checksums, snapshot and ID index.
+bool App2::restoreData(const std::string &filePath)
 {
-    // Backup activities
-    std::ifstream activitiesInFile(activitiesFilename);
-    std::ofstream activitiesOutFile(filePath + "_activities.csv");
-
-    if (!activitiesInFile.is_open())
+    FileLock activitiesLock;
+    FileLock goalsLock;
+    if (!activitiesLock.lock(writerLockPathFor(activitiesFilename), LockMode::EXCLUSIVE) ||
+        !goalsLock.lock(writerLockPathFor(goalsFilename), LockMode::EXCLUSIVE))
     {
-        std::cerr << "Error: Could not open activities file for reading." << std::endl;
+        std::cerr << "Error: Could not lock the data files for writing." << std::endl;
         return false;
     }
 
-    if (!activitiesOutFile.is_open())
+    // Nothing is replaced unless the whole chain checks out
+    ActivityStore<Activity> restored;
+    bool rowsValid = true;
+    std::vector<BackupGoal> goalRows;
+    BackupSummary summary;
+    bool chainValid = readBackup(filePath, [&restored, &rowsValid](const char *begin, const char *end)
+    {
+        // The set may have been written by a front end with type names
+        CsvDialect dialect = detectDialect(begin, end, CODE_DIALECT);
+        dialect.hasHeader = false;
+        forEachActivityRow(begin, end, dialect, [&restored](const ActivityRow &row)
+        {
+            restored.push_back(activityFromRow<Activity>(row));
+            return true;
+        },
+        [&rowsValid](const char *, const char *)
+        {
+            rowsValid = false;
+        });
+    }, goalRows, summary);
+    if (!chainValid || !rowsValid)
     {
-        std::cerr << "Error: Could not open backup file for writing." << std::endl;
-        activitiesInFile.close();
+        std::cerr << "Error: Backup " << filePath << " is missing or damaged; nothing was restored." << std::endl;
         return false;
     }
 
-    activitiesOutFile << activitiesInFile.rdbuf();
-
-    activitiesInFile.close();
-    activitiesOutFile.close();
-
-    // Backup goals
-    std::ifstream goalsInFile(goalsFilename);
-    std::ofstream goalsOutFile(filePath + "_goals.csv");
-
-    if (!goalsInFile.is_open())
+    // The restored files hold everything, so the journal and tombstones go
+    if (!saveActivitiesToFile(activitiesFilename, CODE_DIALECT, restored))
     {
-        std::cerr << "Error: Could not open goals file for reading." << std::endl;
+        std::cerr << "Error: Could not write " << activitiesFilename << "." << std::endl;
         return false;
     }
-
-    if (!goalsOutFile.is_open())
+    BufferedWriter goalsOutFile;
+    if (!goalsOutFile.open(goalsFilename))
     {
-        std::cerr << "Error: Could not open backup goals file for writing." << std::endl;
-        goalsInFile.close();
+        std::cerr << "Error: Could not open " << goalsFilename << " for writing." << std::endl;
         return false;
     }
+    for (const BackupGoal &goalRow : goalRows)
+    {
+        goalsOutFile.write(goalRow.row);
+        goalsOutFile.put('\n');
+    }
+    {
+        FileLock publish;
+        publish.lock(publishLockPathFor(goalsFilename), LockMode::EXCLUSIVE);
+        if (!goalsOutFile.close() || !removeTombstones(tombstonePathFor(goalsFilename)))
+        {
+            std::cerr << "Error: Could not write " << goalsFilename << "." << std::endl;
+            return false;
+        }
+    }
+    activitiesLoaded = false;
+    goalsLoaded = false;
 
-    goalsOutFile << goalsInFile.rdbuf();
-
-    goalsInFile.close();
-    goalsOutFile.close();
-
-    std::cout << "Data backed up successfully to:" << std::endl;
-    std::cout << "- " << filePath + "_activities.csv" << std::endl;
-    std::cout << "- " << filePath + "_goals.csv" << std::endl;
+    std::cout << "Restored " << summary.backups << " backup(s) from " << backupManifestPathFor(filePath) << ":" << std::endl;
+    std::cout << "- Activities: " << summary.activities << std::endl;
+    std::cout << "- Goals: " << summary.goals << std::endl;
 
     return true;
 }
 
-// Load activities from file
-void App2::loadActivities()
+// Load activities the first time they are needed
+void App2::ensureActivitiesLoaded()
 {
-    activities.clear();
-    std::ifstream inFile(activitiesFilename);
-
-    if (!inFile.is_open())
+    if (!activitiesLoaded)
     {
-        std::cerr << "Warning: Could not open file " << activitiesFilename << " for reading. Starting with empty activities list." << std::endl;
-        return;
+        loadActivities();
+        activitiesLoaded = true;
     }
+}
 
-    std::string line;
-    while (std::getline(inFile, line))
+// Load goals the first time they are needed
+void App2::ensureGoalsLoaded()
+{
+    if (!goalsLoaded)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> segmentList;
-
-        while (std::getline(ss, segment, ','))
-        {
-            segmentList.push_back(segment);
-        }
-
-        if (segmentList.size() >= 5)
-        {
-            try
-            {
-                int typeInt = std::stoi(segmentList[0]);
-                ActivityType type = static_cast<ActivityType>(typeInt);
-                std::string date = segmentList[1];
-                double duration = std::stod(segmentList[2]);
-                double distance = std::stod(segmentList[3]);
-                int repetitions = std::stoi(segmentList[4]);
-
-                Activity activity(type, date, duration, distance, repetitions);
-                activities.push_back(activity);
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
-            }
-        }
+        loadGoals();
+        goalsLoaded = true;
     }
-
-    inFile.close();
 }
 
-// Load goals from file
-void App2::loadGoals()
+// Become the only writer of goals until this object goes away. Goals are
+// loaded under the lock, replacing any loaded before it.
+bool App2::lockGoalsForWrite()
 {
-    goals.clear();
-    std::ifstream inFile(goalsFilename);
-
-    if (!inFile.is_open())
+    if (goalsWriteLock.isLocked())
     {
-        std::cerr << "Warning: Could not open file " << goalsFilename << " for reading. Starting with empty goals list." << std::endl;
-        return;
+        return true;
     }
+    if (!goalsWriteLock.lock(writerLockPathFor(goalsFilename), LockMode::EXCLUSIVE))
+    {
+        std::cerr << "Error: Could not lock " << goalsFilename << " for writing." << std::endl;
+        return false;
+    }
+    loadGoals();
+    goalsLoaded = true;
+    return true;
+}
 
-    std::string line;
-    while (std::getline(inFile, line))
+// Load activities from file, then replay the journal on top (see
+// activity_file.h)
+void App2::loadActivities()
+{
+    auto onInvalid = [](const char *lineBegin, const char *lineEnd)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> segmentList;
+        std::cerr << "Error parsing line: " << std::string(lineBegin, lineEnd) << std::endl;
+    };
+    auto onDamaged = [this](uint64_t firstByte, uint64_t endByte, size_t rows)
+    {
+        std::cerr << "Error: " << activitiesFilename << " is damaged at bytes " << firstByte << "-" << endByte
+                  << "; " << rows << " rows could not be read." << std::endl;
+    };
 
-        while (std::getline(ss, segment, ','))
-        {
-            segmentList.push_back(segment);
-        }
+    if (!loadActivitiesFromFiles(activitiesFilename, CODE_DIALECT, activities, onInvalid, onDamaged))
+    {
+        std::cerr << "Warning: Could not open file " << activitiesFilename << " for reading. Starting with empty activities list." << std::endl;
+    }
+}
 
-        if (segmentList.size() >= 7)
+// Load the live goals; deleted ones are skipped via their tombstones
+void App2::loadGoals()
+{
+    goals.clear();
+    goalText.clear();
+    GoalFileStats stats;
+    if (!forEachLiveGoal(goalsFilename, stats, [this, &stats](const GoalRow &row)
+    {
+        if (goals.empty())
         {
-            try
-            {
-                int typeInt = std::stoi(segmentList[0]);
-                ActivityType type = static_cast<ActivityType>(typeInt);
-                std::string description = segmentList[1];
-                std::string deadline = segmentList[2];
-                int targetReps = std::stoi(segmentList[3]);
-                double targetDuration = std::stod(segmentList[4]);
-                double targetDistance = std::stod(segmentList[5]);
-                bool achieved = (segmentList[6] == "1");
-
-                Goal goal(type, description, deadline, targetDistance, targetDuration, targetReps);
-                goal.achieved = achieved;
-                goals.push_back(goal);
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Error parsing line: " << line << " - " << e.what() << std::endl;
-            }
+            goals.reserve(stats.lines);
         }
+        Goal goal(static_cast<ActivityType>(row.type), goalText.intern(row.description, row.descriptionLength),
+                  row.deadline, row.targetDistance, row.targetDuration,
+                  row.targetReps);
+        goal.id = row.id;
+        goal.achieved = row.achieved;
+        goals.push_back(std::move(goal));
+    },
+    [](const char *lineBegin, const char *lineEnd)
+    {
+        std::cerr << "Error parsing line: " << std::string(lineBegin, lineEnd) << std::endl;
+    }))
+    {
+        std::cerr << "Warning: Could not open file " << goalsFilename << " for reading. Starting with empty goals list." << std::endl;
     }
+    deadGoalRows = stats.deadRows;
+    nextGoalId = stats.nextId;
+    indexRecordIds(goals, goalPositions);
+}
 
-    inFile.close();
+// Position of the goal with the given ID in goals, or -1, in constant time
+int App2::findGoal(int goalId)
+{
+    auto found = goalPositions.find(goalId);
+    return found == goalPositions.end() ? -1 : static_cast<int>(found->second);
 }
 
 // Helper to get activity type name
@@ -531,71 +569,21 @@ std::string App2::getActivityTypeName(ActivityType type)
 }
 
 // Validate date format (YYYY-MM-DD)
-bool App2::isDateValid(const std::string &date)
+bool App2::isDateValid(Date date)
 {
-    if (date.length() != 10)
-        return false;
-    if (date[4] != '-' || date[7] != '-')
-        return false;
-
-    try
-    {
-        int year = std::stoi(date.substr(0, 4));
-        int month = std::stoi(date.substr(5, 2));
-        int day = std::stoi(date.substr(8, 2));
-
-        if (year < 1900 || year > 2100)
-            return false;
-        if (month < 1 || month > 12)
-            return false;
-        if (day < 1 || day > 31)
-            return false;
-
-        // Check days in month (simplified)
-        if (month == 2)
-        {
-            bool isLeapYear = (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
-            if (day > (isLeapYear ? 29 : 28))
-                return false;
-        }
-        else if (month == 4 || month == 6 || month == 9 || month == 11)
-        {
-            if (day > 30)
-                return false;
-        }
-
-        return true;
-    }
-    catch (...)
-    {
-        return false;
-    }
+    return date.isValid() && date >= Date::fromCivil(1900, 1, 1) && date <= Date::fromCivil(2100, 12, 31);
 }
 
 // Check if date is in range
-bool App2::isDateInRange(const std::string &date, const std::string &startDate, const std::string &endDate)
+bool App2::isDateInRange(Date date, Date startDate, Date endDate)
 {
-    return (date.compare(startDate) >= 0 && date.compare(endDate) <= 0);
+    return date >= startDate && date <= endDate;
 }
 
 // Calculate days between two dates
-int App2::calculateDaysBetween(const std::string &dateStart, const std::string &dateEnd)
+int App2::calculateDaysBetween(Date dateStart, Date dateEnd)
 {
-    std::tm tmStart = {}, tmEnd = {};
-    std::istringstream ssStart(dateStart), ssEnd(dateEnd);
-
-    ssStart >> std::get_time(&tmStart, "%Y-%m-%d");
-    ssEnd >> std::get_time(&tmEnd, "%Y-%m-%d");
-
-    if (ssStart.fail() || ssEnd.fail())
-    {
-        return -1; // Error in parsing
-    }
-
-    std::time_t timeStart = std::mktime(&tmStart);
-    std::time_t timeEnd = std::mktime(&tmEnd);
-
-    return static_cast<int>(std::difftime(timeEnd, timeStart) / (60 * 60 * 24));
+    return dateEnd - dateStart;
 }
 
 // Format duration in minutes to hours and minutes
@@ -2,14 +2,15 @@
 #define APP_2_H
 
 #include "app_1.h" // We'll share the same data structures
+#include "activity_store.h"
 #include <string>
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 class App2
 {
 public:
-    App2();
+    explicit App2(int needs = NEED_ALL);
     ~App2();
 
     // Statistics functions
@@ -23,23 +24,36 @@ public:
     bool deleteGoal(int goalId);
 
     // Data backup
-    bool backupData(const std::string &filePath);
+    bool backupData(const std::string &filePath, bool full = false);
+    bool restoreData(const std::string &filePath);
 
 private:
-    std::vector<Activity> activities;
+    ActivityStore<Activity> activities;
     std::vector<Goal> goals;
     const std::string activitiesFilename = "activities_cpp.csv";
     const std::string goalsFilename = "activities_goals_cpp.csv";
+    bool activitiesLoaded = false;
+    bool goalsLoaded = false;
+    FileLock goalsWriteLock; // Held from the first change to exit
+    size_t deadGoalRows = 0; // Deleted goals still in the goals file
+    int nextGoalId = 0;
+    std::unordered_map<int, size_t> goalPositions; // Goal ID -> position in goals
+    StringPool goalText; // Goal descriptions, each distinct one stored once
 
     // File operations
+    void ensureActivitiesLoaded();
+    void ensureGoalsLoaded();
+    bool lockGoalsForWrite();
     void loadActivities();
     void loadGoals();
+    bool compactGoals();
 
     // Helper functions
+    int findGoal(int goalId);
     std::string getActivityTypeName(ActivityType type);
-    bool isDateValid(const std::string &date);
-    bool isDateInRange(const std::string &date, const std::string &startDate, const std::string &endDate);
-    int calculateDaysBetween(const std::string &dateStart, const std::string &dateEnd);
+    bool isDateValid(Date date);
+    bool isDateInRange(Date date, Date startDate, Date endDate);
+    int calculateDaysBetween(Date dateStart, Date dateEnd);
     std::string formatDuration(double minutes);
 
     // Visualization helpers
@@ -1,4 +1,5 @@
 #include "app_2.h"
+#include "io_stats.h"
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -10,7 +11,23 @@ void printUsage()
     std::cout << "./app_2 filter_statistics <activity ID> <goal ID>" << std::endl;
     std::cout << "./app_2 view_progress <goal ID>" << std::endl;
     std::cout << "./app_2 delete_goal <goal ID>" << std::endl;
-    std::cout << "./app_2 backup <file path>" << std::endl;
+    std::cout << "./app_2 backup <file path> [--full]" << std::endl;
+    std::cout << "./app_2 restore <file path>" << std::endl;
+}
+
+// Collections each command reads; backup and restore go through the files
+// and delete_goal loads goals once it holds the goals lock
+int dataNeededBy(const std::string &command)
+{
+    if (command == "view_statistics")
+    {
+        return NEED_ACTIVITIES;
+    }
+    if (command == "filter_statistics" || command == "view_progress")
+    {
+        return NEED_ALL;
+    }
+    return NEED_NONE;
 }
 
 int main(int argc, char *argv[])
@@ -22,10 +39,11 @@ int main(int argc, char *argv[])
     }
 
     std::string command = argv[1];
-    App2 app;
-
     try
     {
+        // Loading can throw as well, so the app is made inside the try
+        App2 app(dataNeededBy(command));
+
         if (command == "view_statistics")
         {
             app.viewStatistics();
@@ -77,7 +95,20 @@ int main(int argc, char *argv[])
             }
 
             std::string filePath = argv[2];
-            app.backupData(filePath);
+            bool full = argc >= 4 && std::string(argv[3]) == "--full";
+            app.backupData(filePath, full);
+        }
+        else if (command == "restore")
+        {
+            if (argc < 3)
+            {
+                std::cout << "Missing file path." << std::endl;
+                printUsage();
+                return 1;
+            }
+
+            std::string filePath = argv[2];
+            app.restoreData(filePath);
         }
         else
         {
@@ -85,6 +116,8 @@ int main(int argc, char *argv[])
             printUsage();
             return 1;
         }
+
+        std::cerr << "Bytes written: " << bytesWritten() << " in " << writeSeconds() * 1000.0 << " ms" << std::endl;
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,100 @@
+// Measures how fast data files can be verified against their block
+// checksums: CRC-32C with the crc32 instruction (where the CPU has SSE4.2)
+// and with the portable tables, over 4 KiB blocks as in <file>.crc. With a
+// data file argument it also times the full check a loader runs on it.
+//
+// Usage: ./checksum_bench [megabytes] [data file]
+#include "block_checksums.h"
+#include "checksum.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    typedef uint32_t (*Crc32cFunction)(const void *, size_t, uint32_t);
+
+    // Checksum the buffer block by block, as verification does
+    uint32_t checksumBlocks(const std::vector<char> &data, Crc32cFunction checksum)
+    {
+        uint32_t combined = 0;
+        for (size_t first = 0; first < data.size(); first += CHECKSUM_BLOCK_BYTES)
+        {
+            size_t length = std::min<size_t>(CHECKSUM_BLOCK_BYTES, data.size() - first);
+            combined ^= checksum(data.data() + first, length, 0);
+        }
+        return combined;
+    }
+
+    void run(const char *label, const std::vector<char> &data, Crc32cFunction checksum)
+    {
+        checksumBlocks(data, checksum); // Warm up caches and page mappings
+
+        const int passes = 5;
+        uint32_t result = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            result ^= checksumBlocks(data, checksum);
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(stop - start).count() / passes;
+        std::cout << label << ": " << data.size() / (1 << 20) << " MiB in " << seconds * 1000.0 << " ms ("
+                  << static_cast<double>(data.size()) / seconds / 1e9 << " GB/s, result " << std::hex << result
+                  << std::dec << ")" << std::endl;
+    }
+
+    uint32_t crc32cDispatched(const void *data, size_t length, uint32_t crc)
+    {
+        return crc32c(data, length, crc);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t megabytes = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 256;
+    std::vector<char> data(megabytes << 20);
+    uint32_t state = 2463534242u;
+    for (char &byte : data)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        byte = static_cast<char>(state);
+    }
+
+    run(crc32cUsesHardware() ? "crc32c (SSE4.2)" : "crc32c (tables, no SSE4.2)", data, crc32cDispatched);
+    run("crc32c (tables)", data, crc32cPortable);
+
+    if (argc > 2)
+    {
+        std::string dataPath = argv[2];
+        MappedFile file;
+        if (!file.open(dataPath))
+        {
+            std::cerr << "Error: Could not open file " << dataPath << " for reading." << std::endl;
+            return 1;
+        }
+
+        std::vector<TextRange> damaged;
+        auto start = std::chrono::steady_clock::now();
+        bool checked = findDamagedRanges(dataPath, file, damaged);
+        auto stop = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        if (!checked)
+        {
+            std::cout << dataPath << ": no up-to-date checksums (" << blockChecksumPathFor(dataPath) << ")" << std::endl;
+            return 0;
+        }
+        std::cout << dataPath << ": " << file.size() << " bytes verified in " << seconds * 1000.0 << " ms ("
+                  << static_cast<double>(file.size()) / seconds / 1e9 << " GB/s), " << damaged.size()
+                  << " damaged ranges" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Compares the stringstream/std::stod row parser the loaders used to run
+// with the allocation-free field parser in storage/.
+//
+// Usage: ./parser_bench [rows]
+#include "app_1.h"
+#include "activity_csv.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Build a synthetic activities file in memory
+    std::string makeRows(size_t rows)
+    {
+        std::ostringstream out;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            out << (i % 5) << ",20" << (10 + i % 15) << "-0" << (1 + i % 9) << "-1" << (i % 10) << ","
+                << (20 + i % 90) << "." << (i % 10) << ","
+                << (i % 30) << ".2" << (i % 10) << ","
+                << (i % 5 == 4 ? 10 + i % 40 : 0) << "\n";
+        }
+        return out.str();
+    }
+
+    // The per-line parser App1/App2 used before storage/
+    size_t parseLegacy(const std::string &text, std::vector<Activity> &activities)
+    {
+        std::istringstream inFile(text);
+        std::string line;
+        while (std::getline(inFile, line))
+        {
+            std::stringstream ss(line);
+            std::string segment;
+            std::vector<std::string> segmentList;
+
+            while (std::getline(ss, segment, ','))
+            {
+                segmentList.push_back(segment);
+            }
+
+            if (segmentList.size() >= 5)
+            {
+                try
+                {
+                    activities.push_back(Activity(static_cast<ActivityType>(std::stoi(segmentList[0])), Date::parse(segmentList[1]),
+                                                  std::stod(segmentList[2]), std::stod(segmentList[3]),
+                                                  std::stoi(segmentList[4])));
+                }
+                catch (const std::exception &)
+                {
+                }
+            }
+        }
+        return activities.size();
+    }
+
+    size_t parseFields(const std::string &text, std::vector<Activity> &activities)
+    {
+        const char *begin = text.data();
+        const char *end = begin + text.size();
+        activities.reserve(countLines(begin, end));
+        forEachLine(begin, end, [&activities](const char *lineBegin, const char *lineEnd)
+        {
+            ActivityRow row;
+            if (parseActivityRow(lineBegin, lineEnd, row) == RowStatus::OK)
+            {
+                activities.emplace_back(static_cast<ActivityType>(row.type), row.date,
+                                        row.duration, row.distance, row.repetitions);
+            }
+        });
+        return activities.size();
+    }
+
+    template <typename Parser>
+    void run(const char *label, const std::string &text, Parser parser)
+    {
+        std::vector<Activity> activities;
+        auto start = std::chrono::steady_clock::now();
+        size_t rows = parser(text, activities);
+        auto stop = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(stop - start).count();
+        std::cout << label << ": " << rows << " rows in " << seconds * 1000.0 << " ms ("
+                  << static_cast<long long>(rows / seconds) << " rows/sec)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rows = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 1000000;
+    std::string text = makeRows(rows);
+
+    run("stringstream + stoi/stod", text, parseLegacy);
+    run("field parser", text, parseFields);
+    return 0;
+}
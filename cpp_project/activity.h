@@ -1,6 +1,7 @@
 #ifndef ACTIVITY_H
 #define ACTIVITY_H
 
+#include "date.h"
 #include <string>
 #include <vector>
 
@@ -19,14 +20,14 @@ enum class ActivityType
 struct Activity
 {
     ActivityType type = ActivityType::UNKNOWN;
-    std::string date = ""; // Format: YYYY-MM-DD
+    Date date;
     double duration = 0.0; // in minutes (using double for potentially better precision)
     double distance = 0.0; // in kilometers
     int repetitions = 0;   // for strength activities
 
     // Optional: Constructor for easier creation
-    Activity(ActivityType t, std::string d, double dur, double dist = 0.0, int reps = 0)
-        : type(t), date(std::move(d)), duration(dur), distance(dist), repetitions(reps) {}
+    Activity(ActivityType t, Date d, double dur, double dist = 0.0, int reps = 0)
+        : type(t), date(d), duration(dur), distance(dist), repetitions(reps) {}
 
     // Default constructor
     Activity() = default;
@@ -39,15 +40,15 @@ struct Goal
     double targetDistance = 0.0;  // in kilometers
     double targetDuration = 0.0;  // in minutes
     int targetReps = 0;           // for strength activities
-    std::string deadline = "";    // Format: YYYY-MM-DD
+    Date deadline;
     std::string description = ""; // User-friendly description
     bool achieved = false;
 
     // Constructor
-    Goal(ActivityType t, std::string desc, std::string dl,
+    Goal(ActivityType t, std::string desc, Date dl,
          double dist = 0.0, double dur = 0.0, int reps = 0)
         : type(t), targetDistance(dist), targetDuration(dur),
-          targetReps(reps), deadline(std::move(dl)),
+          targetReps(reps), deadline(dl),
           description(std::move(desc)), achieved(false) {}
 
     // Default constructor
@@ -1,11 +1,21 @@
 #include "tracker.h"
+#include "mapped_file.h"
+#include "activity_csv.h"
+#include "activity_file.h"
+#include "field_parser.h"
+#include "fixed_point.h"
+#include "parallel_parse.h"
+#include "io_stats.h"
+#include "buffered_writer.h"
+#include "archive.h"
+#include "block_checksums.h"
+#include "goal_file.h"
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <limits>
 #include <iomanip> // For std::setw, std::left, std::fixed, std::setprecision
-#include <ctime>
 #include <cstdlib>   // For system()
+#include <cstdio>    // For std::remove
 #include <map>       // For statistics calculation
 #include <numeric>   // For std::accumulate
 #include <algorithm> // For std::sort, std::max_element, etc.
@@ -13,6 +23,7 @@
 #include <regex>     // For regex matching in search
 #include <chrono>    // For time-based operations
 #include <set>       // For unique collections
+#include <iterator>  // For std::back_inserter
 
 // Constructor
 Tracker::Tracker(const std::string &filename) : dataFilename(filename)
@@ -29,16 +40,29 @@ Tracker::Tracker(const std::string &filename) : dataFilename(filename)
         goalsFilename += "_goals.csv";
     }
 
+    // A restore cut short by a crash is finished before anything is read
+    if (!finishExtraction(restoreListPathFor(dataFilename)))
+    {
+        std::cerr << COLOR_RED << "Warning: Could not finish the restore recorded in \'"
+                  << restoreListPathFor(dataFilename) << "\'." << COLOR_RESET << std::endl;
+    }
+
     loadFromFile();
     loadGoalsFromFile();
     checkGoalAchievements(); // Check if any goals have been achieved
 }
 
-// Destructor (RAII for file saving)
+// Destructor (RAII for file saving); untouched files are left alone
 Tracker::~Tracker()
 {
-    saveToFile();
-    saveGoalsToFile();
+    if (activitiesDirty)
+    {
+        saveToFile();
+    }
+    if (goalsDirty)
+    {
+        saveGoalsToFile();
+    }
 }
 
 // --- Main Application Logic ---
@@ -55,7 +79,7 @@ void Tracker::run()
         {
             clearScreen();
             displayMainMenu();
-            option = getIntegerInput("Enter option: ", 0, 9); // Updated for more menu items
+            option = getIntegerInput("Enter option: ", 0, 11); // Updated for more menu items
 
             switch (option)
             {
@@ -68,6 +92,8 @@ void Tracker::run()
             case 7: // Set new goal
             case 8: // View goals
             case 9: // Backup data
+            case 10: // Restore from backup
+            case 11: // Storage layout
                 inSubmenu = true;
                 submenuType = option;
                 break;
@@ -148,6 +174,14 @@ void Tracker::run()
                 backupData();
                 inSubmenu = false;
                 break;
+            case 10: // Restore From Backup
+                restoreFromBackup();
+                inSubmenu = false;
+                break;
+            case 11: // Storage Layout
+                changeStorageLayout();
+                inSubmenu = false;
+                break;
             }
         }
     } while (option != 0);
@@ -173,6 +207,8 @@ void Tracker::displayMainMenu()
     std::cout << "  8 - View Goals & Achievements" << std::endl;
     std::cout << COLOR_YELLOW << "SYSTEM:" << COLOR_RESET << std::endl;
     std::cout << "  9 - Backup Data" << std::endl;
+    std::cout << "  10 - Restore From Backup" << std::endl;
+    std::cout << "  11 - Storage Layout" << std::endl;
     std::cout << "  0 - Exit" << std::endl;
     std::cout << "===================================" << std::endl;
 }
@@ -239,18 +275,22 @@ void Tracker::addActivity(ActivityType type)
     Activity newActivity;
     newActivity.type = type;
 
-    std::string defaultDate = getCurrentDate();
-    newActivity.date = getDateInput("Date (YYYY-MM-DD)", defaultDate);
-    // TODO: Add more robust date format validation if desired
+    newActivity.date = getDateInput("Date (YYYY-MM-DD)", getCurrentDate());
+    std::string partitionKey = partitionKeyFor(catalog.scheme, newActivity.date);
+    if (reportIfDamaged(catalog.scheme == PartitionScheme::NONE ? dataFilename : partitionPathFor(dataFilename, partitionKey)))
+    {
+        waitForEnter();
+        return;
+    }
 
-    newActivity.duration = getDoubleInput("Duration (minutes, > 0): ", 0.0, false);
+    newActivity.duration = getDoubleInput("Duration (minutes, > 0): ", 0.0, false, MAX_DURATION_MINUTES);
 
     switch (type)
     {
     case ActivityType::RUNNING:
     case ActivityType::WALKING:
     case ActivityType::SWIMMING:
-        newActivity.distance = getDoubleInput("Distance (kilometers, >= 0): ", 0.0, true);
+        newActivity.distance = getDoubleInput("Distance (kilometers, >= 0): ", 0.0, true, MAX_DISTANCE_KILOMETRES);
         break;
     case ActivityType::STRENGTH:
         newActivity.repetitions = getIntegerInput("Number of repetitions (>= 0): ", 0, 100000);
@@ -261,7 +301,16 @@ void Tracker::addActivity(ActivityType type)
         break;
     }
 
-    activities.push_back(newActivity); // Add to the vector
+    if (catalog.scheme == PartitionScheme::NONE)
+    {
+        activities.push_back(newActivity); // Add to the vector
+        activitiesDirty = true;
+    }
+    else if (!appendToPartition(partitionKey, newActivity))
+    {
+        waitForEnter();
+        return;
+    }
 
     std::cout << std::endl
               << COLOR_GREEN << getActivityTypeName(type) << " activity added successfully!" << COLOR_RESET << std::endl;
@@ -270,6 +319,7 @@ void Tracker::addActivity(ActivityType type)
 
 void Tracker::viewActivities()
 {
+    ensureActivitiesLoaded();
     std::cout << "===================================" << std::endl;
     std::cout << "        " << COLOR_YELLOW << "VIEW ACTIVITIES" << COLOR_RESET << std::endl;
     std::cout << "===================================" << std::endl;
@@ -329,6 +379,7 @@ void Tracker::viewActivities()
 
 void Tracker::viewStatistics()
 {
+    ensureActivitiesLoaded();
     std::cout << "===================================" << std::endl;
     std::cout << "        " << COLOR_YELLOW << "VIEW STATISTICS" << COLOR_RESET << std::endl;
     std::cout << "===================================" << std::endl;
@@ -340,20 +391,8 @@ void Tracker::viewStatistics()
         return;
     }
 
-    // Use a map to aggregate statistics by type
-    std::map<ActivityType, int> counts;
-    std::map<ActivityType, double> totalDurations;
-    std::map<ActivityType, double> totalDistances;
-
-    for (const auto &act : activities)
-    {
-        counts[act.type]++;
-        totalDurations[act.type] += act.duration;
-        if (act.type == ActivityType::RUNNING || act.type == ActivityType::WALKING || act.type == ActivityType::SWIMMING)
-        {
-            totalDistances[act.type] += act.distance;
-        }
-    }
+    // Aggregate statistics by type in one pass over the numeric columns
+    TypeTotals totals = totalByType(activities.columns());
 
     std::cout << std::left
               << std::setw(18) << "Activity Type" << " | "
@@ -369,10 +408,11 @@ void Tracker::viewStatistics()
 
     for (ActivityType type : typesInOrder)
     {
-        if (counts.count(type))
+        const ActivityTotals &total = totals[static_cast<size_t>(type)];
+        if (total.count > 0)
         { // Check if this type exists in our recorded activities
-            int count = counts[type];
-            double avgDuration = totalDurations[type] / count;
+            uint64_t count = total.count;
+            double avgDuration = total.minutes() / count;
 
             std::cout << std::left
                       << std::setw(18) << getActivityTypeName(type) << " | "
@@ -381,7 +421,7 @@ void Tracker::viewStatistics()
 
             if (type == ActivityType::RUNNING || type == ActivityType::WALKING || type == ActivityType::SWIMMING)
             {
-                double avgDistance = totalDistances[type] / count;
+                double avgDistance = total.kilometres() / count;
                 std::cout << std::setprecision(2) << std::setw(12) << avgDistance << std::setprecision(1);
             }
             else
@@ -398,227 +438,494 @@ void Tracker::viewStatistics()
 
 // --- File I/O ---
 
-void Tracker::loadFromFile()
+namespace
 {
-    std::ifstream inFile(dataFilename);
-    if (!inFile.is_open())
+    // Activities and error messages parsed from one chunk of the data file
+    struct LoadChunk
     {
-        // File not existing is not an error on first run
-        // std::cerr << "Warning: Could not open file " << dataFilename << " for reading." << std::endl;
-        return;
+        ActivityStore<Activity> activities;
+        std::vector<std::string> errors;
+    };
+
+    // Parse the CODE_DIALECT rows of one chunk (see activity_csv.h)
+    void parseChunk(const char *begin, const char *end, LoadChunk &chunk)
+    {
+        chunk.activities.reserve(countLines(begin, end));
+        forEachActivityRow(begin, end, CODE_DIALECT, [&chunk](const ActivityRow &row)
+        {
+            chunk.activities.push_back(activityFromRow<Activity>(row));
+            return true;
+        },
+        [&chunk](const char *lineBegin, const char *lineEnd)
+        {
+            chunk.errors.push_back("Error reading line: " + std::string(lineBegin, lineEnd));
+        });
     }
 
-    std::string line;
-    while (std::getline(inFile, line))
+    // Activities and messages read from one data file
+    struct FileLoad
     {
-        std::stringstream ss(line);
-        std::string segment;
-        Activity loadedActivity;
-        int typeIndex = -1;
+        std::vector<LoadChunk> chunks;
+        std::vector<std::string> damage; // One message per damaged range
+    };
 
-        try
+    // Read a data file, leaving out rows in blocks that fail their checksum;
+    // a partition, which is always saved with checksums, is damaged as a
+    // whole without them, and its journal is replayed after it. With
+    // splitLines the rest is split at line boundaries and parsed on all
+    // cores; chunks come back in file order so row order matches a serial
+    // load. Returns false if the file does not exist.
+    bool loadDataFile(const std::string &path, bool splitLines, bool partition, FileLoad &load)
+    {
+        MappedFile inFile;
+        if (!inFile.open(path))
         {
-            // 1. Type
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> typeIndex))
+            return false;
+        }
+
+        std::vector<TextRange> damaged;
+        findDamagedRanges(path, inFile, damaged, partition);
+        for (const TextRange &range : intactRanges(inFile.begin(), inFile.end(), damaged))
+        {
+            if (splitLines)
             {
-                throw std::runtime_error("Failed to parse type");
+                std::vector<LoadChunk> rangeChunks = parseInParallel<LoadChunk>(range.begin, range.end, parseChunk);
+                std::move(rangeChunks.begin(), rangeChunks.end(), std::back_inserter(load.chunks));
             }
-            if (typeIndex < 0 || typeIndex > static_cast<int>(ActivityType::STRENGTH))
+            else
             {
-                typeIndex = static_cast<int>(ActivityType::UNKNOWN);
+                load.chunks.emplace_back();
+                parseChunk(range.begin, range.end, load.chunks.back());
             }
-            loadedActivity.type = static_cast<ActivityType>(typeIndex);
+        }
+        MappedFile journal;
+        if (partition && journal.open(journalPathFor(path)))
+        {
+            // A record torn by a crash is left out
+            load.chunks.emplace_back();
+            parseChunk(journal.begin(), completeLinesEnd(journal.begin(), journal.end()), load.chunks.back());
+        }
+        for (const TextRange &range : damaged)
+        {
+            std::ostringstream message;
+            message << "Error: " << path << " is damaged at bytes " << (range.begin - inFile.begin()) << "-"
+                    << (range.end - inFile.begin()) << "; skipped " << countLines(range.begin, range.end) << " rows.";
+            load.damage.push_back(message.str());
+        }
+        return true;
+    }
 
-            // 2. Date
-            if (!std::getline(ss, loadedActivity.date, ','))
-            {
-                throw std::runtime_error("Failed to parse date");
-            }
+    // Report the errors of a load and move its activities to the end of into
+    void appendLoaded(FileLoad &load, ActivityStore<Activity> &into)
+    {
+        size_t total = into.size();
+        for (const LoadChunk &chunk : load.chunks)
+        {
+            total += chunk.activities.size();
+        }
+        into.reserve(total);
 
-            // 3. Duration
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedActivity.duration))
+        for (LoadChunk &chunk : load.chunks)
+        {
+            for (const std::string &error : chunk.errors)
             {
-                throw std::runtime_error("Failed to parse duration");
+                std::cerr << COLOR_RED << error << COLOR_RESET << std::endl;
             }
+            into.append(chunk.activities);
+        }
+        for (const std::string &message : load.damage)
+        {
+            std::cerr << COLOR_RED << message << COLOR_RESET << std::endl;
+        }
+    }
 
-            // 4. Distance
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedActivity.distance))
-            {
-                throw std::runtime_error("Failed to parse distance");
-            }
+    // Day number of a date, or fallback if it is invalid
+    int32_t dayNumberOr(Date date, int32_t fallback)
+    {
+        return date.isValid() ? date.dayNumber() : fallback;
+    }
 
-            // 5. Repetitions
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedActivity.repetitions))
+    // Latest deadline of the goals, or of the open ones only; the scans
+    // that count activities towards goals need nothing dated after it
+    int32_t latestDeadline(const std::vector<Goal> &goals, bool openOnly)
+    {
+        int32_t latest = std::numeric_limits<int32_t>::min();
+        for (const Goal &goal : goals)
+        {
+            if (!openOnly || !goal.achieved)
             {
-                // If repetitions segment is missing (e.g. older format), default to 0
-                // This check assumes repetitions is the last element. If not, parsing fails here.
-                std::stringstream test_ss(segment);
-                if (!(test_ss >> loadedActivity.repetitions))
-                {
-                    // Check if it was just missing entirely
-                    if (ss.eof())
-                    { // Check if we reached end-of-stream trying to get segment
-                        loadedActivity.repetitions = 0;
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Failed to parse repetitions");
-                    }
-                }
+                latest = std::max(latest, dayNumberOr(goal.deadline, std::numeric_limits<int32_t>::max()));
             }
+        }
+        return latest;
+    }
+
+    // Write one partition of the activities, drop the journal its rows
+    // include and record it in catalog
+    bool writePartition(const std::string &dataPath, const std::string &key, const ActivityStore<Activity> &activities,
+                        const std::vector<size_t> &rows, PartitionCatalog &catalog, uint64_t &bytes, double &seconds)
+    {
+        std::string path = partitionPathFor(dataPath, key);
+        BufferedWriter outFile; // Replaces the file and its checksums on close
+        if (!outFile.open(path, WriteMode::REPLACE_CHECKSUMMED))
+        {
+            return false;
+        }
 
-            activities.push_back(loadedActivity);
+        int32_t firstDay = std::numeric_limits<int32_t>::max();
+        int32_t lastDay = std::numeric_limits<int32_t>::min();
+        for (size_t row : rows)
+        {
+            Activity act = activities[row];
+            writeActivity(outFile, CODE_DIALECT, act);
+            outFile.put('\n');
+            // Undated rows stretch the range to every day
+            firstDay = std::min(firstDay, dayNumberOr(act.date, std::numeric_limits<int32_t>::min()));
+            lastDay = std::max(lastDay, dayNumberOr(act.date, std::numeric_limits<int32_t>::max()));
         }
-        catch (const std::exception &e)
+        if (!outFile.close() || !removeJournal(journalPathFor(path)))
         {
-            std::cerr << COLOR_RED << "Error reading line: " << line << " -> " << e.what() << COLOR_RESET << std::endl;
-            // Optionally skip this line and continue or stop loading
+            return false;
         }
+        recordPartition(dataPath, catalog, key, rows.size(), firstDay, lastDay);
+        bytes += outFile.bytesWritten();
+        seconds += outFile.secondsSpent();
+        return true;
+    }
+}
+
+void Tracker::loadFromFile()
+{
+    // With a catalog the activities are stored by year or month and are
+    // read as commands need them
+    if (loadPartitionCatalog(dataFilename, catalog))
+    {
+        activitiesLoaded = false;
+        std::cout << "Found " << partitionedRowCount(catalog) << " activities in " << catalog.partitions.size()
+                  << " partitions (one per " << partitionSchemeName(catalog.scheme) << ") of \'" << dataFilename
+                  << "\'." << std::endl;
+        waitForEnter();
+        return;
     }
+    activitiesLoaded = true;
+
+    FileLoad load;
+    if (!loadDataFile(dataFilename, true, false, load))
+    {
+        // File not existing is not an error on first run
+        // std::cerr << "Warning: Could not open file " << dataFilename << " for reading." << std::endl;
+        return;
+    }
+    appendLoaded(load, activities);
 
-    // No need to explicitly close inFile, RAII handles it when it goes out of scope
     std::cout << "Loaded " << activities.size() << " activities from \'" << dataFilename << "\'." << std::endl;
     waitForEnter();
 }
 
+// Partitioned activities are written as they are added (see addActivity),
+// so only the single data file is saved here
 void Tracker::saveToFile()
 {
-    std::ofstream outFile(dataFilename); // Opens in truncation mode (overwrites)
-    if (!outFile.is_open())
+    if (reportIfDamaged(dataFilename))
     {
-        std::cerr << COLOR_RED << "Error: Could not open file " << dataFilename << " for writing." << COLOR_RESET << std::endl;
         return;
     }
 
-    // Set precision for floating point numbers in the file
-    outFile << std::fixed << std::setprecision(2);
+    BufferedWriter outFile; // Replaces the file and its checksums on close
+    if (!outFile.open(dataFilename, WriteMode::REPLACE_CHECKSUMMED))
+    {
+        std::cerr << COLOR_RED << "Error: Could not open file " << dataFilename << " for writing." << COLOR_RESET << std::endl;
+        return;
+    }
 
     for (const auto &act : activities)
     {
-        outFile << static_cast<int>(act.type) << ","
-                << act.date << ","
-                << std::setprecision(1) << act.duration << std::setprecision(2) << "," // Duration with 1 decimal
-                << act.distance << ","
-                << act.repetitions << std::endl;
+        writeActivity(outFile, CODE_DIALECT, act);
+        outFile.put('\n');
     }
 
-    // No need to explicitly close outFile, RAII handles it
-    std::cout << "Saved " << activities.size() << " activities to \'" << dataFilename << "\'." << std::endl;
+    if (!outFile.close())
+    {
+        std::cerr << COLOR_RED << "Error: Could not write " << dataFilename << "." << COLOR_RESET << std::endl;
+        return;
+    }
+    activitiesDirty = false;
+    std::cout << "Saved " << activities.size() << " activities to \'" << dataFilename << "\' ("
+              << outFile.bytesWritten() << " bytes in " << outFile.secondsSpent() * 1000.0 << " ms)." << std::endl;
 }
 
-void Tracker::loadGoalsFromFile()
+// True, after saying so, if path fails its checksums. Activities loaded
+// from it lack the damaged rows, so writing them back would lose those rows
+// for good; it stays as it is until it is restored from a backup.
+bool Tracker::reportIfDamaged(const std::string &path)
 {
-    std::ifstream inFile(goalsFilename);
-    if (!inFile.is_open())
+    if (!hasDamagedRanges(path, path != dataFilename))
+    {
+        return false;
+    }
+    std::cerr << COLOR_RED << "Error: " << path << " is damaged; it is not rewritten until it is restored from a backup."
+              << COLOR_RESET << std::endl;
+    return true;
+}
+
+// Read every partition, for commands that need the whole history
+void Tracker::ensureActivitiesLoaded()
+{
+    if (activitiesLoaded)
     {
-        // File not existing is not an error on first run
-        // std::cerr << "Warning: Could not open file " << goalsFilename << " for reading." << std::endl;
         return;
     }
+    std::vector<size_t> all(catalog.partitions.size());
+    std::iota(all.begin(), all.end(), 0);
+    loadPartitions(all, activities);
+    activitiesLoaded = true;
+}
+
+bool Tracker::hasActivities()
+{
+    return activitiesLoaded ? !activities.empty() : !catalog.partitions.empty();
+}
+
+// Activities that may be dated firstDay to lastDay; callers still check
+// each date. Until the whole history is loaded only the partitions that
+// overlap those days are read, into scratch.
+const ActivityStore<Activity> &Tracker::activitiesBetween(int32_t firstDay, int32_t lastDay, ActivityStore<Activity> &scratch)
+{
+    if (activitiesLoaded)
+    {
+        return activities;
+    }
+    loadPartitions(partitionsOverlapping(dataFilename, catalog, firstDay, lastDay), scratch);
+    return scratch;
+}
 
-    std::string line;
-    while (std::getline(inFile, line))
+// Append the given partitions to into, in catalog order. Partitions are
+// read on parallel threads; a lone partition is split across cores instead.
+void Tracker::loadPartitions(const std::vector<size_t> &which, ActivityStore<Activity> &into)
+{
+    std::vector<FileLoad> loads(which.size());
+    bool splitLines = which.size() == 1;
+    runInParallel(which.size(), [this, &which, &loads, splitLines](size_t i)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        Goal loadedGoal;
-        int typeIndex = -1;
+        loadDataFile(partitionPathFor(dataFilename, catalog.partitions[which[i]].key), splitLines, true, loads[i]);
+    });
 
-        try
+    // One reservation for all of them; growing partition by partition
+    // would copy the rows read so far again for every partition
+    size_t total = into.size();
+    for (const FileLoad &load : loads)
+    {
+        for (const LoadChunk &chunk : load.chunks)
         {
-            // 1. Type
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> typeIndex))
-            {
-                throw std::runtime_error("Failed to parse type");
-            }
-            if (typeIndex < 0 || typeIndex > static_cast<int>(ActivityType::STRENGTH))
-            {
-                typeIndex = static_cast<int>(ActivityType::UNKNOWN);
-            }
-            loadedGoal.type = static_cast<ActivityType>(typeIndex);
+            total += chunk.activities.size();
+        }
+    }
+    into.reserve(total);
 
-            // 2. Description
-            if (!std::getline(ss, loadedGoal.description, ','))
-            {
-                throw std::runtime_error("Failed to parse description");
-            }
+    for (FileLoad &load : loads)
+    {
+        appendLoaded(load, into);
+    }
+}
 
-            // 3. Deadline
-            if (!std::getline(ss, loadedGoal.deadline, ','))
-            {
-                throw std::runtime_error("Failed to parse deadline");
-            }
+// Add an activity to the journal of its partition without reading any
+// partition (see partitions.h). The catalog is saved first, so it never
+// lists fewer rows or days than the files hold. A new partition starts as
+// an empty file, and a journal grown past JOURNAL_COMPACT_BYTES is folded
+// into its partition.
+bool Tracker::appendToPartition(const std::string &key, const Activity &activity)
+{
+    std::string path = partitionPathFor(dataFilename, key);
+    int32_t firstDay = dayNumberOr(activity.date, std::numeric_limits<int32_t>::min());
+    int32_t lastDay = dayNumberOr(activity.date, std::numeric_limits<int32_t>::max());
+    PartitionCatalog updated = catalog;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    if (!recordJournaledRow(updated, key, firstDay, lastDay) &&
+        (!writePartition(dataFilename, key, activities, std::vector<size_t>(), updated, bytes, seconds) ||
+         !recordJournaledRow(updated, key, firstDay, lastDay)))
+    {
+        std::cerr << COLOR_RED << "Error: Could not write " << path << "." << COLOR_RESET << std::endl;
+        return false;
+    }
+    if (!savePartitionCatalog(dataFilename, updated))
+    {
+        std::cerr << COLOR_RED << "Error: Could not write " << partitionCatalogPathFor(dataFilename) << "."
+                  << COLOR_RESET << std::endl;
+        return false;
+    }
+    catalog = updated;
 
-            // 4. Target Duration
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedGoal.targetDuration))
-            {
-                throw std::runtime_error("Failed to parse target duration");
-            }
+    std::ostringstream record;
+    writeActivity(record, CODE_DIALECT, activity);
+    std::string journalPath = journalPathFor(path);
+    if (!appendJournalRecord(journalPath, record.str()))
+    {
+        std::cerr << COLOR_RED << "Error: Could not write " << journalPath << "." << COLOR_RESET << std::endl;
+        return false;
+    }
+    if (activitiesLoaded)
+    {
+        activities.push_back(activity);
+    }
 
-            // 5. Target Distance
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedGoal.targetDistance))
-            {
-                throw std::runtime_error("Failed to parse target distance");
-            }
+    if (isJournalCompactionDue(journalPath))
+    {
+        foldPartitionJournal(key);
+    }
+    return true;
+}
+
+// Rewrite a partition with the rows of its journal; only that partition is
+// read
+void Tracker::foldPartitionJournal(const std::string &key)
+{
+    auto position = std::find_if(catalog.partitions.begin(), catalog.partitions.end(),
+                                 [&key](const Partition &partition) { return partition.key == key; });
+    if (position == catalog.partitions.end())
+    {
+        return;
+    }
+    ActivityStore<Activity> rows;
+    loadPartitions(std::vector<size_t>(1, static_cast<size_t>(position - catalog.partitions.begin())), rows);
+    std::vector<size_t> all(rows.size());
+    std::iota(all.begin(), all.end(), 0);
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    if (!writePartition(dataFilename, key, rows, all, catalog, bytes, seconds) ||
+        !savePartitionCatalog(dataFilename, catalog))
+    {
+        std::cerr << COLOR_RED << "Error: Could not fold " << journalPathFor(partitionPathFor(dataFilename, key))
+                  << " into its partition." << COLOR_RESET << std::endl;
+    }
+}
+
+// Write every activity in the given layout and switch to it. The new files
+// are complete before the catalog (or its removal) makes them current, and
+// the old ones are deleted only after that, so an interrupted switch leaves
+// one whole copy of the data.
+bool Tracker::storeActivitiesAs(PartitionScheme scheme)
+{
+    ensureActivitiesLoaded();
+    PartitionCatalog previous = catalog;
+    if (previous.scheme == PartitionScheme::NONE && reportIfDamaged(dataFilename))
+    {
+        return false;
+    }
+    for (const Partition &partition : previous.partitions)
+    {
+        if (reportIfDamaged(partitionPathFor(dataFilename, partition.key)))
+        {
+            return false;
+        }
+    }
+
+    if (scheme == PartitionScheme::NONE)
+    {
+        catalog = PartitionCatalog();
+        activitiesDirty = true;
+        saveToFile();
+        if (activitiesDirty ||
+            (previous.scheme != PartitionScheme::NONE && std::remove(partitionCatalogPathFor(dataFilename).c_str()) != 0))
+        {
+            catalog = previous;
+            return false;
+        }
+    }
+    else
+    {
+        std::map<std::string, std::vector<size_t>> rowsByKey;
+        const std::vector<int32_t> &days = activities.columns().day;
+        for (size_t i = 0; i < days.size(); ++i)
+        {
+            rowsByKey[partitionKeyFor(scheme, Date(days[i]))].push_back(i);
+        }
 
-            // 6. Target Repetitions
-            if (!std::getline(ss, segment, ',') || !(std::stringstream(segment) >> loadedGoal.targetReps))
+        PartitionCatalog next;
+        next.scheme = scheme;
+        uint64_t bytes = 0;
+        double seconds = 0.0;
+        for (const auto &rows : rowsByKey)
+        {
+            if (!writePartition(dataFilename, rows.first, activities, rows.second, next, bytes, seconds))
             {
-                // If repetitions segment is missing (e.g. older format), default to 0
-                // This check assumes repetitions is the last element. If not, parsing fails here.
-                std::stringstream test_ss(segment);
-                if (!(test_ss >> loadedGoal.targetReps))
-                {
-                    // Check if it was just missing entirely
-                    if (ss.eof())
-                    { // Check if we reached end-of-stream trying to get segment
-                        loadedGoal.targetReps = 0;
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Failed to parse target repetitions");
-                    }
-                }
+                return false;
             }
-
-            goals.push_back(loadedGoal);
         }
-        catch (const std::exception &e)
+        if (!savePartitionCatalog(dataFilename, next))
+        {
+            return false;
+        }
+        catalog = next;
+        activitiesDirty = false;
+        std::remove(dataFilename.c_str());
+        std::remove(blockChecksumPathFor(dataFilename).c_str());
+        std::cout << "Saved " << rowsByKey.size() << " partitions of \'" << dataFilename << "\' (" << bytes
+                  << " bytes in " << seconds * 1000.0 << " ms)." << std::endl;
+    }
+
+    for (const Partition &partition : previous.partitions)
+    {
+        auto kept = std::find_if(catalog.partitions.begin(), catalog.partitions.end(),
+                                 [&partition](const Partition &current) { return current.key == partition.key; });
+        if (kept == catalog.partitions.end())
         {
-            std::cerr << COLOR_RED << "Error reading line: " << line << " -> " << e.what() << COLOR_RESET << std::endl;
-            // Optionally skip this line and continue or stop loading
+            removePartition(dataFilename, partition.key);
         }
     }
+    return true;
+}
+
+void Tracker::loadGoalsFromFile()
+{
+    // A missing file is not an error on first run
+    GoalFileStats stats;
+    forEachLiveGoal(goalsFilename, stats, [this, &stats](const GoalRow &row)
+    {
+        if (goals.empty())
+        {
+            goals.reserve(stats.lines);
+        }
+        int typeIndex = row.type;
+        if (typeIndex < 0 || typeIndex > static_cast<int>(ActivityType::STRENGTH))
+        {
+            typeIndex = static_cast<int>(ActivityType::UNKNOWN);
+        }
+        goals.push_back(Goal(static_cast<ActivityType>(typeIndex), std::string(row.description, row.descriptionLength),
+                             row.deadline, row.targetDistance, row.targetDuration, row.targetReps));
+    },
+    [](const char *lineBegin, const char *lineEnd)
+    {
+        std::cerr << COLOR_RED << "Error reading line: " << std::string(lineBegin, lineEnd) << COLOR_RESET << std::endl;
+    }, GoalLayout::TRACKER);
 
-    // No need to explicitly close inFile, RAII handles it when it goes out of scope
     std::cout << "Loaded " << goals.size() << " goals from \'" << goalsFilename << "\'." << std::endl;
     waitForEnter();
 }
 
 void Tracker::saveGoalsToFile()
 {
-    std::ofstream outFile(goalsFilename); // Opens in truncation mode (overwrites)
-    if (!outFile.is_open())
+    BufferedWriter outFile; // Replaces the file in one rename on close
+    if (!outFile.open(goalsFilename))
     {
         std::cerr << COLOR_RED << "Error: Could not open file " << goalsFilename << " for writing." << COLOR_RESET << std::endl;
         return;
     }
 
-    // Set precision for floating point numbers in the file
-    outFile << std::fixed << std::setprecision(2);
-
     for (const auto &goal : goals)
     {
-        outFile << static_cast<int>(goal.type) << ","
-                << goal.description << ","
-                << goal.deadline << ","
-                << std::setprecision(1) << goal.targetDuration << std::setprecision(2) << "," // Duration with 1 decimal
-                << goal.targetDistance << ","
-                << goal.targetReps << std::endl;
+        writeTrackerGoal(outFile, goal);
+        outFile.put('\n');
     }
 
-    // No need to explicitly close outFile, RAII handles it
-    std::cout << "Saved " << goals.size() << " goals to \'" << goalsFilename << "\'." << std::endl;
+    if (!outFile.close())
+    {
+        std::cerr << COLOR_RED << "Error: Could not write " << goalsFilename << "." << COLOR_RESET << std::endl;
+        return;
+    }
+    goalsDirty = false;
+    std::cout << "Saved " << goals.size() << " goals to \'" << goalsFilename << "\' ("
+              << outFile.bytesWritten() << " bytes in " << outFile.secondsSpent() * 1000.0 << " ms)." << std::endl;
 }
 
 // --- Utility Functions ---
@@ -660,15 +967,9 @@ std::string Tracker::getActivityTypeName(ActivityType type)
     }
 }
 
-std::string Tracker::getCurrentDate()
+Date Tracker::getCurrentDate()
 {
-    time_t t = time(nullptr);
-    struct tm *now = localtime(&t);
-    std::stringstream ss;
-    ss << (now->tm_year + 1900) << '-'
-       << std::setw(2) << std::setfill('0') << (now->tm_mon + 1) << '-'
-       << std::setw(2) << std::setfill('0') << now->tm_mday;
-    return ss.str();
+    return Date::today();
 }
 
 // --- Input Validation Helpers ---
@@ -698,7 +999,7 @@ int Tracker::getIntegerInput(const std::string &prompt, int minVal, int maxVal)
     }
 }
 
-double Tracker::getDoubleInput(const std::string &prompt, double minVal, bool allowEqual)
+double Tracker::getDoubleInput(const std::string &prompt, double minVal, bool allowEqual, double maxVal)
 {
     double value;
     while (true)
@@ -706,12 +1007,19 @@ double Tracker::getDoubleInput(const std::string &prompt, double minVal, bool al
         std::cout << prompt;
         std::cin >> value;
 
-        bool conditionMet = allowEqual ? (value >= minVal) : (value > minVal);
+        bool conditionMet = (allowEqual ? (value >= minVal) : (value > minVal)) && value <= maxVal;
 
         if (std::cin.fail() || !conditionMet)
         {
             std::cerr << COLOR_RED << "Invalid input. Please enter a number "
-                      << (allowEqual ? ">= " : "> ") << minVal << "." << COLOR_RESET << std::endl;
+                      << (allowEqual ? ">= " : "> ") << minVal;
+            if (maxVal < std::numeric_limits<double>::infinity())
+            {
+                std::streamsize precision = std::cerr.precision(10);
+                std::cerr << " and <= " << maxVal;
+                std::cerr.precision(precision);
+            }
+            std::cerr << "." << COLOR_RESET << std::endl;
             std::cin.clear();
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         }
@@ -739,11 +1047,16 @@ std::string Tracker::getStringInput(const std::string &prompt, const std::string
 
 void Tracker::checkGoalAchievements()
 {
-    if (goals.empty() || activities.empty())
+    if (goals.empty() || !hasActivities())
     {
         return;
     }
 
+    // Nothing dated after the last open deadline counts towards a goal
+    ActivityStore<Activity> scratch;
+    const ActivityStore<Activity> &candidates =
+        activitiesBetween(std::numeric_limits<int32_t>::min(), latestDeadline(goals, true), scratch);
+
     bool anyNewAchievements = false;
 
     // For each goal, check if it's been achieved
@@ -755,32 +1068,19 @@ void Tracker::checkGoalAchievements()
             continue;
         }
 
-        // Calculate progress based on activity type
-        double totalDuration = 0.0;
+        // Calculate progress from the activities of the same type dated
+        // up to the deadline; only those rows are read
+        ActivityTotals total = candidates.totalOfType(static_cast<uint8_t>(goal.type), goal.deadline.dayNumber());
+        double totalDuration = total.minutes();
         double totalDistance = 0.0;
         int totalReps = 0;
-
-        for (const auto &act : activities)
+        if (goal.type == ActivityType::RUNNING || goal.type == ActivityType::WALKING || goal.type == ActivityType::SWIMMING)
         {
-            // Only count activities of the same type
-            if (act.type == goal.type)
-            {
-                // Only count activities before the deadline
-                if (act.date <= goal.deadline)
-                {
-                    totalDuration += act.duration;
-
-                    if (goal.type == ActivityType::RUNNING || goal.type == ActivityType::WALKING || goal.type == ActivityType::SWIMMING)
-                    {
-                        totalDistance += act.distance;
-                    }
-
-                    if (goal.type == ActivityType::STRENGTH)
-                    {
-                        totalReps += act.repetitions;
-                    }
-                }
-            }
+            totalDistance = total.kilometres();
+        }
+        if (goal.type == ActivityType::STRENGTH)
+        {
+            totalReps = static_cast<int>(total.repetitions);
         }
 
         // Check if goal is achieved
@@ -806,6 +1106,7 @@ void Tracker::checkGoalAchievements()
         {
             goal.achieved = true;
             anyNewAchievements = true;
+            goalsDirty = true;
         }
     }
 
@@ -861,8 +1162,7 @@ void Tracker::addGoal()
     }
 
     // Get deadline
-    std::string currentDate = getCurrentDate();
-    std::string deadline = getDateInput("Deadline (YYYY-MM-DD)", currentDate);
+    Date deadline = getDateInput("Deadline (YYYY-MM-DD)", getCurrentDate());
 
     // Get target values based on activity type
     double targetDistance = 0.0;
@@ -871,10 +1171,10 @@ void Tracker::addGoal()
 
     if (type == ActivityType::RUNNING || type == ActivityType::WALKING || type == ActivityType::SWIMMING)
     {
-        targetDistance = getDoubleInput("Target distance (kilometers): ", 0.0, true);
+        targetDistance = getDoubleInput("Target distance (kilometers): ", 0.0, true, MAX_DISTANCE_KILOMETRES);
     }
 
-    targetDuration = getDoubleInput("Target duration (minutes, 0 for no target): ", 0.0, true);
+    targetDuration = getDoubleInput("Target duration (minutes, 0 for no target): ", 0.0, true, MAX_DURATION_MINUTES);
 
     if (type == ActivityType::STRENGTH)
     {
@@ -884,6 +1184,7 @@ void Tracker::addGoal()
     // Create and add the goal
     Goal newGoal(type, description, deadline, targetDistance, targetDuration, targetReps);
     goals.push_back(newGoal);
+    goalsDirty = true;
 
     // Save goals to file
     saveGoalsToFile();
@@ -907,6 +1208,11 @@ void Tracker::viewGoals()
         return;
     }
 
+    // Nothing dated after the last deadline counts towards a goal
+    ActivityStore<Activity> scratch;
+    const ActivityStore<Activity> &candidates =
+        activitiesBetween(std::numeric_limits<int32_t>::min(), latestDeadline(goals, false), scratch);
+
     // Display goals
     std::cout << std::left
               << std::setw(3) << "ID" << " | "
@@ -970,34 +1276,20 @@ void Tracker::viewGoals()
         std::cout << std::endl
                   << COLOR_CYAN << "Current Progress:" << COLOR_RESET << std::endl;
 
-        // Calculate progress based on activity type
-        double totalDuration = 0.0;
+        // Calculate progress from the activities of the same type dated
+        // up to the deadline; only those rows are read
+        ActivityTotals total = candidates.totalOfType(static_cast<uint8_t>(goal.type), goal.deadline.dayNumber());
+        double totalDuration = total.minutes();
         double totalDistance = 0.0;
         int totalReps = 0;
-        int matchingActivities = 0;
-
-        for (const auto &act : activities)
+        uint64_t matchingActivities = total.count;
+        if (goal.type == ActivityType::RUNNING || goal.type == ActivityType::WALKING || goal.type == ActivityType::SWIMMING)
         {
-            // Only count activities of the same type
-            if (act.type == goal.type)
-            {
-                // Only count activities before the deadline
-                if (act.date <= goal.deadline)
-                {
-                    matchingActivities++;
-                    totalDuration += act.duration;
-
-                    if (goal.type == ActivityType::RUNNING || goal.type == ActivityType::WALKING || goal.type == ActivityType::SWIMMING)
-                    {
-                        totalDistance += act.distance;
-                    }
-
-                    if (goal.type == ActivityType::STRENGTH)
-                    {
-                        totalReps += act.repetitions;
-                    }
-                }
-            }
+            totalDistance = total.kilometres();
+        }
+        if (goal.type == ActivityType::STRENGTH)
+        {
+            totalReps = static_cast<int>(total.repetitions);
         }
 
         std::cout << "Matching Activities: " << matchingActivities << std::endl;
@@ -1035,104 +1327,279 @@ void Tracker::viewGoals()
     waitForEnter();
 }
 
+// Write activities and goals to one checksummed archive (see archive.h).
+// Unsaved changes are saved first so the backup matches what is on screen.
 void Tracker::backupData()
 {
-    // Implementation of backupData method
-}
+    std::cout << COLOR_CYAN << "--- Backup Data ---" << COLOR_RESET << std::endl;
+    std::string archivePath = getStringInput("Backup file", dataFilename + ".backup");
 
-// Enhanced date input with validation
-std::string Tracker::getDateInput(const std::string &prompt, const std::string &defaultValue)
-{
-    while (true)
+    if (activitiesDirty)
     {
-        std::string date = getStringInput(prompt, defaultValue);
+        saveToFile();
+    }
+    if (goalsDirty)
+    {
+        saveGoalsToFile();
+    }
+    if (activitiesDirty || goalsDirty)
+    {
+        std::cerr << COLOR_RED << "Error: Unsaved changes could not be saved; no backup was written." << COLOR_RESET
+                  << std::endl;
+        waitForEnter();
+        return;
+    }
 
-        if (isDateValid(date))
+    // Each file is stored as it is on disk, partitions one member each,
+    // followed by their journals if they have one, and the catalog last, so
+    // a restore brings back the same layout. A file that does not exist yet
+    // holds nothing and is left out.
+    std::vector<ArchiveMember> members;
+    FileInfo info;
+    uint64_t activityCount = activitiesLoaded ? activities.size() : partitionedRowCount(catalog);
+    if (catalog.scheme != PartitionScheme::NONE)
+    {
+        for (const Partition &partition : catalog.partitions)
         {
-            return date;
+            std::string path = partitionPathFor(dataFilename, partition.key);
+            members.push_back({"partition." + partition.key, path, false});
+            if (getFileInfo(journalPathFor(path), info))
+            {
+                members.push_back({"journal." + partition.key, journalPathFor(path), false});
+            }
         }
+    }
+    else if (getFileInfo(dataFilename, info))
+    {
+        members.push_back({"activities", dataFilename, false});
+    }
+    if (getFileInfo(goalsFilename, info))
+    {
+        members.push_back({"goals", goalsFilename, false});
+    }
+    if (catalog.scheme != PartitionScheme::NONE)
+    {
+        members.push_back({"catalog", partitionCatalogPathFor(dataFilename), false});
+    }
 
-        std::cerr << COLOR_RED << "Invalid date format or values. Please use YYYY-MM-DD format with valid values." << COLOR_RESET << std::endl;
+    ArchiveStats stats;
+    if (!writeArchive(archivePath, members, stats))
+    {
+        std::cerr << COLOR_RED << "Error: Could not write backup \'" << archivePath
+                  << "\'; a data file is missing or could not be read." << COLOR_RESET << std::endl;
+        waitForEnter();
+        return;
     }
+
+    std::cout << COLOR_GREEN << "Backed up " << activityCount << " activities and " << goals.size()
+              << " goals to \'" << archivePath << "\' (" << stats.bytes << " bytes in " << stats.blocks
+              << " blocks)." << COLOR_RESET << std::endl;
+    waitForEnter();
 }
 
-// Validate date format and values
-bool Tracker::isDateValid(const std::string &date)
+// Replace activities and goals with the contents of a backup archive. The
+// archive is verified block by block while it streams into staged files,
+// and the data files are only switched over once all of it checked out.
+// The layout the archive was taken in is restored with it.
+void Tracker::restoreFromBackup()
 {
-    // Check basic format with regex
-    std::regex dateRegex("^\\d{4}-\\d{2}-\\d{2}$");
-    if (!std::regex_match(date, dateRegex))
+    std::cout << COLOR_CYAN << "--- Restore From Backup ---" << COLOR_RESET << std::endl;
+    std::string archivePath = getStringInput("Backup file", dataFilename + ".backup");
+    std::string answer = getStringInput("This replaces all current activities and goals. Continue? (y/n)", "n");
+    if (answer != "y" && answer != "Y")
     {
-        return false;
+        std::cout << "Restore cancelled." << std::endl;
+        waitForEnter();
+        return;
     }
 
-    // Parse and validate components
-    int year, month, day;
-    if (sscanf(date.c_str(), "%d-%d-%d", &year, &month, &day) != 3)
+    // Version 1 archives name their members "0" and "1"
+    std::vector<std::string> names;
+    std::vector<ArchiveMember> outputs;
+    std::set<std::string> restoredKeys;
+    std::set<std::string> restoredJournals;
+    bool hasActivities = false;
+    bool hasGoals = false;
+    bool hasCatalog = false;
+    bool known = readArchiveNames(archivePath, names);
+    for (const std::string &name : names)
     {
-        return false;
+        if (name == "activities" || name == "0")
+        {
+            outputs.push_back({name, dataFilename, true});
+            hasActivities = true;
+        }
+        else if (name == "goals" || name == "1")
+        {
+            outputs.push_back({name, goalsFilename, false});
+            hasGoals = true;
+        }
+        else if (name == "catalog")
+        {
+            outputs.push_back({name, partitionCatalogPathFor(dataFilename), false});
+            hasCatalog = true;
+        }
+        else if (name.compare(0, 10, "partition.") == 0 && name.size() > 10 &&
+                 name.find('/') == std::string::npos)
+        {
+            std::string key = name.substr(10);
+            outputs.push_back({name, partitionPathFor(dataFilename, key), true});
+            restoredKeys.insert(key);
+        }
+        else if (name.compare(0, 8, "journal.") == 0 && name.size() > 8 &&
+                 name.find('/') == std::string::npos)
+        {
+            std::string key = name.substr(8);
+            outputs.push_back({name, journalPathFor(partitionPathFor(dataFilename, key)), false});
+            restoredJournals.insert(key);
+        }
+        else
+        {
+            known = false;
+        }
     }
 
-    // Basic range checks
-    if (year < 1900 || year > 2100 || month < 1 || month > 12 || day < 1)
+    // Files of the layout being replaced that the archive does not bring
+    // back go in the same switch as the restored ones
+    std::vector<std::string> obsolete;
+    for (const Partition &partition : catalog.partitions)
     {
-        return false;
+        std::string path = partitionPathFor(dataFilename, partition.key);
+        if (!hasCatalog || restoredKeys.count(partition.key) == 0)
+        {
+            obsolete.push_back(path);
+            obsolete.push_back(blockChecksumPathFor(path));
+        }
+        if (!hasCatalog || restoredJournals.count(partition.key) == 0)
+        {
+            obsolete.push_back(journalPathFor(path));
+        }
+    }
+    if (!hasCatalog)
+    {
+        obsolete.push_back(partitionCatalogPathFor(dataFilename));
+    }
+    if (!hasActivities)
+    {
+        obsolete.push_back(dataFilename);
+        obsolete.push_back(blockChecksumPathFor(dataFilename));
+    }
+    if (!hasGoals)
+    {
+        obsolete.push_back(goalsFilename);
     }
 
-    // Check days in month (including leap years)
-    int maxDay = 31; // Default for months with 31 days
-
-    if (month == 4 || month == 6 || month == 9 || month == 11)
+    ArchiveStats stats;
+    if (!known || !extractArchive(archivePath, outputs, obsolete, restoreListPathFor(dataFilename), stats))
     {
-        maxDay = 30;
+        std::cerr << COLOR_RED << "Error: Backup \'" << archivePath
+                  << "\' is missing or damaged; nothing was restored." << COLOR_RESET << std::endl;
+        waitForEnter();
+        return;
     }
-    else if (month == 2)
+
+    std::cout << COLOR_GREEN << "Restored " << stats.bytes << " bytes from \'" << archivePath << "\'."
+              << COLOR_RESET << std::endl;
+
+    // The archive checked the restored rows and their checksums came with
+    // them; the catalog is recorded again for the partition files as they
+    // are now
+    if (hasCatalog)
     {
-        // February - check for leap year
-        bool isLeapYear = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-        maxDay = isLeapYear ? 29 : 28;
+        PartitionCatalog restored;
+        if (loadPartitionCatalog(dataFilename, restored))
+        {
+            std::vector<Partition> partitions = restored.partitions;
+            for (const Partition &partition : partitions)
+            {
+                recordPartition(dataFilename, restored, partition.key, partition.rows, partition.firstDay,
+                                partition.lastDay);
+            }
+            savePartitionCatalog(dataFilename, restored);
+        }
     }
 
-    return day <= maxDay;
+    // The restored files are now the saved state
+    catalog = PartitionCatalog();
+    activities.clear();
+    goals.clear();
+    activitiesDirty = false;
+    goalsDirty = false;
+    loadFromFile();
+    loadGoalsFromFile();
+    checkGoalAchievements();
 }
 
-// Check if a date is within a specified range
-bool Tracker::isDateInRange(const std::string &date, const std::string &startDate, const std::string &endDate)
+// Store the activities in one file, or in one file per year or month so
+// that date-bounded queries read only the partitions they need
+void Tracker::changeStorageLayout()
 {
-    // Simple string comparison works for YYYY-MM-DD format
-    return date >= startDate && date <= endDate;
+    std::cout << COLOR_CYAN << "--- Storage Layout ---" << COLOR_RESET << std::endl;
+    if (catalog.scheme == PartitionScheme::NONE)
+    {
+        std::cout << "Activities are stored in a single file." << std::endl;
+    }
+    else
+    {
+        std::cout << "Activities are stored in one file per " << partitionSchemeName(catalog.scheme) << "." << std::endl;
+    }
+    std::cout << "  1 - Single file" << std::endl;
+    std::cout << "  2 - One file per year" << std::endl;
+    std::cout << "  3 - One file per month" << std::endl;
+    std::cout << "  0 - Back to Main Menu" << std::endl;
+    int option = getIntegerInput("Enter option: ", 0, 3);
+
+    const PartitionScheme schemes[] = {PartitionScheme::NONE, PartitionScheme::YEAR, PartitionScheme::MONTH};
+    if (option == 0 || schemes[option - 1] == catalog.scheme)
+    {
+        return;
+    }
+
+    if (!storeActivitiesAs(schemes[option - 1]))
+    {
+        std::cerr << COLOR_RED << "Error: Could not change the storage layout; the data was left as it was."
+                  << COLOR_RESET << std::endl;
+    }
+    else
+    {
+        std::cout << COLOR_GREEN << "Storage layout changed." << COLOR_RESET << std::endl;
+    }
+    waitForEnter();
 }
 
-// Calculate days between two dates
-int Tracker::calculateDaysBetween(const std::string &dateStart, const std::string &dateEnd)
+// Enhanced date input with validation
+Date Tracker::getDateInput(const std::string &prompt, Date defaultValue)
 {
-    struct std::tm startTm = {}, endTm = {};
+    while (true)
+    {
+        Date date = Date::parse(getStringInput(prompt, defaultValue.toString()));
 
-    // Parse start date
-    int startYear, startMonth, startDay;
-    sscanf(dateStart.c_str(), "%d-%d-%d", &startYear, &startMonth, &startDay);
-    startTm.tm_year = startYear - 1900; // Years since 1900
-    startTm.tm_mon = startMonth - 1;    // Months since January (0-11)
-    startTm.tm_mday = startDay;
+        if (isDateValid(date))
+        {
+            return date;
+        }
 
-    // Parse end date
-    int endYear, endMonth, endDay;
-    sscanf(dateEnd.c_str(), "%d-%d-%d", &endYear, &endMonth, &endDay);
-    endTm.tm_year = endYear - 1900;
-    endTm.tm_mon = endMonth - 1;
-    endTm.tm_mday = endDay;
+        std::cerr << COLOR_RED << "Invalid date format or values. Please use YYYY-MM-DD format with valid values." << COLOR_RESET << std::endl;
+    }
+}
 
-    // Convert to time_t (seconds since epoch)
-    std::time_t startTime = std::mktime(&startTm);
-    std::time_t endTime = std::mktime(&endTm);
+// Validate date format and values
+bool Tracker::isDateValid(Date date)
+{
+    // Date::parse already rejects malformed text and days that do not exist
+    return date.isValid() && date >= Date::fromCivil(1900, 1, 1) && date <= Date::fromCivil(2100, 12, 31);
+}
 
-    // Calculate difference in seconds, convert to days
-    if (startTime != -1 && endTime != -1)
-    {
-        return static_cast<int>(std::difftime(endTime, startTime) / (60 * 60 * 24));
-    }
+// Check if a date is within a specified range
+bool Tracker::isDateInRange(Date date, Date startDate, Date endDate)
+{
+    return date >= startDate && date <= endDate;
+}
 
-    return 0; // Default if conversion fails
+// Calculate days between two dates
+int Tracker::calculateDaysBetween(Date dateStart, Date dateEnd)
+{
+    return dateEnd - dateStart;
 }
 
 // Format duration from minutes to hours and minutes
@@ -1155,7 +1622,7 @@ std::string Tracker::formatDuration(double minutes)
 
 void Tracker::searchActivities()
 {
-    if (activities.empty())
+    if (!hasActivities())
     {
         std::cout << COLOR_YELLOW << "No activities recorded yet." << COLOR_RESET << std::endl;
         waitForEnter();
@@ -1180,7 +1647,7 @@ void Tracker::searchActivities()
     }
     case 2:
     { // Search by date
-        std::string date = getDateInput("Enter date (YYYY-MM-DD)", getCurrentDate());
+        Date date = getDateInput("Enter date (YYYY-MM-DD)", getCurrentDate());
         searchByDate(date);
         break;
     }
@@ -1189,6 +1656,7 @@ void Tracker::searchActivities()
 
 void Tracker::searchByKeyword(const std::string &keyword)
 {
+    ensureActivitiesLoaded();
     clearScreen();
     std::cout << "===================================" << std::endl;
     std::cout << "  " << COLOR_YELLOW << "SEARCH RESULTS FOR: " << COLOR_GREEN << keyword << COLOR_RESET << std::endl;
@@ -1210,7 +1678,7 @@ void Tracker::searchByKeyword(const std::string &keyword)
         lowerTypeName = std::regex_replace(lowerTypeName, std::regex("\033\\[[0-9;]*m"), "");
 
         if (lowerTypeName.find(lowerKeyword) != std::string::npos ||
-            act.date.find(keyword) != std::string::npos)
+            act.date.toString().find(keyword) != std::string::npos)
         {
             results.push_back(act);
         }
@@ -1269,16 +1737,21 @@ void Tracker::searchByKeyword(const std::string &keyword)
     waitForEnter();
 }
 
-void Tracker::searchByDate(const std::string &date)
+void Tracker::searchByDate(Date date)
 {
     clearScreen();
     std::cout << "===================================" << std::endl;
     std::cout << "  " << COLOR_YELLOW << "ACTIVITIES ON: " << COLOR_GREEN << date << COLOR_RESET << std::endl;
     std::cout << "===================================" << std::endl;
 
+    // Partitioned data reads only the partition holding that day
+    ActivityStore<Activity> scratch;
+    const ActivityStore<Activity> &candidates = activitiesBetween(
+        date.dayNumber(), date.dayNumber(), scratch);
+
     std::vector<Activity> results;
 
-    for (const auto &act : activities)
+    for (const auto &act : candidates)
     {
         if (act.date == date)
         {
@@ -1339,7 +1812,7 @@ void Tracker::searchByDate(const std::string &date)
 
 void Tracker::filterActivities()
 {
-    if (activities.empty())
+    if (!hasActivities())
     {
         std::cout << COLOR_YELLOW << "No activities recorded yet." << COLOR_RESET << std::endl;
         waitForEnter();
@@ -1387,8 +1860,8 @@ void Tracker::filterActivities()
     }
     case 2:
     { // Filter by date range
-        std::string startDate = getDateInput("Enter start date (YYYY-MM-DD)", "2000-01-01");
-        std::string endDate = getDateInput("Enter end date (YYYY-MM-DD)", getCurrentDate());
+        Date startDate = getDateInput("Enter start date (YYYY-MM-DD)", Date::fromCivil(2000, 1, 1));
+        Date endDate = getDateInput("Enter end date (YYYY-MM-DD)", getCurrentDate());
 
         if (startDate > endDate)
         {
@@ -1418,6 +1891,7 @@ void Tracker::filterActivities()
 
 void Tracker::filterByType(ActivityType type)
 {
+    ensureActivitiesLoaded();
     clearScreen();
     std::cout << "===================================" << std::endl;
     std::cout << "  " << COLOR_YELLOW << "FILTERED BY TYPE: " << getActivityTypeName(type) << COLOR_RESET << std::endl;
@@ -1533,7 +2007,7 @@ void Tracker::filterByType(ActivityType type)
     waitForEnter();
 }
 
-void Tracker::filterByDateRange(const std::string &startDate, const std::string &endDate)
+void Tracker::filterByDateRange(Date startDate, Date endDate)
 {
     clearScreen();
     std::cout << "===================================" << std::endl;
@@ -1541,9 +2015,14 @@ void Tracker::filterByDateRange(const std::string &startDate, const std::string
     std::cout << "  " << COLOR_CYAN << startDate << " to " << endDate << COLOR_RESET << std::endl;
     std::cout << "===================================" << std::endl;
 
+    // Partitioned data reads only the partitions that overlap the range
+    ActivityStore<Activity> scratch;
+    const ActivityStore<Activity> &candidates =
+        activitiesBetween(startDate.dayNumber(), endDate.dayNumber(), scratch);
+
     std::vector<Activity> results;
 
-    for (const auto &act : activities)
+    for (const auto &act : candidates)
     {
         if (isDateInRange(act.date, startDate, endDate))
         {
@@ -1643,6 +2122,7 @@ void Tracker::filterByDateRange(const std::string &startDate, const std::string
 
 void Tracker::filterByDuration(double minDuration, double maxDuration)
 {
+    ensureActivitiesLoaded();
     clearScreen();
     std::cout << "===================================" << std::endl;
     std::cout << "  " << COLOR_YELLOW << "FILTERED BY DURATION" << COLOR_RESET << std::endl;
@@ -1734,6 +2214,7 @@ void Tracker::filterByDuration(double minDuration, double maxDuration)
 
 void Tracker::showProgressChart()
 {
+    ensureActivitiesLoaded();
     if (activities.empty())
     {
         std::cout << COLOR_YELLOW << "No activities recorded yet." << COLOR_RESET << std::endl;
@@ -1747,9 +2228,9 @@ void Tracker::showProgressChart()
     std::cout << "===================================" << std::endl;
 
     // Group activities by date
-    std::map<std::string, double> dailyDuration;
-    std::map<std::string, double> dailyDistance;
-    std::set<std::string> dates;
+    std::map<Date, double> dailyDuration;
+    std::map<Date, double> dailyDistance;
+    std::set<Date> dates;
 
     for (const auto &act : activities)
     {
@@ -1765,8 +2246,7 @@ void Tracker::showProgressChart()
     }
 
     // Sort dates for chronological display
-    std::vector<std::string> sortedDates(dates.begin(), dates.end());
-    std::sort(sortedDates.begin(), sortedDates.end());
+    std::vector<Date> sortedDates(dates.begin(), dates.end());
 
     // Find max values for scaling
     double maxDuration = 0.0;
@@ -1839,6 +2319,7 @@ void Tracker::showProgressChart()
 
 void Tracker::showActivityDistribution()
 {
+    ensureActivitiesLoaded();
     if (activities.empty())
     {
         std::cout << COLOR_YELLOW << "No activities recorded yet." << COLOR_RESET << std::endl;
@@ -1851,15 +2332,9 @@ void Tracker::showActivityDistribution()
     std::cout << "    " << COLOR_YELLOW << "ACTIVITY DISTRIBUTION" << COLOR_RESET << std::endl;
     std::cout << "===================================" << std::endl;
 
-    // Count each activity type
-    std::map<ActivityType, int> typeCounts;
-    int totalActivities = 0;
-
-    for (const auto &act : activities)
-    {
-        typeCounts[act.type]++;
-        totalActivities++;
-    }
+    // Count, time and distance of each type, from the numeric columns only
+    TypeTotals totals = totalByType(activities.columns());
+    uint64_t totalActivities = activities.size();
 
     // Calculate percentages and display
     std::cout << COLOR_CYAN << "Distribution of Activity Types:" << COLOR_RESET << std::endl
@@ -1870,7 +2345,7 @@ void Tracker::showActivityDistribution()
     for (int i = 0; i < 5; i++)
     {
         ActivityType type = static_cast<ActivityType>(i);
-        int count = typeCounts[type];
+        uint64_t count = totals[i].count;
         double percentage = (totalActivities > 0) ? (static_cast<double>(count) / totalActivities) * 100 : 0;
 
         // Calculate bar length
@@ -1914,32 +2389,17 @@ void Tracker::showActivityDistribution()
     std::cout << std::endl
               << COLOR_CYAN << "Total Activities: " << totalActivities << COLOR_RESET << std::endl;
 
-    // Calculate and display total duration and distance by type
-    std::map<ActivityType, double> totalDurations;
-    std::map<ActivityType, double> totalDistances;
-
-    for (const auto &act : activities)
-    {
-        totalDurations[act.type] += act.duration;
-
-        if (act.type == ActivityType::RUNNING ||
-            act.type == ActivityType::WALKING ||
-            act.type == ActivityType::SWIMMING)
-        {
-            totalDistances[act.type] += act.distance;
-        }
-    }
-
+    // Display total duration and distance by type
     std::cout << std::endl
               << COLOR_CYAN << "Total Time Spent by Activity Type:" << COLOR_RESET << std::endl;
 
     for (int i = 0; i < 5; i++)
     {
         ActivityType type = static_cast<ActivityType>(i);
-        if (typeCounts[type] > 0)
+        if (totals[i].count > 0)
         {
             std::cout << getActivityTypeName(type) << ": "
-                      << std::fixed << std::setprecision(1) << totalDurations[type] << " minutes" << std::endl;
+                      << std::fixed << std::setprecision(1) << totals[i].minutes() << " minutes" << std::endl;
         }
     }
 
@@ -1950,10 +2410,10 @@ void Tracker::showActivityDistribution()
     for (int i = 0; i < 3; i++)
     { // Only first three types have distance
         ActivityType type = static_cast<ActivityType>(i);
-        if (typeCounts[type] > 0)
+        if (totals[i].count > 0)
         {
             std::cout << getActivityTypeName(type) << ": "
-                      << std::fixed << std::setprecision(2) << totalDistances[type] << " kilometers" << std::endl;
+                      << std::fixed << std::setprecision(2) << totals[i].kilometres() << " kilometers" << std::endl;
             hasDistanceData = true;
         }
     }
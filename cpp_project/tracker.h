@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <string>
+#include <limits>
 #include <regex>
 #include "activity.h"
+#include "activity_store.h"
+#include "partitions.h"
 
 // ANSI Color Codes (as const strings)
 const std::string COLOR_RESET = "\033[0m";
@@ -28,10 +31,14 @@ public:
     void run();
 
 private:
-    std::vector<Activity> activities; // Use std::vector for dynamic storage
+    ActivityStore<Activity> activities; // Column by column (see activity_store.h)
     std::vector<Goal> goals;          // Store user goals
     std::string dataFilename;         // Store the filename for saving
     std::string goalsFilename;        // Store the goals filename
+    bool activitiesDirty = false;     // Activities changed since the last save
+    bool goalsDirty = false;          // Goals changed since the last save
+    PartitionCatalog catalog;         // Layout of the activities on disk (see partitions.h)
+    bool activitiesLoaded = true;     // False until partitions are read for the whole history
 
     // Menu display functions
     void displayMainMenu();
@@ -48,10 +55,10 @@ private:
     // New search and filter functions
     void searchActivities();
     void searchByKeyword(const std::string &keyword);
-    void searchByDate(const std::string &date);
+    void searchByDate(Date date);
     void filterActivities();
     void filterByType(ActivityType type);
-    void filterByDateRange(const std::string &startDate, const std::string &endDate);
+    void filterByDateRange(Date startDate, Date endDate);
     void filterByDuration(double minDuration, double maxDuration);
 
     // Data visualization functions
@@ -67,28 +74,40 @@ private:
     // Data management functions
     void backupData();
     void restoreFromBackup();
+    void changeStorageLayout();
 
     // File I/O
     void loadFromFile();
     void saveToFile();
     void loadGoalsFromFile();
     void saveGoalsToFile();
+    bool reportIfDamaged(const std::string &path);
+
+    // Partitioned storage
+    void ensureActivitiesLoaded();
+    bool hasActivities();
+    const ActivityStore<Activity> &activitiesBetween(int32_t firstDay, int32_t lastDay, ActivityStore<Activity> &scratch);
+    void loadPartitions(const std::vector<size_t> &which, ActivityStore<Activity> &into);
+    bool appendToPartition(const std::string &key, const Activity &activity);
+    void foldPartitionJournal(const std::string &key);
+    bool storeActivitiesAs(PartitionScheme scheme);
 
     // Utility functions
     void clearScreen();
     void waitForEnter();
     std::string getActivityTypeName(ActivityType type);
-    std::string getCurrentDate();
-    bool isDateInRange(const std::string &date, const std::string &startDate, const std::string &endDate);
-    bool isDateValid(const std::string &date);
-    int calculateDaysBetween(const std::string &dateStart, const std::string &dateEnd);
+    Date getCurrentDate();
+    bool isDateInRange(Date date, Date startDate, Date endDate);
+    bool isDateValid(Date date);
+    int calculateDaysBetween(Date dateStart, Date dateEnd);
     std::string formatDuration(double minutes);
 
     // Input validation helpers
     int getIntegerInput(const std::string &prompt, int minVal, int maxVal);
-    double getDoubleInput(const std::string &prompt, double minVal, bool allowEqual = false);
+    double getDoubleInput(const std::string &prompt, double minVal, bool allowEqual = false,
+                          double maxVal = std::numeric_limits<double>::infinity());
     std::string getStringInput(const std::string &prompt, const std::string &defaultValue);
-    std::string getDateInput(const std::string &prompt, const std::string &defaultValue);
+    Date getDateInput(const std::string &prompt, Date defaultValue);
 };
 
 #endif // TRACKER_H
@@ -4,9 +4,13 @@
  * and view statistics about their performance.
  */
 
+#define _POSIX_C_SOURCE 200809L // For the nanosecond file times in struct stat
+
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 
 // ANSI Color Codes
@@ -19,6 +23,13 @@
 #define MAX_ACTIVITIES 100
 #define MAX_NAME_LENGTH 50
 #define MAX_ACTIVITY_TYPES 5
+#define MAX_LINE_LENGTH 128
+
+// Block checksums of the data file, stored as <file>.crc in the format the
+// C++ applications use (storage/block_checksums.h): a header, then one
+// CRC-32C for every CHECKSUM_BLOCK_BYTES of the file
+#define CHECKSUM_BLOCK_BYTES 4096
+#define CHECKSUM_VERSION 1
 
 // Activity types
 typedef enum
@@ -40,9 +51,22 @@ typedef struct
     int repetitions; // for strength activities
 } Activity;
 
+// Header of a checksum file; sourceSize and sourceModifiedNs describe the
+// version of the data file the checksums were taken from
+typedef struct
+{
+    char magic[4]; // "TRKC"
+    uint32_t version;
+    uint32_t blockBytes;
+    uint32_t blockCount;
+    uint64_t sourceSize;
+    int64_t sourceModifiedNs;
+} ChecksumHeader;
+
 // Global data
 Activity activities[MAX_ACTIVITIES];
 int activityCount = 0;
+int dataDamaged = 0; // Rows were skipped for failing their checksum; the file must not be rewritten
 
 // Statistics for each activity type
 int activityTypeCounts[MAX_ACTIVITY_TYPES] = {0};
@@ -69,6 +93,12 @@ void getCurrentDate(char *dateStr);
 void waitForEnter();
 void loadActivitiesFromFile(const char *filename);
 void saveActivitiesToFile(const char *filename);
+int parseActivityLine(const char *text, size_t length, Activity *activity);
+uint32_t crc32c(const unsigned char *data, size_t length);
+int getFileVersion(const char *filename, uint64_t *size, int64_t *modifiedNs);
+unsigned char *readWholeFile(const char *filename, size_t *length);
+char *findDamagedBlocks(const char *filename, const unsigned char *data, size_t length);
+void saveChecksums(const char *filename);
 int getIntegerInput(const char *prompt, int minVal, int maxVal);
 float getFloatInput(const char *prompt, float minVal);
 void getStringInput(const char *prompt, char *buffer, int bufferSize, const char *defaultValue);
@@ -511,11 +541,13 @@ void viewStatistics()
     waitForEnter();
 }
 
-// Load activities from a CSV file
+// Load activities from a CSV file. Rows in blocks whose checksum does not
+// match are skipped, and so are malformed rows; both are reported.
 void loadActivitiesFromFile(const char *filename)
 {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL)
+    size_t length;
+    unsigned char *data = readWholeFile(filename, &length);
+    if (data == NULL)
     {
         // If the file doesn't exist, it's okay, maybe it's the first run.
         printf("Data file '%s' not found. Starting with no activities.\n", filename);
@@ -523,40 +555,103 @@ void loadActivitiesFromFile(const char *filename)
         return;
     }
 
-    int typeIndex;
-    char date[11];
-    float duration, distance;
-    int repetitions;
+    char *damaged = findDamagedBlocks(filename, data, length);
+    int lineNumber = 0;
+    int skipped = 0;
+    size_t lineStart = 0;
 
     // Read activities line by line
-    while (fscanf(file, "%d,%10[^,],%f,%f,%d\n",
-                  &typeIndex, date, &duration, &distance, &repetitions) == 5)
+    while (lineStart < length)
     {
-        if (activityCount >= MAX_ACTIVITIES)
+        size_t lineEnd = lineStart;
+        while (lineEnd < length && data[lineEnd] != '\n')
         {
-            printf("Warning: Maximum activity limit reached while loading. Some activities might not be loaded.\n");
-            break;
+            lineEnd++;
         }
+        size_t next = lineEnd < length ? lineEnd + 1 : lineEnd;
+        lineNumber++;
 
-        Activity loadedActivity;
-        loadedActivity.type = (ActivityType)typeIndex;
-        strcpy(loadedActivity.date, date);
-        loadedActivity.duration = duration;
-        loadedActivity.distance = distance;
-        loadedActivity.repetitions = repetitions;
+        int isDamaged = 0;
+        if (damaged != NULL)
+        {
+            for (size_t block = lineStart / CHECKSUM_BLOCK_BYTES; block <= (next - 1) / CHECKSUM_BLOCK_BYTES; block++)
+            {
+                isDamaged |= damaged[block];
+            }
+        }
 
-        activities[activityCount++] = loadedActivity;
-        updateStatistics(loadedActivity); // Update stats for loaded activities
+        Activity loadedActivity;
+        size_t lineLength = lineEnd - lineStart;
+        if (lineLength == 0 || (lineLength == 1 && data[lineStart] == '\r'))
+        {
+            // Blank line
+        }
+        else if (isDamaged)
+        {
+            skipped++;
+        }
+        else if (!parseActivityLine((const char *)data + lineStart, lineLength, &loadedActivity))
+        {
+            printf(COLOR_RED "Skipping malformed line %d of '%s'.\n" COLOR_RESET, lineNumber, filename);
+        }
+        else if (activityCount >= MAX_ACTIVITIES)
+        {
+            printf("Warning: Maximum activity limit reached while loading. Some activities might not be loaded.\n");
+            break;
+        }
+        else
+        {
+            activities[activityCount++] = loadedActivity;
+            updateStatistics(loadedActivity); // Update stats for loaded activities
+        }
+        lineStart = next;
     }
 
-    fclose(file);
+    // Saving would drop the skipped rows, so the file is not saved over
+    if (skipped > 0)
+    {
+        dataDamaged = 1;
+        printf(COLOR_RED "Error: '%s' is damaged; skipped %d rows that failed their checksum.\n" COLOR_RESET,
+               filename, skipped);
+    }
+    free(damaged);
+    free(data);
     printf("Loaded %d activities from '%s'.\n", activityCount, filename);
     waitForEnter();
 }
 
+// Parse one row (without its newline); returns 0 if it is malformed
+int parseActivityLine(const char *text, size_t length, Activity *activity)
+{
+    char line[MAX_LINE_LENGTH];
+    int typeIndex;
+    if (length >= sizeof(line))
+    {
+        return 0;
+    }
+    memcpy(line, text, length);
+    line[length] = '\0';
+
+    if (sscanf(line, "%d,%10[^,],%f,%f,%d", &typeIndex, activity->date, &activity->duration,
+               &activity->distance, &activity->repetitions) != 5 ||
+        typeIndex < 0 || typeIndex >= MAX_ACTIVITY_TYPES)
+    {
+        return 0;
+    }
+    activity->type = (ActivityType)typeIndex;
+    return 1;
+}
+
 // Save activities to a CSV file
 void saveActivitiesToFile(const char *filename)
 {
+    if (dataDamaged)
+    {
+        printf(COLOR_RED "Error: '%s' is damaged; it is not saved over until it is restored from a backup.\n" COLOR_RESET,
+               filename);
+        return;
+    }
+
     FILE *file = fopen(filename, "w");
     if (file == NULL)
     {
@@ -575,9 +670,166 @@ void saveActivitiesToFile(const char *filename)
     }
 
     fclose(file);
+    saveChecksums(filename);
     printf("Saved %d activities to '%s'.\n", activityCount, filename);
 }
 
+// CRC-32C (Castagnoli), one table lookup per byte; the data file holds at
+// most MAX_ACTIVITIES rows, so this is never the slow part
+uint32_t crc32c(const unsigned char *data, size_t length)
+{
+    static uint32_t table[256];
+    static int tableReady = 0;
+    if (!tableReady)
+    {
+        for (uint32_t byte = 0; byte < 256; byte++)
+        {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+            }
+            table[byte] = crc;
+        }
+        tableReady = 1;
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+}
+
+// Size and modification time of a file, as the C++ applications record them
+int getFileVersion(const char *filename, uint64_t *size, int64_t *modifiedNs)
+{
+    struct stat status;
+    if (stat(filename, &status) != 0)
+    {
+        return 0;
+    }
+    *size = (uint64_t)status.st_size;
+#if defined(_WIN32)
+    *modifiedNs = (int64_t)status.st_mtime * 1000000000LL;
+#elif defined(__APPLE__)
+    *modifiedNs = (int64_t)status.st_mtimespec.tv_sec * 1000000000LL + status.st_mtimespec.tv_nsec;
+#else
+    *modifiedNs = (int64_t)status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+#endif
+    return 1;
+}
+
+// Read a whole file into memory; NULL if it cannot be opened
+unsigned char *readWholeFile(const char *filename, size_t *length)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    size_t capacity = 4096;
+    unsigned char *data = malloc(capacity);
+    *length = 0;
+    size_t got;
+    while (data != NULL && (got = fread(data + *length, 1, capacity - *length, file)) > 0)
+    {
+        *length += got;
+        if (*length == capacity)
+        {
+            capacity *= 2;
+            unsigned char *grown = realloc(data, capacity);
+            if (grown == NULL)
+            {
+                free(data);
+            }
+            data = grown;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+// One flag per block of the data, set where the block's checksum does not
+// match. NULL if there are no checksums for this version of the file, e.g.
+// because it was edited by hand since it was saved.
+char *findDamagedBlocks(const char *filename, const unsigned char *data, size_t length)
+{
+    char checksumFilename[256];
+    snprintf(checksumFilename, sizeof(checksumFilename), "%s.crc", filename);
+
+    size_t checksumLength;
+    unsigned char *checksums = readWholeFile(checksumFilename, &checksumLength);
+    if (checksums == NULL)
+    {
+        return NULL;
+    }
+
+    ChecksumHeader header;
+    uint64_t size = 0;
+    int64_t modifiedNs = 0;
+    uint32_t blockCount = (uint32_t)((length + CHECKSUM_BLOCK_BYTES - 1) / CHECKSUM_BLOCK_BYTES);
+    char *damaged = NULL;
+    if (checksumLength >= sizeof(header))
+    {
+        memcpy(&header, checksums, sizeof(header));
+    }
+    if (checksumLength >= sizeof(header) && memcmp(header.magic, "TRKC", 4) == 0 &&
+        header.version == CHECKSUM_VERSION && header.blockBytes == CHECKSUM_BLOCK_BYTES &&
+        header.blockCount == blockCount && checksumLength == sizeof(header) + (size_t)blockCount * 4 &&
+        getFileVersion(filename, &size, &modifiedNs) && header.sourceSize == size &&
+        header.sourceModifiedNs == modifiedNs && size == length)
+    {
+        damaged = calloc(blockCount + 1, 1);
+        for (uint32_t block = 0; damaged != NULL && block < blockCount; block++)
+        {
+            size_t first = (size_t)block * CHECKSUM_BLOCK_BYTES;
+            size_t blockLength = length - first < CHECKSUM_BLOCK_BYTES ? length - first : CHECKSUM_BLOCK_BYTES;
+            uint32_t stored;
+            memcpy(&stored, checksums + sizeof(header) + (size_t)block * 4, 4);
+            damaged[block] = crc32c(data + first, blockLength) != stored;
+        }
+    }
+    free(checksums);
+    return damaged;
+}
+
+// Record the checksums of the data file as it was just saved
+void saveChecksums(const char *filename)
+{
+    size_t length;
+    unsigned char *data = readWholeFile(filename, &length);
+    ChecksumHeader header;
+    if (data == NULL || !getFileVersion(filename, &header.sourceSize, &header.sourceModifiedNs))
+    {
+        free(data);
+        return;
+    }
+    memcpy(header.magic, "TRKC", 4);
+    header.version = CHECKSUM_VERSION;
+    header.blockBytes = CHECKSUM_BLOCK_BYTES;
+    header.blockCount = (uint32_t)((length + CHECKSUM_BLOCK_BYTES - 1) / CHECKSUM_BLOCK_BYTES);
+
+    char checksumFilename[256];
+    snprintf(checksumFilename, sizeof(checksumFilename), "%s.crc", filename);
+    FILE *file = fopen(checksumFilename, "wb");
+    if (file != NULL)
+    {
+        fwrite(&header, sizeof(header), 1, file);
+        for (uint32_t block = 0; block < header.blockCount; block++)
+        {
+            size_t first = (size_t)block * CHECKSUM_BLOCK_BYTES;
+            size_t blockLength = length - first < CHECKSUM_BLOCK_BYTES ? length - first : CHECKSUM_BLOCK_BYTES;
+            uint32_t checksum = crc32c(data + first, blockLength);
+            fwrite(&checksum, sizeof(checksum), 1, file);
+        }
+        fclose(file);
+    }
+    free(data);
+}
+
 // Helper function to get validated integer input
 int getIntegerInput(const char *prompt, int minVal, int maxVal)
 {
@@ -0,0 +1,353 @@
+#include "activity_csv.h"
+#include "buffered_writer.h"
+#include "field_parser.h"
+#include "fixed_point.h"
+#include "number_format.h"
+#include <ostream>
+
+const char ACTIVITY_CSV_HEADER[] = "ActivityType,Date,Duration,Distance,Repetitions";
+
+namespace
+{
+    const size_t ACTIVITY_FIELDS = 5;
+    const size_t GOAL_FIELDS = 7;
+    const size_t GOAL_FIELDS_WITH_ID = 8;
+    const size_t TRACKER_GOAL_FIELDS = 5;
+    const size_t TRACKER_GOAL_FIELDS_WITH_REPS = 6;
+
+    const char *const TYPE_NAMES[] = {"Running", "Walking", "Swimming", "Cardio", "Strength", "Unknown"};
+
+    char toLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // Rows never hold an invalid date, but nothing is written for one
+    void writeDate(BufferedWriter &out, Date date)
+    {
+        if (date.isValid())
+        {
+            char text[10];
+            date.format(text);
+            out.write(text, sizeof(text));
+        }
+    }
+
+    // Case-insensitive comparison of [begin, end) with a NUL-terminated name
+    bool equalsIgnoreCase(const char *begin, const char *end, const char *name)
+    {
+        for (; begin < end; ++begin, ++name)
+        {
+            if (*name == '\0' || toLower(*begin) != toLower(*name))
+            {
+                return false;
+            }
+        }
+        return *name == '\0';
+    }
+
+    // Map a type name to its code; unknown names are not an error
+    int typeCodeFromName(const char *begin, const char *end)
+    {
+        while (begin < end && (*begin == ' ' || *begin == '\t'))
+        {
+            ++begin;
+        }
+        while (end > begin && (*(end - 1) == ' ' || *(end - 1) == '\t' || *(end - 1) == '\r'))
+        {
+            --end;
+        }
+        for (int type = 0; type < UNKNOWN_TYPE_CODE; ++type)
+        {
+            if (equalsIgnoreCase(begin, end, TYPE_NAMES[type]))
+            {
+                return type;
+            }
+        }
+        return UNKNOWN_TYPE_CODE;
+    }
+
+    const char *lineEnd(const char *begin, const char *end)
+    {
+        const char *newline = static_cast<const char *>(
+            std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+        return newline ? newline : end;
+    }
+}
+
+const char *activityTypeName(int type)
+{
+    return (type >= 0 && type < UNKNOWN_TYPE_CODE) ? TYPE_NAMES[type] : TYPE_NAMES[UNKNOWN_TYPE_CODE];
+}
+
+// A header is a first line whose duration column is not a number; the type
+// encoding comes from the first data row
+CsvDialect detectDialect(const char *begin, const char *end, const CsvDialect &fallback)
+{
+    CsvDialect dialect = fallback;
+    if (begin == end)
+    {
+        return dialect;
+    }
+
+    const char *fieldBegin[ACTIVITY_FIELDS];
+    const char *fieldEnd[ACTIVITY_FIELDS];
+    const char *rowEnd = lineEnd(begin, end);
+    double duration;
+
+    size_t fieldCount = splitFields(begin, rowEnd, fieldBegin, fieldEnd, ACTIVITY_FIELDS);
+    dialect.hasHeader = fieldCount >= 3 &&
+                        parseDecimal(fieldBegin[2], fieldEnd[2], duration) != ParseStatus::OK;
+
+    const char *row = dialect.hasHeader ? (rowEnd < end ? rowEnd + 1 : end) : begin;
+    if (row < end)
+    {
+        int type;
+        fieldCount = splitFields(row, lineEnd(row, end), fieldBegin, fieldEnd, 1);
+        if (fieldCount == 1 && fieldBegin[0] != fieldEnd[0])
+        {
+            dialect.typeEncoding = parseInt(fieldBegin[0], fieldEnd[0], type) == ParseStatus::OK
+                                       ? TypeEncoding::CODE
+                                       : TypeEncoding::NAME;
+        }
+    }
+    return dialect;
+}
+
+const char *firstDataRow(const char *begin, const char *end, const CsvDialect &dialect)
+{
+    if (!dialect.hasHeader || begin == end)
+    {
+        return begin;
+    }
+    const char *headerEnd = lineEnd(begin, end);
+    return headerEnd < end ? headerEnd + 1 : end;
+}
+
+// Split a row on commas and convert each field in place
+RowStatus parseActivityRow(const char *begin, const char *end, const CsvDialect &dialect,
+                           ActivityRow &row)
+{
+    const char *fieldBegin[ACTIVITY_FIELDS];
+    const char *fieldEnd[ACTIVITY_FIELDS];
+
+    // Older files have no repetitions column
+    size_t fieldCount = splitFields(begin, end, fieldBegin, fieldEnd, ACTIVITY_FIELDS);
+    if (fieldCount < ACTIVITY_FIELDS - 1)
+    {
+        return RowStatus::SHORT;
+    }
+
+    if (dialect.typeEncoding == TypeEncoding::NAME)
+    {
+        row.type = typeCodeFromName(fieldBegin[0], fieldEnd[0]);
+    }
+    else if (parseInt(fieldBegin[0], fieldEnd[0], row.type) != ParseStatus::OK)
+    {
+        return RowStatus::INVALID;
+    }
+    else if (row.type < 0 || row.type > UNKNOWN_TYPE_CODE)
+    {
+        row.type = UNKNOWN_TYPE_CODE; // Stores keep the type in one byte
+    }
+
+    row.date = Date::parse(fieldBegin[1], fieldEnd[1]);
+    if (!row.date.isValid() ||
+        parseDuration(fieldBegin[2], fieldEnd[2], row.duration) != ParseStatus::OK ||
+        parseDistance(fieldBegin[3], fieldEnd[3], row.distance) != ParseStatus::OK)
+    {
+        return RowStatus::INVALID;
+    }
+    row.repetitions = 0;
+    if (fieldCount == ACTIVITY_FIELDS && parseInt(fieldBegin[4], fieldEnd[4], row.repetitions) != ParseStatus::OK)
+    {
+        return RowStatus::INVALID;
+    }
+    return RowStatus::OK;
+}
+
+void writeActivityRow(BufferedWriter &out, const CsvDialect &dialect, int type, Date date,
+                      double duration, double distance, int repetitions)
+{
+    if (dialect.typeEncoding == TypeEncoding::NAME)
+    {
+        out.write(activityTypeName(type));
+    }
+    else
+    {
+        out.writeInt(type);
+    }
+    out.put(',');
+    writeDate(out, date);
+    out.put(',');
+    out.writeMeasure(duration, DURATION_DECIMALS);
+    out.put(',');
+    out.writeMeasure(distance, DISTANCE_DECIMALS);
+    out.put(',');
+    out.writeInt(repetitions);
+}
+
+// Same text as the BufferedWriter overload, for single journal records
+void writeActivityRow(std::ostream &out, const CsvDialect &dialect, int type, Date date,
+                      double duration, double distance, int repetitions)
+{
+    char number[NUMBER_BUFFER_BYTES];
+    if (dialect.typeEncoding == TypeEncoding::NAME)
+    {
+        out << activityTypeName(type);
+    }
+    else
+    {
+        out.write(number, static_cast<std::streamsize>(formatInt(type, number)));
+    }
+    out << ',' << date << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(duration, DURATION_DECIMALS, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(distance, DISTANCE_DECIMALS, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatInt(repetitions, number)));
+}
+
+void writeGoalRow(BufferedWriter &out, int type, const char *description, size_t descriptionLength,
+                  Date deadline, int targetReps, double targetDuration, double targetDistance, bool achieved, int id,
+                  GoalLayout layout)
+{
+    out.writeInt(type);
+    out.put(',');
+    out.write(description, descriptionLength);
+    out.put(',');
+    writeDate(out, deadline);
+    out.put(',');
+    if (layout == GoalLayout::TRACKER)
+    {
+        out.writeMeasure(targetDuration, DURATION_DECIMALS);
+        out.put(',');
+        out.writeMeasure(targetDistance, DISTANCE_DECIMALS);
+        out.put(',');
+        out.writeInt(targetReps);
+        return;
+    }
+    out.writeInt(targetReps);
+    out.put(',');
+    out.writeMeasure(targetDuration, DURATION_DECIMALS);
+    out.put(',');
+    out.writeMeasure(targetDistance, DISTANCE_DECIMALS);
+    out.put(',');
+    out.put(achieved ? '1' : '0');
+    if (id >= 0)
+    {
+        out.put(',');
+        out.writeInt(id);
+    }
+}
+
+// Same text as the BufferedWriter overload, for rows built one at a time
+void writeGoalRow(std::ostream &out, int type, const char *description, size_t descriptionLength,
+                  Date deadline, int targetReps, double targetDuration, double targetDistance, bool achieved, int id,
+                  GoalLayout layout)
+{
+    char number[NUMBER_BUFFER_BYTES];
+    out.write(number, static_cast<std::streamsize>(formatInt(type, number)));
+    out << ',';
+    out.write(description, static_cast<std::streamsize>(descriptionLength));
+    out << ',' << deadline << ',';
+    if (layout == GoalLayout::TRACKER)
+    {
+        out.write(number, static_cast<std::streamsize>(formatMeasure(targetDuration, DURATION_DECIMALS, number)));
+        out << ',';
+        out.write(number, static_cast<std::streamsize>(formatMeasure(targetDistance, DISTANCE_DECIMALS, number)));
+        out << ',';
+        out.write(number, static_cast<std::streamsize>(formatInt(targetReps, number)));
+        return;
+    }
+    out.write(number, static_cast<std::streamsize>(formatInt(targetReps, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(targetDuration, DURATION_DECIMALS, number)));
+    out << ',';
+    out.write(number, static_cast<std::streamsize>(formatMeasure(targetDistance, DISTANCE_DECIMALS, number)));
+    out << ',' << (achieved ? '1' : '0');
+    if (id >= 0)
+    {
+        out << ',';
+        out.write(number, static_cast<std::streamsize>(formatInt(id, number)));
+    }
+}
+
+// Split a goal row on commas and convert each field in place
+RowStatus parseGoalRow(const char *begin, const char *end, GoalRow &row, GoalLayout layout)
+{
+    const char *fieldBegin[GOAL_FIELDS_WITH_ID];
+    const char *fieldEnd[GOAL_FIELDS_WITH_ID];
+
+    if (layout == GoalLayout::TRACKER)
+    {
+        size_t fieldCount = splitFields(begin, end, fieldBegin, fieldEnd, TRACKER_GOAL_FIELDS_WITH_REPS);
+        if (fieldCount < TRACKER_GOAL_FIELDS)
+        {
+            return RowStatus::SHORT;
+        }
+        row.id = -1;
+        row.targetReps = 0;
+        row.deadline = Date::parse(fieldBegin[2], fieldEnd[2]);
+        if (!row.deadline.isValid() ||
+            parseInt(fieldBegin[0], fieldEnd[0], row.type) != ParseStatus::OK ||
+            parseDuration(fieldBegin[3], fieldEnd[3], row.targetDuration) != ParseStatus::OK ||
+            parseDistance(fieldBegin[4], fieldEnd[4], row.targetDistance) != ParseStatus::OK ||
+            (fieldCount == TRACKER_GOAL_FIELDS_WITH_REPS &&
+             parseInt(fieldBegin[5], fieldEnd[5], row.targetReps) != ParseStatus::OK))
+        {
+            return RowStatus::INVALID;
+        }
+        row.description = fieldBegin[1];
+        row.descriptionLength = static_cast<size_t>(fieldEnd[1] - fieldBegin[1]);
+        row.achieved = false;
+        return RowStatus::OK;
+    }
+
+    size_t fieldCount = splitFields(begin, end, fieldBegin, fieldEnd, GOAL_FIELDS_WITH_ID);
+    if (fieldCount < GOAL_FIELDS)
+    {
+        return RowStatus::SHORT;
+    }
+
+    row.id = -1;
+    if (fieldCount == GOAL_FIELDS_WITH_ID &&
+        (parseInt(fieldBegin[7], fieldEnd[7], row.id) != ParseStatus::OK || row.id < 0))
+    {
+        return RowStatus::INVALID;
+    }
+
+    row.deadline = Date::parse(fieldBegin[2], fieldEnd[2]);
+    if (!row.deadline.isValid() ||
+        parseInt(fieldBegin[0], fieldEnd[0], row.type) != ParseStatus::OK ||
+        parseInt(fieldBegin[3], fieldEnd[3], row.targetReps) != ParseStatus::OK ||
+        parseDuration(fieldBegin[4], fieldEnd[4], row.targetDuration) != ParseStatus::OK ||
+        parseDistance(fieldBegin[5], fieldEnd[5], row.targetDistance) != ParseStatus::OK)
+    {
+        return RowStatus::INVALID;
+    }
+
+    row.description = fieldBegin[1];
+    row.descriptionLength = static_cast<size_t>(fieldEnd[1] - fieldBegin[1]);
+    row.achieved = (fieldEnd[6] - fieldBegin[6] == 1 && *fieldBegin[6] == '1');
+    return RowStatus::OK;
+}
+
+// Count newline-terminated lines plus a trailing unterminated one
+size_t countLines(const char *begin, const char *end)
+{
+    size_t lines = 0;
+    const char *cursor = begin;
+    while (cursor < end)
+    {
+        const char *newline = static_cast<const char *>(
+            std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+        ++lines;
+        if (!newline)
+        {
+            break;
+        }
+        cursor = newline + 1;
+    }
+    return lines;
+}
@@ -0,0 +1,220 @@
+#ifndef ACTIVITY_CSV_H
+#define ACTIVITY_CSV_H
+
+#include "date.h"
+#include <cstddef>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+
+class BufferedWriter;
+
+// Fields of one activity row
+struct ActivityRow
+{
+    int type = 0;
+    Date date;
+    double duration = 0.0;
+    double distance = 0.0;
+    int repetitions = 0;
+};
+
+// Column order of a goals file
+enum class GoalLayout
+{
+    SHARED, // type,description,deadline,reps,duration,distance,achieved[,id] (app_1, app_2, PP)
+    TRACKER // type,description,deadline,duration,distance[,reps] (sports_tracker_cpp)
+};
+
+// Fields of one goal row; TRACKER rows have no achieved flag or ID
+struct GoalRow
+{
+    int id = -1; // -1 for rows written before goals had stable IDs
+    int type = 0;
+    const char *description = nullptr;
+    size_t descriptionLength = 0;
+    Date deadline;
+    int targetReps = 0;
+    double targetDuration = 0.0;
+    double targetDistance = 0.0;
+    bool achieved = false;
+};
+
+// How the activity type column is spelled
+enum class TypeEncoding
+{
+    CODE, // 0-4, as written by app_1, app_2 and sports_tracker_cpp
+    NAME  // Running, Walking, ..., as written by the PP applications
+};
+
+// On-disk layout of an activities file. All front ends share the column
+// order type,date,duration,distance,repetitions; they differ only in these.
+struct CsvDialect
+{
+    TypeEncoding typeEncoding;
+    bool hasHeader;
+};
+
+const CsvDialect CODE_DIALECT = {TypeEncoding::CODE, false};
+const CsvDialect NAME_DIALECT = {TypeEncoding::NAME, true};
+
+// Header line written in front of NAME_DIALECT files
+extern const char ACTIVITY_CSV_HEADER[];
+
+// Type code used for names and codes outside 0-4
+const int UNKNOWN_TYPE_CODE = 5;
+
+// Display and file name of a type code ("Unknown" when out of range)
+const char *activityTypeName(int type);
+
+// Guess the dialect of a file from its first line. An empty buffer gives
+// the fallback dialect.
+CsvDialect detectDialect(const char *begin, const char *end, const CsvDialect &fallback);
+
+// Start of the first data row, past the header if the dialect has one
+const char *firstDataRow(const char *begin, const char *end, const CsvDialect &dialect);
+
+// Result of parsing a single row
+enum class RowStatus
+{
+    OK,
+    SHORT,  // Fewer fields than a record needs; skipped silently
+    INVALID // Enough fields, but a value could not be parsed
+};
+
+// Parse "type,date,duration,distance[,repetitions]" from [begin, end); rows
+// without repetitions, as older files have, get 0. Named types are matched
+// case-insensitively; unrecognised names and out-of-range codes become
+// UNKNOWN_TYPE_CODE. A date that is not YYYY-MM-DD makes the row INVALID.
+// Durations and distances are read to whole centiminutes and metres, or
+// kept as written if they have more decimals (see fixed_point.h).
+RowStatus parseActivityRow(const char *begin, const char *end, const CsvDialect &dialect,
+                           ActivityRow &row);
+
+// Parse a row with integer type codes
+inline RowStatus parseActivityRow(const char *begin, const char *end, ActivityRow &row)
+{
+    return parseActivityRow(begin, end, CODE_DIALECT, row);
+}
+
+// Write one row without a line ending. The duration and distance are
+// written as whole centiminutes and metres, without trailing zeros, or as
+// the shortest decimal for a finer value, so they read back exactly (see
+// fixed_point.h).
+void writeActivityRow(BufferedWriter &out, const CsvDialect &dialect, int type, Date date,
+                      double duration, double distance, int repetitions);
+void writeActivityRow(std::ostream &out, const CsvDialect &dialect, int type, Date date,
+                      double duration, double distance, int repetitions);
+
+// Write any Activity-like record (type, date, duration, distance, repetitions)
+template <typename Output, typename ActivityRecord>
+void writeActivity(Output &out, const CsvDialect &dialect, const ActivityRecord &activity)
+{
+    writeActivityRow(out, dialect, static_cast<int>(activity.type), activity.date,
+                     activity.duration, activity.distance, activity.repetitions);
+}
+
+// Parse a goal row in the same comma-separated layout; like activity rows,
+// a deadline that is not YYYY-MM-DD makes it INVALID, and target durations
+// and distances are parsed like activity ones. A TRACKER row without its
+// repetitions column has none.
+RowStatus parseGoalRow(const char *begin, const char *end, GoalRow &row,
+                       GoalLayout layout = GoalLayout::SHARED);
+
+// Write one goal row in the layout parseGoalRow reads, without a line
+// ending; the ID column is left out when id is negative, and TRACKER rows
+// leave out achieved and id
+void writeGoalRow(BufferedWriter &out, int type, const char *description, size_t descriptionLength,
+                  Date deadline, int targetReps, double targetDuration, double targetDistance, bool achieved, int id,
+                  GoalLayout layout = GoalLayout::SHARED);
+void writeGoalRow(std::ostream &out, int type, const char *description, size_t descriptionLength,
+                  Date deadline, int targetReps, double targetDuration, double targetDistance, bool achieved, int id,
+                  GoalLayout layout = GoalLayout::SHARED);
+
+// Write any Goal-like record with the fields above; its description may be
+// any string type with data() and size()
+template <typename Output, typename GoalRecord>
+void writeGoal(Output &out, const GoalRecord &goal)
+{
+    writeGoalRow(out, static_cast<int>(goal.type), goal.description.data(), goal.description.size(),
+                 goal.deadline, goal.targetReps, goal.targetDuration, goal.targetDistance, goal.achieved, goal.id);
+}
+
+// Write a sports_tracker_cpp goal, which has no ID, in the TRACKER layout
+template <typename Output, typename GoalRecord>
+void writeTrackerGoal(Output &out, const GoalRecord &goal)
+{
+    writeGoalRow(out, static_cast<int>(goal.type), goal.description.data(), goal.description.size(),
+                 goal.deadline, goal.targetReps, goal.targetDuration, goal.targetDistance, false, -1,
+                 GoalLayout::TRACKER);
+}
+
+// Count the lines in [begin, end) so callers can reserve storage up front
+size_t countLines(const char *begin, const char *end);
+
+// Call visitor(lineBegin, lineEnd) for each line in [begin, end) until it
+// returns false. Line terminators (\n or \r\n) are not part of the range.
+// Returns false if the visitor stopped early.
+template <typename Visitor>
+bool forEachLineWhile(const char *begin, const char *end, Visitor visitor)
+{
+    const char *lineBegin = begin;
+    while (lineBegin < end)
+    {
+        const char *newline = static_cast<const char *>(
+            std::memchr(lineBegin, '\n', static_cast<size_t>(end - lineBegin)));
+        const char *lineEnd = newline ? newline : end;
+        const char *contentEnd = lineEnd;
+        if (contentEnd > lineBegin && *(contentEnd - 1) == '\r')
+        {
+            --contentEnd;
+        }
+
+        if (!visitor(lineBegin, contentEnd))
+        {
+            return false;
+        }
+
+        if (!newline)
+        {
+            break;
+        }
+        lineBegin = newline + 1;
+    }
+    return true;
+}
+
+// Call visitor(lineBegin, lineEnd) for every line in [begin, end)
+template <typename Visitor>
+void forEachLine(const char *begin, const char *end, Visitor visitor)
+{
+    forEachLineWhile(begin, end, [&visitor](const char *lineBegin, const char *lineEnd)
+    {
+        visitor(lineBegin, lineEnd);
+        return true;
+    });
+}
+
+// Parse every activity row of a file buffer in the given dialect, skipping
+// its header. onRow(const ActivityRow &) returns false to stop early;
+// onInvalid(lineBegin, lineEnd) is told about rows that fail to parse.
+// Returns false if onRow stopped the scan.
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachActivityRow(const char *begin, const char *end, const CsvDialect &dialect,
+                        RowVisitor onRow, InvalidVisitor onInvalid)
+{
+    return forEachLineWhile(firstDataRow(begin, end, dialect), end,
+                            [&](const char *lineBegin, const char *lineEnd) -> bool
+    {
+        ActivityRow row;
+        RowStatus status = parseActivityRow(lineBegin, lineEnd, dialect, row);
+        if (status == RowStatus::INVALID)
+        {
+            onInvalid(lineBegin, lineEnd);
+            return true;
+        }
+        return status != RowStatus::OK || onRow(row);
+    });
+}
+
+#endif // ACTIVITY_CSV_H
@@ -0,0 +1,348 @@
+#ifndef ACTIVITY_FILE_H
+#define ACTIVITY_FILE_H
+
+#include "activity_csv.h"
+#include "activity_store.h"
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "file_info.h"
+#include "file_lock.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "row_index.h"
+#include "snapshot.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Map a data file and its journal as one consistent version (see
+// file_lock.h); either may be missing
+inline void openActivityFiles(const std::string &dataPath, MappedFile &data, MappedFile &journal)
+{
+    openPublishedVersion(dataPath, [&]()
+    {
+        data.open(dataPath);
+        journal.open(journalPathFor(dataPath));
+    });
+}
+
+// Stream the activity rows of a data file, then of its journal, without
+// building a vector. Each file's dialect is detected from its contents, so
+// the same code reads files written by any front end, and a compressed data
+// file (see compressed_store.h) is decoded block by block; fallback is used
+// for empty files. Rows in blocks that fail their checksum (see
+// block_checksums.h) go to onInvalid, and onRow gets a placeholder for each
+// so the rows after them keep their IDs. Visitors are as for
+// forEachActivityRow. Returns false if onRow stopped early; missing files
+// simply contribute no rows.
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachActivityInFiles(const std::string &dataPath, const CsvDialect &fallback,
+                            RowVisitor onRow, InvalidVisitor onInvalid)
+{
+    MappedFile data;
+    MappedFile journal;
+    openActivityFiles(dataPath, data, journal);
+
+    if (data.isOpen())
+    {
+        if (hasCompressedMagic(data.begin(), data.end()))
+        {
+            if (!forEachCompressedActivity(data.begin(), data.end(), onRow, onInvalid))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            CsvDialect dialect = detectDialect(data.begin(), data.end(), fallback);
+            std::vector<TextRange> damaged;
+            findDamagedRanges(dataPath, data, damaged);
+            if (!forEachIntactActivityRow(dataPath, data, dialect, damaged, onRow, onInvalid))
+            {
+                return false;
+            }
+        }
+    }
+
+    // The journal never has a header; a torn last record is ignored
+    if (journal.isOpen())
+    {
+        const char *journalEnd = completeLinesEnd(journal.begin(), journal.end());
+        CsvDialect dialect = detectDialect(journal.begin(), journalEnd, fallback);
+        dialect.hasHeader = false;
+        return forEachActivityRow(journal.begin(), journalEnd, dialect, onRow, onInvalid);
+    }
+    return true;
+}
+
+// A front end's Activity (public type, date, duration, distance and
+// repetitions) built from a parsed row
+template <typename Record>
+Record activityFromRow(const ActivityRow &row)
+{
+    Record activity;
+    activity.type = static_cast<decltype(activity.type)>(row.type);
+    activity.date = row.date;
+    activity.duration = row.duration;
+    activity.distance = row.distance;
+    activity.repetitions = row.repetitions;
+    return activity;
+}
+
+// Load every activity of a data file and then of its journal into
+// activities, a std::vector or ActivityStore of the front end's Activity.
+// The data comes from a snapshot (see snapshot.h) while it is fresh, else
+// from the compressed or CSV file. The rows of CSV blocks that fail their
+// checksum are replaced by placeholders (see damagedRowPlaceholder), so
+// IDs stay as the ID index has them, and each damaged range goes to
+// onDamaged(firstByte, endByte, rows). Loading writes nothing: the snapshot
+// is only rebuilt by saveActivitiesToFile. onInvalid is as for
+// forEachActivityRow. Returns false if there is no data file; the journal
+// is still replayed.
+template <typename Store, typename InvalidVisitor, typename DamagedVisitor>
+bool loadActivitiesFromFiles(const std::string &dataPath, const CsvDialect &fallback, Store &activities,
+                             InvalidVisitor onInvalid, DamagedVisitor onDamaged)
+{
+    typedef typename Store::value_type Record;
+
+    // Take the snapshot or data file and the journal from one version; a
+    // concurrent compaction waits until they are open (see file_lock.h)
+    MappedFile data;
+    MappedFile journal;
+    bool fromSnapshot = false;
+    openPublishedVersion(dataPath, [&]()
+    {
+        data.close();
+        activities.clear();
+        fromSnapshot = loadActivitySnapshot(dataPath, activities);
+        if (!fromSnapshot)
+        {
+            data.open(dataPath);
+        }
+        journal.open(journalPathFor(dataPath));
+    });
+
+    auto onRow = [&activities](const ActivityRow &row)
+    {
+        activities.push_back(activityFromRow<Record>(row));
+        return true;
+    };
+
+    if (data.isOpen() && hasCompressedMagic(data.begin(), data.end()))
+    {
+        // Decoding a compressed file is about as quick as reading a
+        // snapshot, so it does not get one
+        uint64_t compressedRows;
+        if (compressedRowCount(data.begin(), data.end(), compressedRows))
+        {
+            activities.reserve(compressedRows);
+        }
+        forEachCompressedActivity(data.begin(), data.end(), onRow, onInvalid);
+    }
+    else if (data.isOpen())
+    {
+        activities.reserve(countLines(data.begin(), data.end()));
+        CsvDialect dialect = detectDialect(data.begin(), data.end(), fallback);
+        std::vector<TextRange> damaged;
+        findDamagedRanges(dataPath, data, damaged);
+
+        const char *cursor = data.begin();
+        for (const TextRange &range : damaged)
+        {
+            forEachActivityRow(cursor, range.begin, dialect, onRow, onInvalid);
+            size_t rows = damagedRowCount(dataPath, data, dialect, range);
+            for (size_t placeholder = 0; placeholder < rows; ++placeholder)
+            {
+                activities.push_back(activityFromRow<Record>(damagedRowPlaceholder()));
+            }
+            dialect.hasHeader = false; // Whichever segment held it is done
+            onDamaged(static_cast<uint64_t>(range.begin - data.begin()), static_cast<uint64_t>(range.end - data.begin()),
+                      rows);
+            cursor = range.end;
+        }
+        forEachActivityRow(cursor, data.end(), dialect, onRow, onInvalid);
+    }
+
+    // The journal never has a header; a torn last record is ignored
+    if (journal.isOpen())
+    {
+        const char *journalEnd = completeLinesEnd(journal.begin(), journal.end());
+        CsvDialect dialect = detectDialect(journal.begin(), journalEnd, fallback);
+        dialect.hasHeader = false;
+        forEachActivityRow(journal.begin(), journalEnd, dialect, onRow, onInvalid);
+    }
+    return fromSnapshot || data.isOpen();
+}
+
+// Rewrite a data file from activities, a std::vector or ActivityStore, and
+// drop the journal it absorbed; readers see the new file and the end of the
+// journal together (see file_lock.h). A compressed file is written
+// compressed again (see compressed_store.h). A CSV file is written in
+// dialect with its block checksums, which are published with it, and its
+// snapshot and ID index are rebuilt from the rows as written. Callers check hasDamagedRanges first: activities
+// loaded from a damaged file hold placeholders, not the damaged rows. Returns false if the file could not be written, a
+// row does not fit the compressed format, or the journal stays.
+template <typename Store>
+bool saveActivitiesToFile(const std::string &dataPath, const CsvDialect &dialect, const Store &activities)
+{
+    bool compressed = isCompressedFile(dataPath);
+    BufferedWriter out;
+    CompressedWriter compressedOut;
+    std::vector<uint64_t> offsets; // Row offsets come for free while writing
+    if (compressed)
+    {
+        if (!compressedOut.open(dataPath) || !appendActivities(compressedOut, activities))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (!out.open(dataPath, WriteMode::REPLACE_CHECKSUMMED))
+        {
+            return false;
+        }
+        if (dialect.hasHeader)
+        {
+            out.write(ACTIVITY_CSV_HEADER);
+            out.put('\n');
+        }
+        offsets.reserve(activities.size());
+        for (const auto &activity : activities)
+        {
+            offsets.push_back(out.bytesWritten());
+            writeActivity(out, dialect, activity);
+            out.put('\n');
+        }
+    }
+
+    FileLock publish;
+    publish.lock(publishLockPathFor(dataPath), LockMode::EXCLUSIVE);
+    if (!(compressed ? compressedOut.close() : out.close()) || !removeJournal(journalPathFor(dataPath)))
+    {
+        return false;
+    }
+    publish.unlock();
+
+    // Compressed blocks carry their own row ranges and checksums, and
+    // decode quickly
+    if (!compressed)
+    {
+        FileInfo info;
+        if (getFileInfo(dataPath, info))
+        {
+            saveActivitySnapshot(dataPath, info, activities);
+        }
+        saveRowIndex(dataPath, offsets);
+    }
+    return true;
+}
+
+// Find the activity with the given ID (see row_index.h) and call
+// onRow(const ActivityRow &) for it. Rows of the data file are reached
+// through its index without parsing the rows in front; without a current
+// index the rows are counted in one pass, and the index is left for the
+// next save to rebuild. A compressed
+// data file needs no index: only the block holding the row is decoded. A
+// row whose checksum block is damaged is not found. IDs past the data file
+// are looked up in the journal, which compaction keeps small. Returns false
+// if there is no such activity.
+template <typename RowVisitor>
+bool findActivityInFiles(const std::string &dataPath, const CsvDialect &fallback,
+                         uint64_t id, RowVisitor onRow)
+{
+    uint64_t dataRows = 0;
+    MappedFile data;
+    MappedFile journal;
+    openActivityFiles(dataPath, data, journal);
+
+    if (data.isOpen() && hasCompressedMagic(data.begin(), data.end()))
+    {
+        if (!compressedRowCount(data.begin(), data.end(), dataRows))
+        {
+            return false;
+        }
+        if (id < dataRows)
+        {
+            CompressedRange range;
+            range.firstRow = id;
+            return !forEachCompressedActivity(data.begin(), data.end(), range, [&onRow](const ActivityRow &row)
+            {
+                onRow(row);
+                return false;
+            },
+            [](const char *, const char *) {});
+        }
+    }
+    else if (data.isOpen())
+    {
+        CsvDialect dialect = detectDialect(data.begin(), data.end(), fallback);
+        RowIndex index;
+        std::vector<uint64_t> offsets;
+        uint64_t offset = 0;
+        if (index.open(dataPath, data.fileInfo()))
+        {
+            dataRows = index.rowCount();
+            if (id < dataRows)
+            {
+                offset = index.offset(id);
+            }
+        }
+        else
+        {
+            std::vector<TextRange> damaged;
+            findDamagedRanges(dataPath, data, damaged);
+            collectIntactRowOffsets(dataPath, data, dialect, damaged, offsets);
+            dataRows = offsets.size();
+            if (id < dataRows)
+            {
+                offset = offsets[id];
+            }
+        }
+
+        if (id < dataRows)
+        {
+            const char *lineBegin;
+            const char *lineEnd;
+            ActivityRow row;
+            if (offset >= data.size())
+            {
+                return false;
+            }
+            lineAt(data.begin(), data.end(), offset, lineBegin, lineEnd);
+            if (!verifyBlockChecksums(dataPath, data, offset, static_cast<uint64_t>(lineEnd - data.begin()) + 1) ||
+                parseActivityRow(lineBegin, lineEnd, dialect, row) != RowStatus::OK)
+            {
+                return false;
+            }
+            onRow(row);
+            return true;
+        }
+    }
+
+    if (!journal.isOpen())
+    {
+        return false;
+    }
+    const char *journalEnd = completeLinesEnd(journal.begin(), journal.end());
+    CsvDialect dialect = detectDialect(journal.begin(), journalEnd, fallback);
+    dialect.hasHeader = false;
+
+    uint64_t position = dataRows;
+    bool found = false;
+    forEachActivityRow(journal.begin(), journalEnd, dialect, [&](const ActivityRow &row) -> bool
+    {
+        if (position++ != id)
+        {
+            return true;
+        }
+        onRow(row);
+        found = true;
+        return false;
+    },
+    [](const char *, const char *) {});
+    return found;
+}
+
+#endif // ACTIVITY_FILE_H
@@ -0,0 +1,60 @@
+#include "activity_store.h"
+#include <algorithm>
+
+TypeTotals totalByType(const ActivityColumns &columns)
+{
+    TypeTotals totals;
+    const uint8_t *type = columns.type.data();
+    const int32_t *duration = columns.duration.data();
+    const int32_t *distance = columns.distance.data();
+    const int32_t *repetitions = columns.repetitions.data();
+    for (size_t i = 0, rows = columns.size(); i < rows; ++i)
+    {
+        ActivityTotals &total = totals.byType[type[i]];
+        ++total.count;
+        total.centiminutes += duration[i];
+        total.metres += distance[i];
+        total.repetitions += repetitions[i];
+    }
+    return totals;
+}
+
+namespace
+{
+    template <bool CheckDay>
+    ActivityTotals addRows(const ActivityColumns &columns, const std::vector<uint32_t> &rows, int32_t lastDay)
+    {
+        ActivityTotals total;
+        const int32_t *day = columns.day.data();
+        const int32_t *duration = columns.duration.data();
+        const int32_t *distance = columns.distance.data();
+        const int32_t *repetitions = columns.repetitions.data();
+        for (uint32_t row : rows)
+        {
+            if (CheckDay && day[row] > lastDay)
+            {
+                continue;
+            }
+            ++total.count;
+            total.centiminutes += duration[row];
+            total.metres += distance[row];
+            total.repetitions += repetitions[row];
+        }
+        return total;
+    }
+}
+
+ActivityTotals totalOfRows(const ActivityColumns &columns, const std::vector<uint32_t> &rows)
+{
+    return addRows<false>(columns, rows, 0);
+}
+
+ActivityTotals totalOfRows(const ActivityColumns &columns, const std::vector<uint32_t> &rows, int32_t lastDay)
+{
+    return addRows<true>(columns, rows, lastDay);
+}
+
+bool allRowsDated(const ActivityColumns &columns)
+{
+    return std::find(columns.day.begin(), columns.day.end(), INVALID_DAY_NUMBER) == columns.day.end();
+}
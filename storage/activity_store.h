@@ -0,0 +1,273 @@
+#ifndef ACTIVITY_STORE_H
+#define ACTIVITY_STORE_H
+
+#include "date.h"
+#include "file_info.h"
+#include "fixed_point.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Type codes a type column can hold
+const size_t ACTIVITY_TYPE_CODES = 256;
+
+// Row count and column sums of one type code. Durations and distances are
+// exact sums of whole units (see fixed_point.h); a value finer than the
+// units counts as its nearest unit.
+struct ActivityTotals
+{
+    uint64_t count = 0;
+    int64_t centiminutes = 0;
+    int64_t metres = 0;
+    int64_t repetitions = 0;
+
+    double minutes() const { return minutesFrom(centiminutes); }
+    double kilometres() const { return kilometresFrom(metres); }
+};
+
+// Totals of every type code, indexed by code
+struct TypeTotals
+{
+    ActivityTotals byType[ACTIVITY_TYPE_CODES];
+
+    const ActivityTotals &operator[](size_t type) const { return byType[type]; }
+};
+
+// Add up all rows by type in one pass over the type, duration, distance and
+// repetitions columns; the day column is never read.
+TypeTotals totalByType(const ActivityColumns &columns);
+
+// Add up the given rows. The first form reads no dates; the second leaves
+// out rows dated after lastDay.
+ActivityTotals totalOfRows(const ActivityColumns &columns, const std::vector<uint32_t> &rows);
+ActivityTotals totalOfRows(const ActivityColumns &columns, const std::vector<uint32_t> &rows, int32_t lastDay);
+
+// True if every row has a valid date, as a snapshot needs
+bool allRowsDated(const ActivityColumns &columns);
+
+// Activities kept column by column instead of as an array of records, so a
+// scan that needs one or two fields reads only those columns. Record is the
+// front end's Activity (type, Date, duration, distance, repetitions). Rows go
+// in as records and come out as records, by value, so loops over records
+// keep working; aggregations use columns() instead. Durations and distances
+// are stored as centiminutes and metres. The few that are not a whole
+// number of units keep their exact value by row beside the columns, so the
+// records read back as they went in.
+//
+// The store also keeps the positions of each type's rows, updated as rows
+// are added, so a per-type sum such as goal progress reads only that type's
+// rows instead of testing every row's type.
+template <typename Record>
+class ActivityStore
+{
+public:
+    typedef Record value_type;
+
+    // Walks the rows in order, building each record as it is read
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Record value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Record *pointer;
+        typedef Record reference;
+
+        const_iterator() : store(nullptr), row(0) {}
+        const_iterator(const ActivityStore *store, size_t row) : store(store), row(row) {}
+
+        Record operator*() const { return (*store)[row]; }
+        const_iterator &operator++()
+        {
+            ++row;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator before = *this;
+            ++row;
+            return before;
+        }
+        bool operator==(const const_iterator &other) const { return row == other.row; }
+        bool operator!=(const const_iterator &other) const { return row != other.row; }
+
+        // Position of the current row
+        size_t index() const { return row; }
+
+    private:
+        const ActivityStore *store;
+        size_t row;
+    };
+
+    size_t size() const { return rows.size(); }
+    bool empty() const { return rows.size() == 0; }
+    void clear()
+    {
+        rows.clear();
+        typeRows.clear();
+        preciseDuration.clear();
+        preciseDistance.clear();
+    }
+    void reserve(size_t count) { rows.reserve(count); }
+
+    void push_back(const Record &activity)
+    {
+        uint32_t row = static_cast<uint32_t>(rows.size());
+        indexRow(static_cast<uint8_t>(activity.type), row);
+        rows.type.push_back(static_cast<uint8_t>(activity.type));
+        rows.day.push_back(activity.date.dayNumber());
+        rows.duration.push_back(toCentiminutes(activity.duration));
+        rows.distance.push_back(toMetres(activity.distance));
+        rows.repetitions.push_back(activity.repetitions);
+        if (minutesFrom(rows.duration.back()) != activity.duration)
+        {
+            preciseDuration[row] = activity.duration;
+        }
+        if (kilometresFrom(rows.distance.back()) != activity.distance)
+        {
+            preciseDistance[row] = activity.distance;
+        }
+    }
+
+    template <typename... Args>
+    void emplace_back(Args &&...args)
+    {
+        push_back(Record(std::forward<Args>(args)...));
+    }
+
+    // Append every row of other
+    void append(const ActivityStore &other)
+    {
+        size_t offset = rows.size();
+        if (typeRows.size() < other.typeRows.size())
+        {
+            typeRows.resize(other.typeRows.size());
+        }
+        for (size_t type = 0; type < other.typeRows.size(); ++type)
+        {
+            for (uint32_t row : other.typeRows[type])
+            {
+                typeRows[type].push_back(static_cast<uint32_t>(offset + row));
+            }
+        }
+
+        const ActivityColumns &from = other.rows;
+        rows.type.insert(rows.type.end(), from.type.begin(), from.type.end());
+        rows.day.insert(rows.day.end(), from.day.begin(), from.day.end());
+        rows.duration.insert(rows.duration.end(), from.duration.begin(), from.duration.end());
+        rows.distance.insert(rows.distance.end(), from.distance.begin(), from.distance.end());
+        rows.repetitions.insert(rows.repetitions.end(), from.repetitions.begin(), from.repetitions.end());
+        for (const auto &precise : other.preciseDuration)
+        {
+            preciseDuration[static_cast<uint32_t>(offset + precise.first)] = precise.second;
+        }
+        for (const auto &precise : other.preciseDistance)
+        {
+            preciseDistance[static_cast<uint32_t>(offset + precise.first)] = precise.second;
+        }
+    }
+
+    // Row i as a record
+    Record operator[](size_t i) const
+    {
+        Record activity;
+        activity.type = static_cast<decltype(activity.type)>(rows.type[i]);
+        activity.date = Date(rows.day[i]);
+        activity.duration = minutesFrom(rows.duration[i]);
+        activity.distance = kilometresFrom(rows.distance[i]);
+        activity.repetitions = rows.repetitions[i];
+        if (!allWholeUnits())
+        {
+            auto duration = preciseDuration.find(static_cast<uint32_t>(i));
+            auto distance = preciseDistance.find(static_cast<uint32_t>(i));
+            if (duration != preciseDuration.end())
+            {
+                activity.duration = duration->second;
+            }
+            if (distance != preciseDistance.end())
+            {
+                activity.distance = distance->second;
+            }
+        }
+        return activity;
+    }
+
+    // True if the columns hold every duration and distance exactly
+    bool allWholeUnits() const { return preciseDuration.empty() && preciseDistance.empty(); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    const ActivityColumns &columns() const { return rows; }
+
+    // Positions of the rows of one type code, in row order
+    const std::vector<uint32_t> &rowsOfType(uint8_t type) const
+    {
+        static const std::vector<uint32_t> none;
+        return type < typeRows.size() ? typeRows[type] : none;
+    }
+
+    // Totals of one type's rows, optionally only those dated up to lastDay
+    ActivityTotals totalOfType(uint8_t type) const { return totalOfRows(rows, rowsOfType(type)); }
+    ActivityTotals totalOfType(uint8_t type, int32_t lastDay) const { return totalOfRows(rows, rowsOfType(type), lastDay); }
+
+    // Take over rows already laid out as columns, e.g. a snapshot
+    void assign(ActivityColumns &&columns)
+    {
+        rows = std::move(columns);
+        typeRows.clear();
+        preciseDuration.clear();
+        preciseDistance.clear();
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            indexRow(rows.type[i], i);
+        }
+    }
+
+private:
+    ActivityColumns rows;
+    std::vector<std::vector<uint32_t>> typeRows; // Row positions by type code
+    std::unordered_map<uint32_t, double> preciseDuration; // Row -> minutes finer than centiminutes
+    std::unordered_map<uint32_t, double> preciseDistance; // Row -> kilometres finer than metres
+
+    void indexRow(uint8_t type, size_t row)
+    {
+        if (typeRows.size() <= type)
+        {
+            typeRows.resize(type + 1);
+        }
+        typeRows[type].push_back(static_cast<uint32_t>(row));
+    }
+};
+
+// Load the snapshot of csvPath straight into the store's columns if it is
+// up to date; unlike the vector version nothing is converted
+template <typename Record>
+bool loadActivitySnapshot(const std::string &csvPath, ActivityStore<Record> &activities)
+{
+    std::string snapshotPath = snapshotPathFor(csvPath);
+    ActivityColumns columns;
+    if (!isSnapshotFresh(snapshotPath, csvPath) || !readActivitySnapshot(snapshotPath, columns))
+    {
+        return false;
+    }
+    activities.assign(std::move(columns));
+    return true;
+}
+
+// Record the store as the snapshot of the version of csvPath in csvInfo,
+// writing its columns as they are; a store holding values finer than the
+// units gets none
+template <typename Record>
+bool saveActivitySnapshot(const std::string &csvPath, const FileInfo &csvInfo, const ActivityStore<Record> &activities)
+{
+    return allRowsDated(activities.columns()) && activities.allWholeUnits() &&
+           writeActivitySnapshot(snapshotPathFor(csvPath), csvInfo, activities.columns());
+}
+
+#endif // ACTIVITY_STORE_H
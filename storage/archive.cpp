@@ -0,0 +1,419 @@
+#include "archive.h"
+#include "activity_csv.h"
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "checksum.h"
+#include "durability.h"
+#include "file_info.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    const char ARCHIVE_MAGIC[4] = {'T', 'R', 'K', 'A'};
+
+    struct ArchiveHeader
+    {
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct BlockHeader
+    {
+        uint32_t member;
+        uint32_t length;
+        uint32_t checksum;
+    };
+
+    uint32_t blockChecksum(uint32_t member, uint32_t length, const char *data)
+    {
+        uint32_t fields[2] = {member, length};
+        return crc32c(data, length, crc32c(fields, sizeof(fields)));
+    }
+
+    void writeBlock(BufferedWriter &out, uint32_t member, const char *data, uint32_t length)
+    {
+        BlockHeader header = {member, length, blockChecksum(member, length, data)};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(data, length);
+    }
+
+    // A file read front to back in large pieces, closed on every path
+    class InputFile
+    {
+    public:
+        explicit InputFile(const std::string &path) : file(std::fopen(path.c_str(), "rb")) {}
+        ~InputFile()
+        {
+            if (file)
+            {
+                std::fclose(file);
+            }
+        }
+
+        bool isOpen() const { return file != nullptr; }
+        bool failed() const { return std::ferror(file) != 0; }
+
+        // Up to length bytes; 0 at the end of the file
+        size_t readSome(char *data, size_t length) { return std::fread(data, 1, length, file); }
+
+        // Exactly length bytes, or false
+        bool read(void *data, size_t length) { return readSome(static_cast<char *>(data), length) == length; }
+
+        // Size of the file that was opened, which a rename cannot change
+        // under us; false if it cannot be found out
+        bool size(uint64_t &bytes)
+        {
+            long start = std::ftell(file);
+            if (start < 0 || std::fseek(file, 0, SEEK_END) != 0)
+            {
+                return false;
+            }
+            long end = std::ftell(file);
+            bytes = static_cast<uint64_t>(end);
+            return end >= 0 && std::fseek(file, start, SEEK_SET) == 0;
+        }
+
+        bool skip(uint32_t length) { return std::fseek(file, static_cast<long>(length), SEEK_CUR) == 0; }
+        bool seekTo(long offset) { return std::fseek(file, offset, SEEK_SET) == 0; }
+
+    private:
+        FILE *file;
+
+        InputFile(const InputFile &) = delete;
+        InputFile &operator=(const InputFile &) = delete;
+    };
+
+    std::string stagedPathFor(const std::string &outputPath)
+    {
+        return outputPath + ".staged";
+    }
+
+    // Staged member files, removed unless they were handed over for
+    // publishing
+    struct StagedFiles
+    {
+        std::vector<std::string> paths;
+
+        StagedFiles() = default;
+        ~StagedFiles()
+        {
+            for (const std::string &path : paths)
+            {
+                std::remove(path.c_str());
+            }
+        }
+
+        StagedFiles(const StagedFiles &) = delete;
+        StagedFiles &operator=(const StagedFiles &) = delete;
+    };
+
+    // Check the archive header; the file is left at the first block
+    bool readHeader(InputFile &in, uint32_t &version)
+    {
+        ArchiveHeader header;
+        if (!in.isOpen() || !in.read(&header, sizeof(header)) ||
+            std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0 ||
+            (header.version != 1 && header.version != ARCHIVE_VERSION))
+        {
+            return false;
+        }
+        version = header.version;
+        return true;
+    }
+
+    // Read the names block that follows the header of a current archive.
+    // A version 1 archive is scanned for its highest member instead and
+    // rewound to its first block.
+    bool readNames(InputFile &in, uint32_t version, std::vector<char> &block, std::vector<std::string> &names)
+    {
+        names.clear();
+        BlockHeader blockHeader;
+        if (version == 1)
+        {
+            uint32_t members = 0;
+            while (in.read(&blockHeader, sizeof(blockHeader)) && blockHeader.member != ARCHIVE_END)
+            {
+                members = std::max(members, blockHeader.member + 1);
+                if (!in.skip(blockHeader.length))
+                {
+                    return false;
+                }
+            }
+            for (uint32_t member = 0; member < members; ++member)
+            {
+                names.push_back(std::to_string(member));
+            }
+            return in.seekTo(static_cast<long>(sizeof(ArchiveHeader)));
+        }
+
+        if (!in.read(&blockHeader, sizeof(blockHeader)) || blockHeader.member != ARCHIVE_NAMES ||
+            blockHeader.length > block.size() || !in.read(block.data(), blockHeader.length) ||
+            blockChecksum(blockHeader.member, blockHeader.length, block.data()) != blockHeader.checksum)
+        {
+            return false;
+        }
+        const char *cursor = block.data();
+        const char *end = block.data() + blockHeader.length;
+        while (cursor < end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+            if (!newline)
+            {
+                return false;
+            }
+            names.push_back(std::string(cursor, newline));
+            cursor = newline + 1;
+        }
+        return true;
+    }
+}
+
+bool writeArchive(const std::string &archivePath, const std::vector<ArchiveMember> &members,
+                  ArchiveStats &stats)
+{
+    stats = ArchiveStats();
+    std::string names;
+    for (const ArchiveMember &member : members)
+    {
+        names += member.name;
+        names += '\n';
+    }
+    BufferedWriter out;
+    if (names.size() > ARCHIVE_BLOCK_BYTES || !out.open(archivePath))
+    {
+        return false;
+    }
+
+    ArchiveHeader header;
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeBlock(out, ARCHIVE_NAMES, names.data(), static_cast<uint32_t>(names.size()));
+
+    // A member that is missing, unreadable or shorter than it was when
+    // opened fails the whole archive; the unfinished archive is discarded
+    std::vector<char> block(ARCHIVE_BLOCK_BYTES);
+    for (size_t member = 0; member < members.size(); ++member)
+    {
+        InputFile in(members[member].path);
+        uint64_t expected;
+        if (!in.isOpen() || !in.size(expected))
+        {
+            return false;
+        }
+
+        uint64_t copied = 0;
+        size_t length;
+        while ((length = in.readSome(block.data(), block.size())) > 0)
+        {
+            writeBlock(out, static_cast<uint32_t>(member), block.data(), static_cast<uint32_t>(length));
+            ++stats.blocks;
+            stats.bytes += length;
+            copied += length;
+        }
+        if (in.failed() || copied != expected)
+        {
+            return false;
+        }
+    }
+
+    uint64_t blockCount = stats.blocks;
+    writeBlock(out, ARCHIVE_END, reinterpret_cast<const char *>(&blockCount), sizeof(blockCount));
+    return out.close();
+}
+
+std::string restoreListPathFor(const std::string &dataPath)
+{
+    return dataPath + ".restore";
+}
+
+bool readArchiveNames(const std::string &archivePath, std::vector<std::string> &names)
+{
+    InputFile in(archivePath);
+    uint32_t version;
+    std::vector<char> block(ARCHIVE_BLOCK_BYTES);
+    return readHeader(in, version) && readNames(in, version, block, names);
+}
+
+bool extractArchive(const std::string &archivePath, const std::vector<ArchiveMember> &outputs,
+                    const std::vector<std::string> &obsolete, const std::string &publishPath, ArchiveStats &stats)
+{
+    stats = ArchiveStats();
+    InputFile in(archivePath);
+    uint32_t version;
+    std::vector<char> block(ARCHIVE_BLOCK_BYTES);
+    std::vector<std::string> names;
+    if (!readHeader(in, version) || !readNames(in, version, block, names))
+    {
+        return false;
+    }
+
+    std::vector<const ArchiveMember *> targets;
+    for (const std::string &name : names)
+    {
+        auto output = std::find_if(outputs.begin(), outputs.end(),
+                                   [&](const ArchiveMember &candidate) { return candidate.name == name; });
+        if (output == outputs.end())
+        {
+            return false;
+        }
+        targets.push_back(&*output);
+    }
+
+    // Members are stored one after another, so only the member being read
+    // has a staged file open; everything staged is dropped on failure
+    StagedFiles staged;
+    BufferedWriter member;
+    auto stageUpTo = [&](size_t next)
+    {
+        while (staged.paths.size() < next)
+        {
+            if (member.isOpen() && !member.close())
+            {
+                return false;
+            }
+            staged.paths.push_back(stagedPathFor(targets[staged.paths.size()]->path));
+            if (!member.open(staged.paths.back()))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    while (true)
+    {
+        BlockHeader blockHeader;
+        if (!in.read(&blockHeader, sizeof(blockHeader)) || blockHeader.length > block.size() ||
+            (blockHeader.member != ARCHIVE_END && blockHeader.member >= names.size()) ||
+            !in.read(block.data(), blockHeader.length) ||
+            blockChecksum(blockHeader.member, blockHeader.length, block.data()) != blockHeader.checksum)
+        {
+            return false;
+        }
+
+        if (blockHeader.member == ARCHIVE_END)
+        {
+            uint64_t blockCount;
+            if (blockHeader.length != sizeof(blockCount))
+            {
+                return false;
+            }
+            std::memcpy(&blockCount, block.data(), sizeof(blockCount));
+            if (blockCount != stats.blocks || in.readSome(block.data(), 1) != 0)
+            {
+                return false;
+            }
+            break;
+        }
+
+        // A block of a member that was already finished means the archive
+        // is not one this program wrote
+        if (blockHeader.member + 1 < staged.paths.size() || !stageUpTo(blockHeader.member + 1))
+        {
+            return false;
+        }
+        member.write(block.data(), blockHeader.length);
+        ++stats.blocks;
+        stats.bytes += blockHeader.length;
+    }
+
+    // Members without blocks are empty files
+    if (!stageUpTo(names.size()) || (member.isOpen() && !member.close()))
+    {
+        return false;
+    }
+
+    // Checksums are renamed in ahead of the file they describe
+    std::vector<std::pair<std::string, std::string>> renames;
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+        if (targets[i]->checksummed)
+        {
+            std::string checksumPath = blockChecksumPathFor(targets[i]->path);
+            std::string dataPath = staged.paths[i];
+            staged.paths.push_back(stagedPathFor(checksumPath));
+            if (!saveBlockChecksums(dataPath, staged.paths.back()))
+            {
+                return false;
+            }
+            renames.push_back(std::make_pair(staged.paths.back(), checksumPath));
+        }
+        renames.push_back(std::make_pair(staged.paths[i], targets[i]->path));
+    }
+
+    // Every block checked out. The list of changes is the switch: once it
+    // is on disk the restore happens, now or when finishExtraction runs.
+    BufferedWriter list;
+    if (!list.open(publishPath))
+    {
+        return false;
+    }
+    for (const std::pair<std::string, std::string> &rename : renames)
+    {
+        list.write(rename.first);
+        list.put('\t');
+        list.write(rename.second);
+        list.put('\n');
+    }
+    for (const std::string &path : obsolete)
+    {
+        list.put('\t');
+        list.write(path);
+        list.put('\n');
+    }
+    if (!list.close() || !commitNow(publishPath))
+    {
+        std::remove(publishPath.c_str());
+        return false;
+    }
+    staged.paths.clear();
+    return finishExtraction(publishPath);
+}
+
+bool finishExtraction(const std::string &publishPath)
+{
+    MappedFile list;
+    if (!list.open(publishPath))
+    {
+        return true; // Nothing left half done
+    }
+
+    // Each line is "<staged>\t<output>", or "\t<path>" for a file to remove.
+    // Steps already taken before a crash are skipped.
+    bool ok = true;
+    std::string lastPath;
+    forEachLine(list.begin(), list.end(), [&](const char *lineBegin, const char *lineEnd)
+    {
+        const char *tab = static_cast<const char *>(std::memchr(lineBegin, '\t', static_cast<size_t>(lineEnd - lineBegin)));
+        if (!tab)
+        {
+            return;
+        }
+        std::string from(lineBegin, tab);
+        std::string to(tab + 1, lineEnd);
+        FileInfo info;
+        if (from.empty())
+        {
+            std::remove(to.c_str());
+        }
+        else if (getFileInfo(from, info))
+        {
+#ifdef _WIN32
+            std::remove(to.c_str()); // rename does not overwrite on Windows
+#endif
+            ok = std::rename(from.c_str(), to.c_str()) == 0 && ok;
+        }
+        lastPath = to;
+    });
+    list.close();
+
+    if (!ok || (!lastPath.empty() && !syncDirectoryOf(lastPath)))
+    {
+        return false;
+    }
+    return std::remove(publishPath.c_str()) == 0;
+}
@@ -0,0 +1,75 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Backup archives: several files streamed into one file of checksummed
+// blocks, so damage is found while an archive is read and before anything
+// is written over live data.
+//
+//   header  magic "TRKA", version
+//   names   a block for member ARCHIVE_NAMES holding the member names, one
+//           per line, in member order
+//   block   member, length, CRC-32C, then length bytes of that member
+//   end     a block for member ARCHIVE_END holding the number of blocks
+//
+// The checksum covers the member and length fields as well as the data, and
+// the end block catches archives that were cut short. Members are stored in
+// order, each as a run of blocks of at most ARCHIVE_BLOCK_BYTES; one block
+// is all the memory writing or reading an archive takes, however large the
+// files are. Version 1 archives have no names block; their members are
+// named by their position, "0", "1", ...
+const uint32_t ARCHIVE_VERSION = 2;
+const size_t ARCHIVE_BLOCK_BYTES = 1 << 20;
+const uint32_t ARCHIVE_NAMES = 0xFFFFFFFE;
+const uint32_t ARCHIVE_END = 0xFFFFFFFF;
+
+// A file in an archive: the name it is stored under and where it is read
+// from or extracted to. An extracted data file can have its block checksums
+// (see block_checksums.h) written and switched over with it.
+struct ArchiveMember
+{
+    std::string name;
+    std::string path;
+    bool checksummed;
+};
+
+// What writing or extracting an archive moved
+struct ArchiveStats
+{
+    uint64_t blocks = 0; // Data blocks, not counting the end block
+    uint64_t bytes = 0;  // Member bytes
+};
+
+// Store the files in a new archive, which replaces archivePath only once it
+// is complete. Fails, leaving archivePath as it was, if a file is missing or
+// cannot be read to the end. Names must not contain a newline.
+bool writeArchive(const std::string &archivePath, const std::vector<ArchiveMember> &members,
+                  ArchiveStats &stats);
+
+// Names of the members of an archive, in order; false if the archive or
+// its names block cannot be read
+bool readArchiveNames(const std::string &archivePath, std::vector<std::string> &names);
+
+// Stream an archive back out, each member to the path of the output with
+// its name. Every block is verified as it is read, and members are written
+// one at a time to "<output>.staged". Once the whole archive has checked
+// out, the renames of the staged files and the removal of the obsolete
+// files are listed in publishPath, which is synced before any of them is
+// carried out; a crash after that is finished by finishExtraction. Either
+// every output is replaced or all of them are left untouched. Fails if a
+// member has no output; outputs that name no member are left alone.
+bool extractArchive(const std::string &archivePath, const std::vector<ArchiveMember> &outputs,
+                    const std::vector<std::string> &obsolete, const std::string &publishPath, ArchiveStats &stats);
+
+// Where a restore into the files of dataPath lists its switch-over
+std::string restoreListPathFor(const std::string &dataPath);
+
+// Carry out the rest of an extraction whose list at publishPath was written
+// before a crash; true if it completed or there was nothing to do
+bool finishExtraction(const std::string &publishPath);
+
+#endif // ARCHIVE_H
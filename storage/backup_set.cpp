@@ -0,0 +1,449 @@
+#include "backup_set.h"
+#include "activity_file.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "field_parser.h"
+#include "file_info.h"
+#include "file_lock.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "row_index.h"
+#include "tombstones.h"
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+namespace
+{
+    const char BACKUP_MANIFEST_MAGIC[] = "tracker-backup";
+
+    struct BackupEntry
+    {
+        unsigned number;
+        uint64_t firstActivity;
+        uint64_t activityCount;
+    };
+
+    struct BackupManifest
+    {
+        std::vector<BackupEntry> backups;
+        std::map<int, uint64_t> goals; // Goal ID -> fingerprint of its row
+    };
+
+    // FNV-1a; only has to tell whether a goal row changed
+    uint64_t fingerprint(const std::string &row)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (char c : row)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string partPath(const std::string &basePath, unsigned number, const char *part)
+    {
+        return basePath + "." + std::to_string(number) + "." + part;
+    }
+
+    // False if the manifest is missing, from another version, or does not
+    // describe one unbroken chain starting with a full backup
+    bool loadManifest(const std::string &basePath, BackupManifest &manifest)
+    {
+        std::ifstream file(backupManifestPathFor(basePath));
+        std::string magic;
+        int version = 0;
+        if (!(file >> magic >> version) || magic != BACKUP_MANIFEST_MAGIC || version != BACKUP_MANIFEST_VERSION)
+        {
+            return false;
+        }
+
+        std::string kind;
+        while (file >> kind)
+        {
+            if (kind == "backup")
+            {
+                BackupEntry entry;
+                if (!(file >> entry.number >> entry.firstActivity >> entry.activityCount))
+                {
+                    return false;
+                }
+                uint64_t expectedFirst = manifest.backups.empty()
+                                             ? 0
+                                             : manifest.backups.back().firstActivity + manifest.backups.back().activityCount;
+                if (entry.number != manifest.backups.size() || entry.firstActivity != expectedFirst)
+                {
+                    return false;
+                }
+                manifest.backups.push_back(entry);
+            }
+            else if (kind == "goal")
+            {
+                int id;
+                uint64_t hash;
+                if (!(file >> id >> hash))
+                {
+                    return false;
+                }
+                manifest.goals[id] = hash;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return !manifest.backups.empty();
+    }
+
+    bool saveManifest(const std::string &basePath, const BackupManifest &manifest)
+    {
+        BufferedWriter file;
+        if (!file.open(backupManifestPathFor(basePath)))
+        {
+            return false;
+        }
+        file.write(BACKUP_MANIFEST_MAGIC);
+        file.put(' ');
+        file.writeInt(BACKUP_MANIFEST_VERSION);
+        file.put('\n');
+        for (const BackupEntry &entry : manifest.backups)
+        {
+            file.write("backup ");
+            file.writeInt(entry.number);
+            file.put(' ');
+            file.writeInt(static_cast<long long>(entry.firstActivity));
+            file.put(' ');
+            file.writeInt(static_cast<long long>(entry.activityCount));
+            file.put('\n');
+        }
+        for (const auto &goal : manifest.goals)
+        {
+            file.write("goal ");
+            file.writeInt(goal.first);
+            file.put(' ');
+            file.write(std::to_string(goal.second));
+            file.put('\n');
+        }
+        return file.close();
+    }
+
+    // Drop the parts of backups that are no longer in the chain
+    void removeParts(const std::string &basePath, unsigned from, unsigned to)
+    {
+        for (unsigned number = from; number < to; ++number)
+        {
+            std::remove(partPath(basePath, number, "activities").c_str());
+            std::remove(partPath(basePath, number, "goals").c_str());
+            std::remove(partPath(basePath, number, "deleted").c_str());
+        }
+    }
+
+    // Number of valid rows in [begin, end), counted the way IDs are
+    uint64_t countActivityRows(const char *begin, const char *end, const CsvDialect &dialect)
+    {
+        uint64_t rows = 0;
+        forEachActivityRow(begin, end, dialect, [&rows](const ActivityRow &)
+        {
+            ++rows;
+            return true;
+        },
+        [](const char *, const char *) {});
+        return rows;
+    }
+
+    // Write the valid rows of [begin, end) after the first skip of them
+    uint64_t copyActivityRows(const char *begin, const char *end, const CsvDialect &dialect, uint64_t skip,
+                              BufferedWriter &out, const CsvDialect &outDialect)
+    {
+        uint64_t copied = 0;
+        forEachActivityRow(begin, end, dialect, [&](const ActivityRow &row)
+        {
+            if (skip > 0)
+            {
+                --skip;
+                return true;
+            }
+            writeActivityRow(out, outDialect, row.type, row.date,
+                             row.duration, row.distance, row.repetitions);
+            out.put('\n');
+            ++copied;
+            return true;
+        },
+        [](const char *, const char *) {});
+        return copied;
+    }
+
+    // Write the rows of a compressed data file from firstRow on, decoding
+    // only the blocks that hold them; false if one of those is damaged
+    bool copyCompressedRows(const char *begin, const char *end, uint64_t firstRow,
+                            BufferedWriter &out, const CsvDialect &outDialect, uint64_t &copied)
+    {
+        CompressedRange range;
+        range.firstRow = firstRow;
+        bool intact = true;
+        forEachCompressedActivity(begin, end, range, [&](const ActivityRow &row)
+        {
+            writeActivityRow(out, outDialect, row.type, row.date,
+                             row.duration, row.distance, row.repetitions);
+            out.put('\n');
+            ++copied;
+            return true;
+        },
+        [&intact](const char *, const char *)
+        {
+            intact = false;
+        });
+        return intact;
+    }
+
+    // ID stored in the last field of a goal row
+    bool goalIdOf(const char *begin, const char *end, int &id)
+    {
+        const char *field = end;
+        while (field > begin && *(field - 1) != ',')
+        {
+            --field;
+        }
+        return field > begin && parseInt(field, end, id) == ParseStatus::OK;
+    }
+}
+
+std::string backupManifestPathFor(const std::string &basePath)
+{
+    return basePath + ".manifest";
+}
+
+bool writeBackup(const std::string &basePath, const std::string &dataPath, const CsvDialect &dialect,
+                 const std::vector<BackupGoal> &goals, bool full, BackupSummary &summary)
+{
+    // Two backups into one set would both append backup n
+    FileLock setLock;
+    setLock.lock(writerLockPathFor(backupManifestPathFor(basePath)), LockMode::EXCLUSIVE);
+
+    BackupManifest previous;
+    bool chained = loadManifest(basePath, previous) && !full;
+
+    MappedFile data;
+    MappedFile journal;
+    openActivityFiles(dataPath, data, journal);
+
+    // Rows of the data file, and where the first one not backed up starts
+    uint64_t firstId = chained ? previous.backups.back().firstActivity + previous.backups.back().activityCount : 0;
+    CsvDialect dataDialect = dialect;
+    uint64_t dataRows = 0;
+    uint64_t resumeOffset = 0;
+    bool compressed = data.isOpen() && hasCompressedMagic(data.begin(), data.end());
+    if (compressed)
+    {
+        // Blocks know their rows, so the resume point needs no offset
+        if (!compressedRowCount(data.begin(), data.end(), dataRows))
+        {
+            return false;
+        }
+    }
+    else if (data.isOpen())
+    {
+        dataDialect = detectDialect(data.begin(), data.end(), dialect);
+        RowIndex index;
+        if (index.open(dataPath, data.fileInfo()))
+        {
+            dataRows = index.rowCount();
+            resumeOffset = firstId < dataRows ? index.offset(firstId) : data.size();
+        }
+        else
+        {
+            std::vector<uint64_t> offsets;
+            std::vector<TextRange> damaged;
+            findDamagedRanges(dataPath, data, damaged);
+            collectIntactRowOffsets(dataPath, data, dataDialect, damaged, offsets);
+            dataRows = offsets.size();
+            resumeOffset = firstId < dataRows ? offsets[firstId] : data.size();
+        }
+    }
+
+    const char *journalEnd = journal.isOpen() ? completeLinesEnd(journal.begin(), journal.end()) : nullptr;
+    CsvDialect journalDialect = dialect;
+    uint64_t journalRows = 0;
+    if (journal.isOpen())
+    {
+        journalDialect = detectDialect(journal.begin(), journalEnd, dialect);
+        journalDialect.hasHeader = false;
+        journalRows = countActivityRows(journal.begin(), journalEnd, journalDialect);
+    }
+
+    // Fewer activities than the chain holds: the history was replaced
+    if (firstId > dataRows + journalRows || resumeOffset > data.size())
+    {
+        chained = false;
+        firstId = 0;
+        resumeOffset = 0;
+    }
+
+    unsigned number = chained ? static_cast<unsigned>(previous.backups.size()) : 0;
+    summary = BackupSummary();
+    summary.number = number;
+
+    BufferedWriter activitiesOut;
+    BufferedWriter goalsOut;
+    BufferedWriter deletedOut;
+    if (!activitiesOut.open(partPath(basePath, number, "activities")) ||
+        !goalsOut.open(partPath(basePath, number, "goals")) ||
+        !deletedOut.open(partPath(basePath, number, "deleted")))
+    {
+        return false;
+    }
+
+    if (firstId < dataRows && compressed)
+    {
+        if (!copyCompressedRows(data.begin(), data.end(), firstId, activitiesOut, dialect, summary.activities))
+        {
+            return false;
+        }
+    }
+    else if (firstId < dataRows)
+    {
+        CsvDialect resumeDialect = dataDialect;
+        resumeDialect.hasHeader = resumeDialect.hasHeader && resumeOffset == 0;
+        summary.activities += copyActivityRows(data.begin() + resumeOffset, data.end(), resumeDialect, 0,
+                                               activitiesOut, dialect);
+    }
+    if (journal.isOpen())
+    {
+        uint64_t skip = firstId > dataRows ? firstId - dataRows : 0;
+        summary.activities += copyActivityRows(journal.begin(), journalEnd, journalDialect, skip,
+                                               activitiesOut, dialect);
+    }
+
+    BackupManifest next;
+    if (chained)
+    {
+        next.backups = previous.backups;
+    }
+    BackupEntry entry = {number, firstId, summary.activities};
+    next.backups.push_back(entry);
+
+    for (const BackupGoal &goal : goals)
+    {
+        uint64_t hash = fingerprint(goal.row);
+        next.goals[goal.id] = hash;
+        auto backedUp = previous.goals.find(goal.id);
+        if (!chained || backedUp == previous.goals.end() || backedUp->second != hash)
+        {
+            goalsOut.write(goal.row);
+            goalsOut.put('\n');
+            ++summary.goals;
+        }
+    }
+    if (chained)
+    {
+        for (const auto &backedUp : previous.goals)
+        {
+            if (next.goals.count(backedUp.first) == 0)
+            {
+                deletedOut.writeInt(backedUp.first);
+                deletedOut.put('\n');
+                ++summary.deletedGoals;
+            }
+        }
+    }
+
+    if (!activitiesOut.close() || !goalsOut.close() || !deletedOut.close() || !saveManifest(basePath, next))
+    {
+        return false;
+    }
+
+    // A new chain makes the incremental backups of the old one useless
+    if (!chained && previous.backups.size() > 1)
+    {
+        removeParts(basePath, 1, static_cast<unsigned>(previous.backups.size()));
+    }
+    return true;
+}
+
+bool readBackup(const std::string &basePath, BufferedWriter &activities,
+                std::vector<BackupGoal> &goals, BackupSummary &summary)
+{
+    return readBackup(basePath, [&activities](const char *begin, const char *end)
+    {
+        activities.write(begin, static_cast<size_t>(end - begin));
+    }, goals, summary);
+}
+
+bool readBackup(const std::string &basePath, const std::function<void(const char *, const char *)> &onActivities,
+                std::vector<BackupGoal> &goals, BackupSummary &summary)
+{
+    FileLock setLock;
+    setLock.lock(writerLockPathFor(backupManifestPathFor(basePath)), LockMode::SHARED);
+
+    BackupManifest manifest;
+    if (!loadManifest(basePath, manifest))
+    {
+        return false;
+    }
+
+    summary = BackupSummary();
+    std::map<int, std::string> live;
+    for (const BackupEntry &entry : manifest.backups)
+    {
+        // Every row must be complete and every backup must hold the
+        // activities the manifest says it does
+        MappedFile activityPart;
+        MappedFile goalPart;
+        FileInfo deletedInfo;
+        if (!activityPart.open(partPath(basePath, entry.number, "activities")) ||
+            !goalPart.open(partPath(basePath, entry.number, "goals")) ||
+            !getFileInfo(partPath(basePath, entry.number, "deleted"), deletedInfo))
+        {
+            return false;
+        }
+        if (completeLinesEnd(activityPart.begin(), activityPart.end()) != activityPart.end() ||
+            countLines(activityPart.begin(), activityPart.end()) != entry.activityCount)
+        {
+            return false;
+        }
+        onActivities(activityPart.begin(), activityPart.end());
+        summary.activities += entry.activityCount;
+
+        bool goalsValid = completeLinesEnd(goalPart.begin(), goalPart.end()) == goalPart.end();
+        forEachLine(goalPart.begin(), goalPart.end(), [&](const char *lineBegin, const char *lineEnd)
+        {
+            int id;
+            if (!goalIdOf(lineBegin, lineEnd, id))
+            {
+                goalsValid = false;
+                return;
+            }
+            live[id] = std::string(lineBegin, lineEnd);
+        });
+        if (!goalsValid)
+        {
+            return false;
+        }
+        for (int id : loadTombstones(partPath(basePath, entry.number, "deleted")))
+        {
+            live.erase(id);
+        }
+        ++summary.backups;
+    }
+
+    // The replayed goals must be exactly the ones of the last backup
+    if (live.size() != manifest.goals.size())
+    {
+        return false;
+    }
+    goals.clear();
+    for (const auto &goal : live)
+    {
+        auto expected = manifest.goals.find(goal.first);
+        if (expected == manifest.goals.end() || expected->second != fingerprint(goal.second))
+        {
+            return false;
+        }
+        BackupGoal restored = {goal.first, goal.second};
+        goals.push_back(restored);
+    }
+    summary.number = static_cast<unsigned>(manifest.backups.size() - 1);
+    summary.goals = goals.size();
+    return true;
+}
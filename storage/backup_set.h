@@ -0,0 +1,79 @@
+#ifndef BACKUP_SET_H
+#define BACKUP_SET_H
+
+#include "activity_csv.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class BufferedWriter;
+
+// Incremental backups of the activities and goals of one data directory.
+//
+// A backup set is a chain of backups sharing a base path. The chain is
+// described by <base>.manifest:
+//
+//   tracker-backup 1
+//   backup <n> <first activity ID> <activity count>   one line per backup
+//   goal <id> <fingerprint>                           goals as of the last one
+//
+// Backup 0 is a full backup; every later one holds only what changed since
+// the backup before it:
+//
+//   <base>.<n>.activities  activities with IDs from the first one on, as rows
+//   <base>.<n>.goals       goals that are new or changed, as rows ending in
+//                          their ID (every goal for backup 0)
+//   <base>.<n>.deleted     IDs of goals deleted since, in tombstone format
+//
+// Activities are never changed and keep their IDs (see row_index.h), so a
+// backup starts at the first ID the chain does not hold yet and reads
+// nothing in front of it. Goals are few and can change, so each backup
+// compares them with the fingerprints in the manifest. The manifest is
+// replaced last, so a backup that fails part way leaves the chain as it was.
+const int BACKUP_MANIFEST_VERSION = 1;
+
+std::string backupManifestPathFor(const std::string &basePath);
+
+// One goal as the front end stores it: its ID and its row without a line
+// ending. The ID must also be the last field of the row.
+struct BackupGoal
+{
+    int id;
+    std::string row;
+};
+
+// What a backup wrote or a restore read
+struct BackupSummary
+{
+    unsigned number = 0;         // Position of the backup in its chain; 0 is full
+    unsigned backups = 0;        // Backups replayed by a restore
+    uint64_t activities = 0;     // Activity rows written or restored
+    size_t goals = 0;            // Goal rows written or restored
+    size_t deletedGoals = 0;     // Goal deletions recorded
+};
+
+// Add a backup of the activities in dataPath (and its journal) and of the
+// given live goals to the set at basePath. Activity rows are written in
+// dialect, without a header. Starts a new chain with a full backup when
+// full is set, when there is no manifest yet, or when the data file holds
+// fewer activities than the chain, i.e. it was replaced.
+bool writeBackup(const std::string &basePath, const std::string &dataPath, const CsvDialect &dialect,
+                 const std::vector<BackupGoal> &goals, bool full, BackupSummary &summary);
+
+// Replay the full backup of the set at basePath and then every incremental
+// one. Activity rows are copied to activities in order; the goals alive at
+// the last backup are returned in ID order. The chain is checked against
+// the manifest, and nothing is returned if any part is missing or damaged.
+bool readBackup(const std::string &basePath, BufferedWriter &activities,
+                std::vector<BackupGoal> &goals, BackupSummary &summary);
+
+// The same, passing the activity rows of each backup to
+// onActivities(begin, end) instead, as complete lines in the dialect they
+// were backed up in. A later backup can still fail the chain, so the rows
+// are only usable once this returns true.
+bool readBackup(const std::string &basePath, const std::function<void(const char *, const char *)> &onActivities,
+                std::vector<BackupGoal> &goals, BackupSummary &summary);
+
+#endif // BACKUP_SET_H
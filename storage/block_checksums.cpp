@@ -0,0 +1,320 @@
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "checksum.h"
+#include "file_info.h"
+#include "row_index.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const char BLOCK_CHECKSUM_MAGIC[4] = {'T', 'R', 'K', 'C'};
+
+    struct BlockChecksumHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t blockBytes;
+        uint32_t blockCount;
+        uint64_t sourceSize;
+        int64_t sourceModifiedNs;
+    };
+
+    uint32_t blockCountFor(uint64_t size)
+    {
+        return static_cast<uint32_t>((size + CHECKSUM_BLOCK_BYTES - 1) / CHECKSUM_BLOCK_BYTES);
+    }
+
+    enum class ChecksumState
+    {
+        NONE,        // No usable checksums
+        CURRENT,     // They describe this version of the file
+        STALE,       // They describe another version, so the file changed
+        INTERRUPTED  // A save wrote them and stopped before its rename
+    };
+
+    // Mapped checksums of dataPath and the file size they were taken of
+    struct Checksums
+    {
+        MappedFile file;
+        const char *values = nullptr;
+        uint32_t blockCount = 0;
+        uint64_t sourceSize = 0;
+    };
+
+    ChecksumState openChecksums(const std::string &dataPath, const MappedFile &data, Checksums &checksums)
+    {
+        BlockChecksumHeader header;
+        MappedFile &file = checksums.file;
+        if (!file.open(blockChecksumPathFor(dataPath)) || file.size() < sizeof(header))
+        {
+            return ChecksumState::NONE;
+        }
+        std::memcpy(&header, file.begin(), sizeof(header));
+        if (std::memcmp(header.magic, BLOCK_CHECKSUM_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != BLOCK_CHECKSUM_VERSION || header.blockBytes != CHECKSUM_BLOCK_BYTES ||
+            header.blockCount != blockCountFor(header.sourceSize) ||
+            file.size() != sizeof(header) + static_cast<size_t>(header.blockCount) * sizeof(uint32_t))
+        {
+            return ChecksumState::NONE;
+        }
+        checksums.values = file.begin() + sizeof(header);
+        checksums.blockCount = header.blockCount;
+        checksums.sourceSize = header.sourceSize;
+        if (header.sourceSize == data.fileInfo().size && header.sourceModifiedNs == data.fileInfo().modifiedNs)
+        {
+            return ChecksumState::CURRENT;
+        }
+
+        // Replacements are checksummed as <file>.tmp just before they are
+        // renamed over the file, so a matching .tmp means the file is still
+        // the version before that save
+        FileInfo pending;
+        if (getFileInfo(dataPath + ".tmp", pending) && pending.size == header.sourceSize &&
+            pending.modifiedNs == header.sourceModifiedNs)
+        {
+            return ChecksumState::INTERRUPTED;
+        }
+        return ChecksumState::STALE;
+    }
+
+    uint32_t storedChecksum(const Checksums &checksums, uint32_t block)
+    {
+        uint32_t value;
+        std::memcpy(&value, checksums.values + static_cast<size_t>(block) * sizeof(value), sizeof(value));
+        return value;
+    }
+
+    // True if the block of data differs from the version the checksums were
+    // taken of: its bytes changed, or the file is shorter or longer there
+    bool blockDamaged(const MappedFile &data, const Checksums &checksums, uint32_t block)
+    {
+        size_t first = static_cast<size_t>(block) * CHECKSUM_BLOCK_BYTES;
+        if (block >= checksums.blockCount)
+        {
+            return true;
+        }
+        size_t length = static_cast<size_t>(std::min<uint64_t>(CHECKSUM_BLOCK_BYTES, checksums.sourceSize - first));
+        size_t available = std::min<size_t>(CHECKSUM_BLOCK_BYTES, data.size() - first);
+        return available != length || crc32c(data.begin() + first, length) != storedChecksum(checksums, block);
+    }
+
+    uint32_t checksumOfBlock(const MappedFile &data, uint32_t block)
+    {
+        size_t first = static_cast<size_t>(block) * CHECKSUM_BLOCK_BYTES;
+        size_t length = std::min<size_t>(CHECKSUM_BLOCK_BYTES, data.size() - first);
+        return crc32c(data.begin() + first, length);
+    }
+}
+
+std::string blockChecksumPathFor(const std::string &dataPath)
+{
+    return dataPath + ".crc";
+}
+
+bool saveBlockChecksums(const std::string &dataPath)
+{
+    return saveBlockChecksums(dataPath, blockChecksumPathFor(dataPath));
+}
+
+bool saveBlockChecksums(const std::string &dataPath, const std::string &checksumPath)
+{
+    MappedFile data;
+    if (!data.open(dataPath))
+    {
+        return false;
+    }
+
+    BlockChecksumHeader header;
+    std::memcpy(header.magic, BLOCK_CHECKSUM_MAGIC, sizeof(header.magic));
+    header.version = BLOCK_CHECKSUM_VERSION;
+    header.blockBytes = CHECKSUM_BLOCK_BYTES;
+    header.blockCount = blockCountFor(data.size());
+    header.sourceSize = data.fileInfo().size;
+    header.sourceModifiedNs = data.fileInfo().modifiedNs;
+
+    BufferedWriter outFile;
+    if (!outFile.open(checksumPath))
+    {
+        return false;
+    }
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (uint32_t block = 0; block < header.blockCount; ++block)
+    {
+        uint32_t checksum = checksumOfBlock(data, block);
+        outFile.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    }
+    return outFile.close();
+}
+
+bool findDamagedRanges(const std::string &dataPath, const MappedFile &data, std::vector<TextRange> &damaged,
+                       bool required)
+{
+    damaged.clear();
+    Checksums checksums;
+    ChecksumState state = openChecksums(dataPath, data, checksums);
+    if (state == ChecksumState::INTERRUPTED || (state == ChecksumState::NONE && !required))
+    {
+        return false;
+    }
+    if (state == ChecksumState::NONE)
+    {
+        // Nothing vouches for any of it
+        if (data.size() > 0)
+        {
+            TextRange range = {data.begin(), data.end()};
+            damaged.push_back(range);
+        }
+        return true;
+    }
+
+    uint32_t blockCount = blockCountFor(data.size());
+    for (uint32_t block = 0; block < blockCount; ++block)
+    {
+        if (!blockDamaged(data, checksums, block))
+        {
+            continue;
+        }
+
+        // From the start of the line the block begins in to the end of the
+        // line it finishes in; neighbouring damage merges into one range
+        const char *rangeBegin = data.begin() + static_cast<size_t>(block) * CHECKSUM_BLOCK_BYTES;
+        const char *rangeEnd = data.begin() + std::min<size_t>(static_cast<size_t>(block + 1) * CHECKSUM_BLOCK_BYTES, data.size());
+        while (rangeBegin > data.begin() && *(rangeBegin - 1) != '\n')
+        {
+            --rangeBegin;
+        }
+        const char *newline = static_cast<const char *>(
+            std::memchr(rangeEnd - 1, '\n', static_cast<size_t>(data.end() - (rangeEnd - 1))));
+        rangeEnd = newline ? newline + 1 : data.end();
+
+        if (!damaged.empty() && rangeBegin <= damaged.back().end)
+        {
+            damaged.back().end = std::max(damaged.back().end, rangeEnd);
+        }
+        else
+        {
+            TextRange range = {rangeBegin, rangeEnd};
+            damaged.push_back(range);
+        }
+    }
+    return true;
+}
+
+bool verifyBlockChecksums(const std::string &dataPath, const MappedFile &data, uint64_t first, uint64_t last)
+{
+    Checksums checksums;
+    ChecksumState state;
+    if (first >= last || first >= data.size() ||
+        (state = openChecksums(dataPath, data, checksums)) == ChecksumState::NONE || state == ChecksumState::INTERRUPTED)
+    {
+        return true;
+    }
+    uint32_t lastBlock = static_cast<uint32_t>((std::min<uint64_t>(last, data.size()) - 1) / CHECKSUM_BLOCK_BYTES);
+    for (uint32_t block = static_cast<uint32_t>(first / CHECKSUM_BLOCK_BYTES); block <= lastBlock; ++block)
+    {
+        if (blockDamaged(data, checksums, block))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hasDamagedRanges(const std::string &dataPath, bool required)
+{
+    MappedFile data;
+    std::vector<TextRange> damaged;
+    return data.open(dataPath) && findDamagedRanges(dataPath, data, damaged, required) && !damaged.empty();
+}
+
+size_t damagedRowCount(const std::string &dataPath, const MappedFile &data, const CsvDialect &dialect,
+                       const TextRange &range)
+{
+    uint64_t first = static_cast<uint64_t>(range.begin - data.begin());
+    uint64_t last = static_cast<uint64_t>(range.end - data.begin());
+    RowIndex index;
+    if (index.open(dataPath, data.fileInfo()))
+    {
+        // Offsets are in file order, so the first row in range is found by
+        // bisection and the rest follow it
+        uint64_t low = 0;
+        uint64_t high = index.rowCount();
+        while (low < high)
+        {
+            uint64_t middle = low + (high - low) / 2;
+            if (index.offset(middle) < first)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        size_t rows = 0;
+        for (uint64_t id = low; id < index.rowCount() && index.offset(id) < last; ++id)
+        {
+            ++rows;
+        }
+        return rows;
+    }
+
+    size_t rows = 0;
+    const char *begin = range.begin == data.begin() ? firstDataRow(data.begin(), range.end, dialect) : range.begin;
+    forEachLine(begin, range.end, [&rows](const char *lineBegin, const char *lineEnd)
+    {
+        if (lineBegin != lineEnd)
+        {
+            ++rows;
+        }
+    });
+    return rows;
+}
+
+void collectIntactRowOffsets(const std::string &dataPath, const MappedFile &data, const CsvDialect &dialect,
+                             const std::vector<TextRange> &damaged, std::vector<uint64_t> &offsets)
+{
+    offsets.clear();
+    CsvDialect segmentDialect = dialect;
+    std::vector<uint64_t> segment;
+    const char *cursor = data.begin();
+    for (const TextRange &range : damaged)
+    {
+        collectRowOffsets(cursor, range.begin, segmentDialect, segment);
+        for (uint64_t offset : segment)
+        {
+            offsets.push_back(offset + static_cast<uint64_t>(cursor - data.begin()));
+        }
+        offsets.insert(offsets.end(), damagedRowCount(dataPath, data, segmentDialect, range),
+                       static_cast<uint64_t>(range.begin - data.begin()));
+        segmentDialect.hasHeader = false;
+        cursor = range.end;
+    }
+    collectRowOffsets(cursor, data.end(), segmentDialect, segment);
+    for (uint64_t offset : segment)
+    {
+        offsets.push_back(offset + static_cast<uint64_t>(cursor - data.begin()));
+    }
+}
+
+std::vector<TextRange> intactRanges(const char *begin, const char *end, const std::vector<TextRange> &damaged)
+{
+    std::vector<TextRange> intact;
+    const char *cursor = begin;
+    for (const TextRange &range : damaged)
+    {
+        if (range.begin > cursor)
+        {
+            TextRange part = {cursor, range.begin};
+            intact.push_back(part);
+        }
+        cursor = range.end;
+    }
+    if (end > cursor)
+    {
+        TextRange part = {cursor, end};
+        intact.push_back(part);
+    }
+    return intact;
+}
@@ -0,0 +1,109 @@
+#ifndef BLOCK_CHECKSUMS_H
+#define BLOCK_CHECKSUMS_H
+
+#include "activity_csv.h"
+#include "mapped_file.h"
+#include "parallel_parse.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Block checksums of a data file, stored as <file>.crc:
+//
+//   header     magic "TRKC", version, block size, block count, size and
+//              mtime of the file
+//   checksums  one uint32_t CRC-32C per CHECKSUM_BLOCK_BYTES of the file
+//
+// Full saves write it from the new file before that is renamed into place
+// (WriteMode::REPLACE_CHECKSUMMED), and loaders check the blocks they read
+// against it, so a torn or bit-flipped row is reported and skipped instead
+// of being loaded with wrong values. It describes one version of the file.
+// Once the size or mtime no longer match, the file changed behind the
+// program's back: blocks that differ from that version, or bytes it did not
+// have, are damage. A save that stopped after writing the checksums, while
+// its <file>.tmp is still there, is the one exception. Deleting the .crc
+// accepts a file edited by hand. sports_tracker.c writes and checks the
+// same format.
+const uint32_t BLOCK_CHECKSUM_VERSION = 1;
+const uint32_t CHECKSUM_BLOCK_BYTES = 4096;
+
+std::string blockChecksumPathFor(const std::string &dataPath);
+
+// Checksum dataPath as it is now and save the result
+bool saveBlockChecksums(const std::string &dataPath);
+
+// Checksum the file at dataPath into checksumPath; a file keeps its size
+// and mtime when it is renamed, so the result is valid for its new name
+bool saveBlockChecksums(const std::string &dataPath, const std::string &checksumPath);
+
+// Check mapped data, the current version of dataPath, against its
+// checksums. Damaged blocks are widened to whole lines and returned in file
+// order; the file itself is left as it is. A file that is required to have
+// checksums and has none is damaged as a whole. Returns false if there are
+// no checksums to check against, in which case nothing was checked.
+bool findDamagedRanges(const std::string &dataPath, const MappedFile &data, std::vector<TextRange> &damaged,
+                       bool required = false);
+
+// Check only the blocks holding bytes [first, last) of data; true if they
+// match or there are no checksums to check against
+bool verifyBlockChecksums(const std::string &dataPath, const MappedFile &data, uint64_t first, uint64_t last);
+
+// True if dataPath as it is now fails its checksums. Rewriting it from what
+// was loaded would drop the damaged rows for good, so saves refuse to until
+// it is restored from a backup.
+bool hasDamagedRanges(const std::string &dataPath, bool required = false);
+
+// Rows a damaged range of data held: the rows the ID index of this version
+// of dataPath has there, or else its non-empty lines less a header
+size_t damagedRowCount(const std::string &dataPath, const MappedFile &data, const CsvDialect &dialect,
+                       const TextRange &range);
+
+// collectRowOffsets for data, with each row of a damaged range counted at
+// the start of the range
+void collectIntactRowOffsets(const std::string &dataPath, const MappedFile &data, const CsvDialect &dialect,
+                             const std::vector<TextRange> &damaged, std::vector<uint64_t> &offsets);
+
+// Stands in for a row of a damaged range so the rows after it keep their
+// IDs: an unknown type and no date
+inline ActivityRow damagedRowPlaceholder()
+{
+    ActivityRow row;
+    row.type = UNKNOWN_TYPE_CODE;
+    return row;
+}
+
+// The parts of [begin, end) between the damaged ranges, in file order
+std::vector<TextRange> intactRanges(const char *begin, const char *end, const std::vector<TextRange> &damaged);
+
+// Like forEachActivityRow over data, the current version of dataPath, but
+// every line of the damaged ranges goes to onInvalid instead of being
+// parsed, even if it would parse, and onRow gets a placeholder for each row
+// a range held
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachIntactActivityRow(const std::string &dataPath, const MappedFile &data, const CsvDialect &dialect,
+                              const std::vector<TextRange> &damaged, RowVisitor onRow, InvalidVisitor onInvalid)
+{
+    CsvDialect segmentDialect = dialect;
+    const char *cursor = data.begin();
+    for (const TextRange &range : damaged)
+    {
+        if (!forEachActivityRow(cursor, range.begin, segmentDialect, onRow, onInvalid))
+        {
+            return false;
+        }
+        forEachLine(range.begin, range.end, onInvalid);
+        for (size_t rows = damagedRowCount(dataPath, data, segmentDialect, range); rows > 0; --rows)
+        {
+            if (!onRow(damagedRowPlaceholder()))
+            {
+                return false;
+            }
+        }
+        segmentDialect.hasHeader = false; // Whichever segment held it is done
+        cursor = range.end;
+    }
+    return forEachActivityRow(cursor, data.end(), segmentDialect, onRow, onInvalid);
+}
+
+#endif // BLOCK_CHECKSUMS_H
@@ -0,0 +1,235 @@
+#include "buffered_writer.h"
+#include "block_checksums.h"
+#include "durability.h"
+#include "fixed_point.h"
+#include "io_stats.h"
+#include "number_format.h"
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count());
+    }
+}
+
+BufferedWriter::BufferedWriter(size_t capacity)
+    : buffer(capacity > NUMBER_BUFFER_BYTES ? capacity : NUMBER_BUFFER_BYTES), used(0), file(nullptr),
+      mode(WriteMode::REPLACE), written(0), elapsedNs(0), failed(false)
+{
+}
+
+// A replacement that was never closed is incomplete, so it is dropped
+BufferedWriter::~BufferedWriter()
+{
+    if (mode != WriteMode::APPEND)
+    {
+        discard();
+    }
+    else
+    {
+        close();
+    }
+}
+
+bool BufferedWriter::open(const std::string &path, WriteMode mode)
+{
+    close();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    this->path = path;
+    this->mode = mode;
+    used = 0;
+    written = 0;
+    elapsedNs = 0;
+    failed = false;
+    if (mode != WriteMode::APPEND)
+    {
+        file = std::fopen((path + ".tmp").c_str(), "wb");
+    }
+    else
+    {
+        file = std::fopen(path.c_str(), "ab");
+    }
+    if (file)
+    {
+        // Our buffer is the only one, so every flush is one write call
+        std::setvbuf(file, nullptr, _IONBF, 0);
+    }
+
+    elapsedNs += nanosecondsSince(start);
+    return file != nullptr;
+}
+
+bool BufferedWriter::close()
+{
+    if (!file)
+    {
+        return !failed;
+    }
+
+    flush();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!commit())
+    {
+        failed = true;
+    }
+    file = nullptr;
+    elapsedNs += nanosecondsSince(start);
+
+    recordBytesWritten(written);
+    recordWriteTime(elapsedNs);
+    return !failed;
+}
+
+void BufferedWriter::discard()
+{
+    if (!file)
+    {
+        return;
+    }
+    std::fclose(file);
+    file = nullptr;
+    used = 0;
+    if (mode != WriteMode::APPEND)
+    {
+        std::remove((path + ".tmp").c_str());
+    }
+}
+
+// Close the file, sync it if a group commit is due and move a replacement
+// into place
+bool BufferedWriter::commit()
+{
+    std::string tempPath = path + ".tmp";
+    bool durable = !failed && isCommitDue(path);
+    bool ok = !failed && (!durable || syncFileSystem(file));
+    ok = std::fclose(file) == 0 && ok;
+
+    if (mode != WriteMode::APPEND)
+    {
+        // Readers that find the new file find its checksums with it
+        if (ok && mode == WriteMode::REPLACE_CHECKSUMMED)
+        {
+            ok = saveBlockChecksums(tempPath, blockChecksumPathFor(path));
+        }
+        if (!ok)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename does not overwrite on Windows
+#endif
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        if (durable)
+        {
+            ok = syncDirectoryOf(path);
+        }
+    }
+
+    if (ok && durable)
+    {
+        markCommitted(path);
+    }
+    else if (ok)
+    {
+        deferCommit(path);
+    }
+    return ok;
+}
+
+void BufferedWriter::flush()
+{
+    if (used == 0 || !file)
+    {
+        used = 0;
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (std::fwrite(buffer.data(), 1, used, file) != used)
+    {
+        failed = true;
+    }
+    else
+    {
+        written += used;
+    }
+    used = 0;
+    elapsedNs += nanosecondsSince(start);
+}
+
+// Make room for length more bytes
+void BufferedWriter::reserve(size_t length)
+{
+    if (buffer.size() - used < length)
+    {
+        flush();
+    }
+}
+
+void BufferedWriter::write(const char *data, size_t length)
+{
+    if (length > buffer.size())
+    {
+        // Larger than the whole buffer: hand it to the file directly
+        flush();
+        if (file && std::fwrite(data, 1, length, file) == length)
+        {
+            written += length;
+        }
+        else
+        {
+            failed = true;
+        }
+        return;
+    }
+
+    reserve(length);
+    std::memcpy(&buffer[used], data, length);
+    used += length;
+}
+
+void BufferedWriter::write(const char *text)
+{
+    write(text, std::strlen(text));
+}
+
+void BufferedWriter::writeInt(long long value)
+{
+    reserve(NUMBER_BUFFER_BYTES);
+    used += formatInt(value, &buffer[used]);
+}
+
+void BufferedWriter::writeDecimal(double value)
+{
+    reserve(NUMBER_BUFFER_BYTES);
+    used += formatDecimal(value, &buffer[used]);
+}
+
+void BufferedWriter::writeFixedPoint(long long units, int decimals)
+{
+    reserve(NUMBER_BUFFER_BYTES);
+    used += formatFixedPoint(units, decimals, &buffer[used]);
+}
+
+void BufferedWriter::writeMeasure(double value, int decimals)
+{
+    reserve(NUMBER_BUFFER_BYTES);
+    used += formatMeasure(value, decimals, &buffer[used]);
+}
+
+void BufferedWriter::writeFixed(double value, int decimals)
+{
+    reserve(NUMBER_BUFFER_BYTES);
+    used += formatFixed(value, decimals, &buffer[used]);
+}
@@ -0,0 +1,81 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Default buffer size: a 1M-row save becomes a few dozen write calls
+const size_t WRITER_BUFFER_BYTES = 1 << 20;
+
+enum class WriteMode
+{
+    REPLACE,             // Write <path>.tmp and rename it over path on close
+    REPLACE_CHECKSUMMED, // As REPLACE, writing <path>.crc from <path>.tmp before the rename
+    APPEND
+};
+
+// Writes a data file through one large reusable buffer. Records are
+// formatted straight into the buffer, which goes to the file in a single
+// write call whenever it fills up, instead of one flush per line. close()
+// commits the file under the group-commit policy in durability.h and adds
+// the bytes and time spent to the process totals in io_stats.h.
+class BufferedWriter
+{
+public:
+    explicit BufferedWriter(size_t capacity = WRITER_BUFFER_BYTES);
+    ~BufferedWriter();
+
+    // Open for writing; a replaced file keeps its old contents until close
+    bool open(const std::string &path, WriteMode mode = WriteMode::REPLACE);
+
+    // Flush what is left, close and commit; false if any write failed, in
+    // which case a replaced file keeps its old contents
+    bool close();
+
+    // Close without committing; the target file is left untouched
+    void discard();
+
+    bool isOpen() const { return file != nullptr; }
+
+    void write(const char *data, size_t length);
+    void write(const std::string &text) { write(text.data(), text.size()); }
+    void write(const char *text);
+    void put(char c)
+    {
+        if (used == buffer.size())
+            flush();
+        buffer[used++] = c;
+    }
+
+    // Numbers go through the formatters in number_format.h
+    void writeInt(long long value);
+    void writeDecimal(double value);
+    void writeFixedPoint(long long units, int decimals);
+    void writeMeasure(double value, int decimals); // See formatMeasure in fixed_point.h
+    void writeFixed(double value, int decimals);
+
+    uint64_t bytesWritten() const { return written + used; }
+    double secondsSpent() const { return static_cast<double>(elapsedNs) / 1e9; }
+
+private:
+    std::vector<char> buffer;
+    size_t used;
+    FILE *file;
+    std::string path;
+    WriteMode mode;
+    uint64_t written;
+    uint64_t elapsedNs; // Time spent in open, write and close calls
+    bool failed;
+
+    void flush();
+    bool commit();
+    void reserve(size_t length);
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+};
+
+#endif // BUFFERED_WRITER_H
@@ -0,0 +1,15 @@
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <cstdint>
+
+// Day number (days since 1970-01-01) of a Gregorian calendar date
+int32_t daysFromCivil(int year, int month, int day);
+
+// Calendar date of a day number
+void civilFromDays(int32_t days, int &year, int &month, int &day);
+
+// Write a day number as YYYY-MM-DD into out[0..9]; no terminator is added
+void formatDayNumber(int32_t days, char *out);
+
+#endif // CALENDAR_H
@@ -0,0 +1,135 @@
+#include "checksum.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CRC32C_HARDWARE 1
+#include <nmmintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // Reflected 0x1EDC6F41
+
+    // Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k
+    // zero bytes, so eight input bytes are folded in with eight lookups
+    struct Crc32cTables
+    {
+        uint32_t table[8][256];
+
+        Crc32cTables()
+        {
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                uint32_t crc = byte;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc >> 1) ^ (CRC32C_POLYNOMIAL & (0u - (crc & 1u)));
+                }
+                table[0][byte] = crc;
+            }
+            for (uint32_t byte = 0; byte < 256; ++byte)
+            {
+                for (int slice = 1; slice < 8; ++slice)
+                {
+                    uint32_t previous = table[slice - 1][byte];
+                    table[slice][byte] = (previous >> 8) ^ table[0][previous & 0xFF];
+                }
+            }
+        }
+    };
+
+    const Crc32cTables &crc32cTables()
+    {
+        static const Crc32cTables tables;
+        return tables;
+    }
+
+#ifdef CRC32C_HARDWARE
+    // Eight bytes per instruction, so this is compiled for SSE4.2 even when
+    // the rest of the build is not, and only called after checking the CPU
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cHardware(const void *data, size_t length, uint32_t crc)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        uint64_t state = ~crc;
+        while (length >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            state = _mm_crc32_u64(state, word);
+            bytes += 8;
+            length -= 8;
+        }
+        uint32_t tail = static_cast<uint32_t>(state);
+        while (length > 0)
+        {
+            tail = _mm_crc32_u8(tail, *bytes);
+            ++bytes;
+            --length;
+        }
+        return ~tail;
+    }
+
+    bool cpuHasCrc32()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }
+#endif
+
+    typedef uint32_t (*Crc32cFunction)(const void *, size_t, uint32_t);
+
+    Crc32cFunction selectCrc32c()
+    {
+#ifdef CRC32C_HARDWARE
+        if (cpuHasCrc32())
+        {
+            return crc32cHardware;
+        }
+#endif
+        return crc32cPortable;
+    }
+
+    Crc32cFunction crc32cImplementation()
+    {
+        static const Crc32cFunction implementation = selectCrc32c();
+        return implementation;
+    }
+}
+
+uint32_t crc32c(const void *data, size_t length, uint32_t crc)
+{
+    return crc32cImplementation()(data, length, crc);
+}
+
+bool crc32cUsesHardware()
+{
+    return crc32cImplementation() != crc32cPortable;
+}
+
+uint32_t crc32cPortable(const void *data, size_t length, uint32_t crc)
+{
+    const uint32_t (&table)[8][256] = crc32cTables().table;
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+
+    // Eight bytes per step; the words are assembled byte by byte, so this
+    // is independent of alignment and byte order
+    while (length >= 8)
+    {
+        uint32_t low = crc ^ (static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+                              static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][bytes[4]] ^ table[2][bytes[5]] ^ table[1][bytes[6]] ^ table[0][bytes[7]];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *bytes) & 0xFF];
+        ++bytes;
+        --length;
+    }
+    return ~crc;
+}
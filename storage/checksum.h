@@ -0,0 +1,19 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), the checksum used by iSCSI, ext4 and SCTP. Data that
+// arrives in pieces is checksummed by passing the previous result as crc.
+// x86-64 processors with SSE4.2 compute it with the crc32 instruction; the
+// choice is made once, at the first call; other CPUs use crc32cPortable.
+uint32_t crc32c(const void *data, size_t length, uint32_t crc = 0);
+
+// The table-driven version (slicing-by-8), which runs anywhere
+uint32_t crc32cPortable(const void *data, size_t length, uint32_t crc = 0);
+
+// True if crc32c() runs on the crc32 instruction
+bool crc32cUsesHardware();
+
+#endif // CHECKSUM_H
@@ -0,0 +1,406 @@
+#include "compressed_store.h"
+#include "checksum.h"
+#include "lz_codec.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const char COMPRESSED_MAGIC[4] = {'T', 'R', 'K', 'Z'};
+    const uint32_t MAX_TYPE = 7;
+
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct BlockHeader
+    {
+        uint64_t firstRow;
+        uint32_t rows; // 0 for the end marker
+        int32_t firstDay;
+        int32_t lastDay;
+        uint32_t encodedBytes; // Payload size once decompressed
+        uint32_t storedBytes;  // Payload size in the file
+        uint32_t checksum;
+    };
+
+    // Covers every header field but the checksum itself, then the payload
+    uint32_t blockChecksum(const BlockHeader &header, const char *payload)
+    {
+        return crc32c(payload, header.storedBytes, crc32c(&header, offsetof(BlockHeader, checksum)));
+    }
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    void putVarint(std::vector<char> &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool getVarint(const char *&cursor, const char *end, uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && cursor < end; shift += 7)
+        {
+            unsigned char byte = static_cast<unsigned char>(*cursor++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Units (see fixed_point.h) in one hundredth: 1 for centiminutes, 10 for
+    // metres
+    int64_t unitsPerHundredth(int decimals)
+    {
+        return decimals == DISTANCE_DECIMALS ? 10 : 1;
+    }
+
+    // Durations and distances are almost always whole hundredths, stored as
+    // a tagged varint; anything finer is stored as a raw double
+    void putDecimal(std::vector<char> &out, int32_t units, int decimals)
+    {
+        int64_t perHundredth = unitsPerHundredth(decimals);
+        if (units % perHundredth == 0)
+        {
+            putVarint(out, zigzag(units / perHundredth) << 1);
+            return;
+        }
+        putVarint(out, 1);
+        double value = fromFixedPoint(units, decimals);
+        const char *raw = reinterpret_cast<const char *>(&value);
+        out.insert(out.end(), raw, raw + sizeof(value));
+    }
+
+    // Values beyond the int32_t range of the columns fail the block rather
+    // than be clamped
+    bool getDecimal(const char *&cursor, const char *end, int decimals, int32_t &units)
+    {
+        uint64_t tag;
+        if (!getVarint(cursor, end, tag))
+        {
+            return false;
+        }
+        if ((tag & 1) == 0)
+        {
+            const int64_t LIMIT = int64_t(1) << 40;
+            int64_t hundredths = unzigzag(tag >> 1);
+            if (hundredths > LIMIT || hundredths < -LIMIT)
+            {
+                return false;
+            }
+            int64_t value = hundredths * unitsPerHundredth(decimals);
+            if (value < INT32_MIN || value > INT32_MAX)
+            {
+                return false;
+            }
+            units = static_cast<int32_t>(value);
+            return true;
+        }
+        double value;
+        if (tag != 1 || static_cast<size_t>(end - cursor) < sizeof(value))
+        {
+            return false;
+        }
+        std::memcpy(&value, cursor, sizeof(value));
+        cursor += sizeof(value);
+        units = toFixedPoint(value, decimals);
+        return fitsFixedPoint(value, decimals);
+    }
+
+    void encodeColumns(const ActivityColumns &columns, int32_t firstDay, std::vector<char> &out)
+    {
+        out.clear();
+        int64_t previous = firstDay;
+        for (int32_t day : columns.day)
+        {
+            putVarint(out, zigzag(day - previous));
+            previous = day;
+        }
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            putVarint(out, (zigzag(columns.repetitions[i]) << 3) | columns.type[i]);
+        }
+        for (int32_t duration : columns.duration)
+        {
+            putDecimal(out, duration, DURATION_DECIMALS);
+        }
+        for (int32_t distance : columns.distance)
+        {
+            putDecimal(out, distance, DISTANCE_DECIMALS);
+        }
+    }
+
+    bool decodeColumns(const char *cursor, const char *end, uint32_t rows, int32_t firstDay,
+                       int32_t lastDay, ActivityColumns &columns)
+    {
+        columns.clear();
+        columns.reserve(rows);
+        uint64_t value;
+
+        int64_t day = firstDay;
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            if (!getVarint(cursor, end, value))
+            {
+                return false;
+            }
+            day += unzigzag(value);
+            if (day < firstDay || day > lastDay)
+            {
+                return false;
+            }
+            columns.day.push_back(static_cast<int32_t>(day));
+        }
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            if (!getVarint(cursor, end, value))
+            {
+                return false;
+            }
+            int64_t repetitions = unzigzag(value >> 3);
+            if (repetitions < std::numeric_limits<int32_t>::min() || repetitions > std::numeric_limits<int32_t>::max())
+            {
+                return false;
+            }
+            columns.type.push_back(static_cast<uint8_t>(value & MAX_TYPE));
+            columns.repetitions.push_back(static_cast<int32_t>(repetitions));
+        }
+        int32_t units;
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            if (!getDecimal(cursor, end, DURATION_DECIMALS, units))
+            {
+                return false;
+            }
+            columns.duration.push_back(units);
+        }
+        for (uint32_t i = 0; i < rows; ++i)
+        {
+            if (!getDecimal(cursor, end, DISTANCE_DECIMALS, units))
+            {
+                return false;
+            }
+            columns.distance.push_back(units);
+        }
+        return cursor == end;
+    }
+}
+
+bool hasCompressedMagic(const char *begin, const char *end)
+{
+    return static_cast<size_t>(end - begin) >= sizeof(COMPRESSED_MAGIC) &&
+           std::memcmp(begin, COMPRESSED_MAGIC, sizeof(COMPRESSED_MAGIC)) == 0;
+}
+
+bool isCompressedFile(const std::string &path)
+{
+    std::ifstream inFile(path, std::ios::binary);
+    char magic[sizeof(COMPRESSED_MAGIC)];
+    return inFile.read(magic, sizeof(magic)) && hasCompressedMagic(magic, magic + sizeof(magic));
+}
+
+// The end marker is the last header in the file
+bool compressedRowCount(const char *begin, const char *end, uint64_t &rows)
+{
+    BlockHeader marker;
+    if (!hasCompressedMagic(begin, end) ||
+        static_cast<size_t>(end - begin) < sizeof(FileHeader) + sizeof(marker))
+    {
+        return false;
+    }
+    std::memcpy(&marker, end - sizeof(marker), sizeof(marker));
+    if (marker.rows != 0 || marker.storedBytes != 0 || blockChecksum(marker, end) != marker.checksum)
+    {
+        return false;
+    }
+    rows = marker.firstRow;
+    return true;
+}
+
+CompressedWriter::CompressedWriter() : rows(0)
+{
+}
+
+bool CompressedWriter::open(const std::string &path)
+{
+    rows = 0;
+    block.clear();
+    if (!out.open(path))
+    {
+        return false;
+    }
+    FileHeader header;
+    std::memcpy(header.magic, COMPRESSED_MAGIC, sizeof(header.magic));
+    header.version = COMPRESSED_VERSION;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return true;
+}
+
+bool CompressedWriter::append(int type, int32_t day, double duration, double distance, int repetitions)
+{
+    if (type < 0 || static_cast<uint32_t>(type) > MAX_TYPE || !isWholeUnits(duration, DURATION_DECIMALS) ||
+        !isWholeUnits(distance, DISTANCE_DECIMALS))
+    {
+        return false;
+    }
+    block.type.push_back(static_cast<uint8_t>(type));
+    block.day.push_back(day);
+    block.duration.push_back(toCentiminutes(duration));
+    block.distance.push_back(toMetres(distance));
+    block.repetitions.push_back(repetitions);
+    if (block.size() == COMPRESSED_BLOCK_ROWS)
+    {
+        flushBlock();
+    }
+    return true;
+}
+
+bool CompressedWriter::close()
+{
+    if (block.size() > 0)
+    {
+        flushBlock();
+    }
+    BlockHeader marker = {rows, 0, 0, 0, 0, 0, 0};
+    marker.checksum = blockChecksum(marker, nullptr);
+    out.write(reinterpret_cast<const char *>(&marker), sizeof(marker));
+    return out.close();
+}
+
+// Encode the buffered rows, compress them if that helps and write the block
+void CompressedWriter::flushBlock()
+{
+    BlockHeader header;
+    header.firstRow = rows;
+    header.rows = static_cast<uint32_t>(block.size());
+    header.firstDay = *std::min_element(block.day.begin(), block.day.end());
+    header.lastDay = *std::max_element(block.day.begin(), block.day.end());
+
+    encodeColumns(block, header.firstDay, encoded);
+    lzCompress(encoded.data(), encoded.size(), compressed);
+    const std::vector<char> &payload = compressed.size() < encoded.size() ? compressed : encoded;
+
+    header.encodedBytes = static_cast<uint32_t>(encoded.size());
+    header.storedBytes = static_cast<uint32_t>(payload.size());
+    header.checksum = blockChecksum(header, payload.data());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(payload.data(), payload.size());
+
+    rows += block.size();
+    block.clear();
+}
+
+CompressedReader::CompressedReader()
+    : cursor(nullptr), end(nullptr), payload(nullptr), payloadBytes(0), encodedBytes(0), checksum(0),
+      nextRow(0), finished(false)
+{
+}
+
+bool CompressedReader::open(const char *begin, const char *fileEnd)
+{
+    FileHeader header;
+    if (static_cast<size_t>(fileEnd - begin) < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, begin, sizeof(header));
+    if (std::memcmp(header.magic, COMPRESSED_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != COMPRESSED_VERSION)
+    {
+        return false;
+    }
+    cursor = begin + sizeof(header);
+    end = fileEnd;
+    nextRow = 0;
+    finished = false;
+    return true;
+}
+
+bool CompressedReader::nextBlock(CompressedBlock &block)
+{
+    BlockHeader header;
+    if (finished || cursor == nullptr || static_cast<size_t>(end - cursor) < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, cursor, sizeof(header));
+
+    // A header that does not continue the rows before it cannot be trusted
+    // to say where the next block starts either
+    if (header.firstRow != nextRow || header.rows > COMPRESSED_BLOCK_ROWS ||
+        header.storedBytes > static_cast<size_t>(end - cursor) - sizeof(header))
+    {
+        cursor = nullptr;
+        return false;
+    }
+    if (header.rows == 0)
+    {
+        finished = header.storedBytes == 0 && cursor + sizeof(header) == end &&
+                   blockChecksum(header, nullptr) == header.checksum;
+        cursor = nullptr;
+        return false;
+    }
+
+    payload = cursor + sizeof(header);
+    payloadBytes = header.storedBytes;
+    encodedBytes = header.encodedBytes;
+    checksum = header.checksum;
+    cursor = payload + payloadBytes;
+    nextRow += header.rows;
+
+    current.firstRow = header.firstRow;
+    current.rows = header.rows;
+    current.firstDay = header.firstDay;
+    current.lastDay = header.lastDay;
+    block = current;
+    return true;
+}
+
+bool CompressedReader::readBlock(ActivityColumns &columns)
+{
+    BlockHeader header = {current.firstRow, current.rows, current.firstDay, current.lastDay,
+                          encodedBytes, payloadBytes, 0};
+    if (payload == nullptr || blockChecksum(header, payload) != checksum)
+    {
+        return false;
+    }
+
+    const char *begin = payload;
+    if (payloadBytes != encodedBytes)
+    {
+        // Rows never take more than a few dozen bytes, which bounds the
+        // buffer a damaged header could ask for
+        if (encodedBytes > current.rows * 64u)
+        {
+            return false;
+        }
+        encoded.resize(encodedBytes);
+        if (!lzDecompress(payload, payloadBytes, encoded.data(), encoded.size()))
+        {
+            return false;
+        }
+        begin = encoded.data();
+    }
+    return decodeColumns(begin, begin + encodedBytes, current.rows, current.firstDay, current.lastDay, columns);
+}
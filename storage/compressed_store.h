@@ -0,0 +1,218 @@
+#ifndef COMPRESSED_STORE_H
+#define COMPRESSED_STORE_H
+
+#include "activity_csv.h"
+#include "buffered_writer.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Compressed activities file, an alternative to the CSV data file that
+// holds the same rows in the same order (so IDs do not change):
+//
+//   header  magic "TRKZ", version
+//   blocks  up to COMPRESSED_BLOCK_ROWS rows each: a header with the ID of
+//           the first row, the row count, the earliest and latest day and a
+//           CRC-32C of header and payload, then the payload
+//   end     a block header with no rows, whose first row is the row count
+//
+// A payload holds the block's columns one after another, as varints:
+//
+//   day          zigzag difference from the row before (from the earliest
+//                day for the first row); sorted days take one byte each
+//   type, reps   zigzag(repetitions) << 3 | type
+//   duration,    zigzag(value * 100) << 1 when that is exact, else 1
+//   distance     followed by the raw double
+//
+// and is then compressed with lz_codec.h, or stored as it is when that does
+// not make it smaller. Blocks decode on their own, so scans skip blocks
+// outside the rows or days they want without decompressing them, and a
+// damaged block loses only its own rows.
+//
+// The journal stays CSV; compaction rewrites the file in the format it is
+// already in. Values are in native byte order, like the snapshot.
+const uint32_t COMPRESSED_VERSION = 1;
+const uint32_t COMPRESSED_BLOCK_ROWS = 16384;
+
+// True if [begin, end) starts like a compressed activities file
+bool hasCompressedMagic(const char *begin, const char *end);
+
+// True if the file at path is a compressed activities file
+bool isCompressedFile(const std::string &path);
+
+// Row count recorded at the end of a mapped compressed file; false if the
+// file is damaged or was cut short
+bool compressedRowCount(const char *begin, const char *end, uint64_t &rows);
+
+// Writes a compressed file one block at a time through a BufferedWriter,
+// so a replaced file keeps its old contents until close()
+class CompressedWriter
+{
+public:
+    CompressedWriter();
+
+    bool open(const std::string &path);
+
+    // Buffer one row, writing the block out when it is full. Fails for types
+    // above 7, which do not fit beside the repetitions, and for a duration or
+    // distance that is not a whole number of units.
+    bool append(int type, int32_t day, double duration, double distance, int repetitions);
+
+    // Write the last block and the end marker, then commit the file
+    bool close();
+
+    uint64_t rowCount() const { return rows; }
+    uint64_t bytesWritten() const { return out.bytesWritten(); }
+
+private:
+    BufferedWriter out;
+    ActivityColumns block;
+    std::vector<char> encoded;
+    std::vector<char> compressed;
+    uint64_t rows;
+
+    void flushBlock();
+
+    CompressedWriter(const CompressedWriter &) = delete;
+    CompressedWriter &operator=(const CompressedWriter &) = delete;
+};
+
+// Where a block sits in the file, read from its header alone
+struct CompressedBlock
+{
+    uint64_t firstRow = 0;
+    uint32_t rows = 0;
+    int32_t firstDay = 0; // Earliest day in the block
+    int32_t lastDay = 0;  // Latest day in the block
+};
+
+// Walks the blocks of a mapped compressed file. The mapping must outlive
+// the reader.
+class CompressedReader
+{
+public:
+    CompressedReader();
+
+    // Check the file header
+    bool open(const char *begin, const char *end);
+
+    // Move to the next block and describe it without decoding it; false at
+    // the end, or if the blocks no longer follow on from each other
+    bool nextBlock(CompressedBlock &block);
+
+    // Decode the block nextBlock described into columns (replacing them);
+    // false if its checksum or contents are damaged
+    bool readBlock(ActivityColumns &columns);
+
+    // True once the end marker was reached and matched the rows seen
+    bool complete() const { return finished; }
+
+private:
+    const char *cursor;
+    const char *end;
+    const char *payload;
+    uint32_t payloadBytes;
+    uint32_t encodedBytes;
+    uint32_t checksum;
+    CompressedBlock current;
+    uint64_t nextRow;
+    bool finished;
+    std::vector<char> encoded;
+};
+
+// Which rows a scan of a compressed file visits
+struct CompressedRange
+{
+    uint64_t firstRow = 0;
+    int32_t firstDay = std::numeric_limits<int32_t>::min();
+    int32_t lastDay = std::numeric_limits<int32_t>::max();
+};
+
+// Call onRow(const ActivityRow &) for the rows of a mapped compressed file
+// that fall in range, in ID order; blocks wholly outside it are skipped
+// without being decoded. onRow returns false to stop early. A damaged block
+// is reported through onInvalid(begin, end) with a short description and
+// skipped. Returns false if onRow stopped the scan, like forEachActivityRow.
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachCompressedActivity(const char *begin, const char *end, const CompressedRange &range,
+                               RowVisitor onRow, InvalidVisitor onInvalid)
+{
+    static const char DAMAGED[] = "<damaged compressed block>";
+    static const char TRUNCATED[] = "<compressed file cut short>";
+
+    CompressedReader reader;
+    if (!reader.open(begin, end))
+    {
+        onInvalid(DAMAGED, DAMAGED + sizeof(DAMAGED) - 1);
+        return true;
+    }
+
+    CompressedBlock block;
+    ActivityColumns columns;
+    while (reader.nextBlock(block))
+    {
+        if (block.firstRow + block.rows <= range.firstRow || block.lastDay < range.firstDay ||
+            block.firstDay > range.lastDay)
+        {
+            continue;
+        }
+        if (!reader.readBlock(columns))
+        {
+            onInvalid(DAMAGED, DAMAGED + sizeof(DAMAGED) - 1);
+            continue;
+        }
+
+        size_t first = range.firstRow > block.firstRow ? static_cast<size_t>(range.firstRow - block.firstRow) : 0;
+        for (size_t i = first; i < columns.size(); ++i)
+        {
+            if (columns.day[i] < range.firstDay || columns.day[i] > range.lastDay)
+            {
+                continue;
+            }
+            ActivityRow row;
+            row.type = columns.type[i];
+            row.date = Date(columns.day[i]);
+            row.duration = minutesFrom(columns.duration[i]);
+            row.distance = kilometresFrom(columns.distance[i]);
+            row.repetitions = columns.repetitions[i];
+            if (!onRow(row))
+            {
+                return false;
+            }
+        }
+    }
+    if (!reader.complete())
+    {
+        onInvalid(TRUNCATED, TRUNCATED + sizeof(TRUNCATED) - 1);
+    }
+    return true;
+}
+
+// Same, for every row
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachCompressedActivity(const char *begin, const char *end, RowVisitor onRow, InvalidVisitor onInvalid)
+{
+    return forEachCompressedActivity(begin, end, CompressedRange(), onRow, onInvalid);
+}
+
+// Append a vector of Activity-like records (as for activitiesToColumns) to
+// writer; fails on a row the format cannot hold
+template <typename ActivityVector>
+bool appendActivities(CompressedWriter &writer, const ActivityVector &activities)
+{
+    for (const auto &activity : activities)
+    {
+        if (!activity.date.isValid() ||
+            !writer.append(static_cast<int>(activity.type), activity.date.dayNumber(),
+                           activity.duration, activity.distance, activity.repetitions))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // COMPRESSED_STORE_H
@@ -0,0 +1,37 @@
+#include "date.h"
+#include "field_parser.h"
+#include <ctime>
+#include <ostream>
+
+Date Date::parse(const char *begin, const char *end)
+{
+    int year, month, day;
+    if (parseDate(begin, end, year, month, day) != ParseStatus::OK)
+    {
+        return Date();
+    }
+    return fromCivil(year, month, day);
+}
+
+Date Date::today()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return fromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
+
+std::string Date::toString() const
+{
+    if (!isValid())
+    {
+        return std::string();
+    }
+    char text[10];
+    format(text);
+    return std::string(text, sizeof(text));
+}
+
+std::ostream &operator<<(std::ostream &out, Date date)
+{
+    return out << date.toString();
+}
@@ -0,0 +1,61 @@
+#ifndef DATE_H
+#define DATE_H
+
+#include "calendar.h"
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+
+// Day number of a date that did not parse
+const int32_t INVALID_DAY_NUMBER = std::numeric_limits<int32_t>::min();
+
+// A calendar date in four bytes: its day number (days since 1970-01-01, see
+// calendar.h). Dates are parsed where rows and user input come in and
+// formatted where they go out; in between they compare and subtract as
+// plain integers.
+class Date
+{
+public:
+    // An invalid date, which sorts before every valid one
+    Date() : days(INVALID_DAY_NUMBER) {}
+    explicit Date(int32_t dayNumber) : days(dayNumber) {}
+
+    static Date fromCivil(int year, int month, int day) { return Date(daysFromCivil(year, month, day)); }
+
+    // Parse YYYY-MM-DD, ignoring blanks around it; anything else, including
+    // days that do not exist, gives an invalid date
+    static Date parse(const char *begin, const char *end);
+    static Date parse(const std::string &text) { return parse(text.data(), text.data() + text.size()); }
+
+    // The current local date
+    static Date today();
+
+    bool isValid() const { return days != INVALID_DAY_NUMBER; }
+    int32_t dayNumber() const { return days; }
+
+    // Write YYYY-MM-DD into out[0..9]; no terminator is added. The date
+    // must be valid.
+    void format(char *out) const { formatDayNumber(days, out); }
+
+    // YYYY-MM-DD, or an empty string for an invalid date
+    std::string toString() const;
+
+    friend bool operator==(Date a, Date b) { return a.days == b.days; }
+    friend bool operator!=(Date a, Date b) { return a.days != b.days; }
+    friend bool operator<(Date a, Date b) { return a.days < b.days; }
+    friend bool operator<=(Date a, Date b) { return a.days <= b.days; }
+    friend bool operator>(Date a, Date b) { return a.days > b.days; }
+    friend bool operator>=(Date a, Date b) { return a.days >= b.days; }
+
+    // Days from b to a
+    friend int32_t operator-(Date a, Date b) { return a.days - b.days; }
+
+private:
+    int32_t days;
+};
+
+// Writes toString(), honouring the stream's width and alignment
+std::ostream &operator<<(std::ostream &out, Date date);
+
+#endif // DATE_H
@@ -0,0 +1,211 @@
+#include "durability.h"
+#include "file_info.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/utime.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace
+{
+    const char COMMIT_STAMP_NAME[] = ".tracker_commit";
+
+    // Last commit made by this process, so repeated saves within one
+    // interval do not even stat the stamp file
+    int64_t lastCommitNs = 0;
+
+    // Directories with writes waiting for the next group commit
+    std::vector<std::string> pendingDirectories;
+
+    int64_t nowNs()
+    {
+        return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::system_clock::now().time_since_epoch())
+                                        .count());
+    }
+
+    std::string directoryOf(const std::string &path)
+    {
+        size_t slash = path.find_last_of("/\\");
+        if (slash == std::string::npos)
+        {
+            return ".";
+        }
+        return slash == 0 ? path.substr(0, 1) : path.substr(0, slash);
+    }
+
+    // Commit through the stamp file, which exists whatever happened to the
+    // files that were written
+    void commitPendingDirectories()
+    {
+        std::vector<std::string> directories;
+        directories.swap(pendingDirectories);
+        for (const std::string &directory : directories)
+        {
+            std::string stampPath = commitStampPathFor(directory + "/");
+            FILE *stamp = std::fopen(stampPath.c_str(), "ab");
+            if (stamp)
+            {
+                std::fclose(stamp);
+            }
+            commitNow(stampPath);
+        }
+    }
+}
+
+long commitIntervalMs()
+{
+    static long interval = -1;
+    if (interval < 0)
+    {
+        interval = DEFAULT_COMMIT_INTERVAL_MS;
+        const char *setting = std::getenv("TRACKER_COMMIT_INTERVAL_MS");
+        if (setting && *setting)
+        {
+            char *end = nullptr;
+            long value = std::strtol(setting, &end, 10);
+            if (*end == '\0' && value >= 0)
+            {
+                interval = value;
+            }
+        }
+    }
+    return interval;
+}
+
+std::string commitStampPathFor(const std::string &path)
+{
+    return directoryOf(path) + "/" + COMMIT_STAMP_NAME;
+}
+
+bool isCommitDue(const std::string &path)
+{
+    int64_t intervalNs = static_cast<int64_t>(commitIntervalMs()) * 1000000LL;
+    if (intervalNs == 0)
+    {
+        return true;
+    }
+
+    int64_t now = nowNs();
+    if (now - lastCommitNs < intervalNs)
+    {
+        return false;
+    }
+
+    FileInfo stamp;
+    if (!getFileInfo(commitStampPathFor(path), stamp))
+    {
+        return true; // Never committed here
+    }
+    return now - stamp.modifiedNs >= intervalNs || now < stamp.modifiedNs;
+}
+
+bool syncFileSystem(FILE *file)
+{
+    if (std::fflush(file) != 0)
+    {
+        return false;
+    }
+#ifdef _WIN32
+    // No file system wide sync; commit this file only
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    // syncfs also flushes the deferred writes of earlier saves
+    return syncfs(fileno(file)) == 0;
+#else
+    sync();
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool syncDirectoryOf(const std::string &path)
+{
+#ifdef _WIN32
+    (void)path; // Renames are journaled by NTFS
+    return true;
+#else
+    int directory = ::open(directoryOf(path).c_str(), O_RDONLY);
+    if (directory < 0)
+    {
+        return false;
+    }
+    bool synced = fsync(directory) == 0;
+    ::close(directory);
+    return synced;
+#endif
+}
+
+void markCommitted(const std::string &path)
+{
+    lastCommitNs = nowNs();
+    std::string directory = directoryOf(path);
+    for (size_t i = 0; i < pendingDirectories.size(); ++i)
+    {
+        if (pendingDirectories[i] == directory)
+        {
+            pendingDirectories.erase(pendingDirectories.begin() + static_cast<std::ptrdiff_t>(i));
+            break;
+        }
+    }
+    if (commitIntervalMs() == 0)
+    {
+        return; // Every write syncs; nobody reads the stamp
+    }
+
+    std::string stampPath = commitStampPathFor(path);
+    FILE *stamp = std::fopen(stampPath.c_str(), "ab");
+    if (stamp)
+    {
+        std::fclose(stamp);
+    }
+#ifdef _WIN32
+    _utime(stampPath.c_str(), nullptr);
+#else
+    utime(stampPath.c_str(), nullptr);
+#endif
+}
+
+void deferCommit(const std::string &path)
+{
+    static bool registered = false;
+    if (!registered)
+    {
+        registered = std::atexit(commitPendingDirectories) == 0;
+    }
+    std::string directory = directoryOf(path);
+    for (const std::string &pending : pendingDirectories)
+    {
+        if (pending == directory)
+        {
+            return;
+        }
+    }
+    pendingDirectories.push_back(directory);
+}
+
+bool commitNow(const std::string &path)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    bool synced = syncFileSystem(file);
+    std::fclose(file);
+    synced = syncDirectoryOf(path) && synced;
+    if (synced)
+    {
+        markCommitted(path);
+    }
+    return synced;
+}
@@ -0,0 +1,46 @@
+#ifndef DURABILITY_H
+#define DURABILITY_H
+
+#include <cstdio>
+#include <string>
+
+// Default time between group commits
+const long DEFAULT_COMMIT_INTERVAL_MS = 1000;
+
+// Group commit: instead of forcing every save to disk, the first write after
+// the commit interval has passed syncs the whole file system, which makes
+// every deferred write before it durable as well. Writes still deferred when
+// the process exits are synced then. A scripted import of many changes
+// therefore pays for about one sync per interval, and a crash can lose at
+// most the changes of the last interval. Replaced files are always
+// swapped in by rename, so a crash never leaves a half-written file behind.
+//
+// The interval comes from TRACKER_COMMIT_INTERVAL_MS; 0 syncs every write
+// before it returns. The time of the last commit is shared between processes
+// through the modification time of a stamp file next to the data.
+long commitIntervalMs();
+
+// Stamp file recording the last group commit for the directory of path
+std::string commitStampPathFor(const std::string &path);
+
+// True if a write to path has to be made durable now
+bool isCommitDue(const std::string &path);
+
+// Force file and everything written earlier on its file system to disk
+bool syncFileSystem(FILE *file);
+
+// Make a rename or new file in the directory of path durable
+bool syncDirectoryOf(const std::string &path);
+
+// Record that all writes up to now are durable
+void markCommitted(const std::string &path);
+
+// Record a write to path that was not synced, so that it is committed when
+// the process exits
+void deferCommit(const std::string &path);
+
+// Group commit right away, whatever the interval: used before a step that
+// relies on earlier writes having reached the disk
+bool commitNow(const std::string &path);
+
+#endif // DURABILITY_H
@@ -0,0 +1,330 @@
+#include "field_parser.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // Exact powers of ten representable as double
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const int MAX_EXACT_POWER = 22;
+
+    bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    void trim(const char *&begin, const char *&end)
+    {
+        while (begin < end && isBlank(*begin))
+            ++begin;
+        while (end > begin && isBlank(*(end - 1)))
+            --end;
+    }
+
+    // Read exactly count digits starting at text
+    bool readDigits(const char *text, int count, int &value)
+    {
+        value = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (!isDigit(text[i]))
+                return false;
+            value = value * 10 + (text[i] - '0');
+        }
+        return true;
+    }
+}
+
+// Parse an optionally signed base-10 integer
+ParseStatus parseInt(const char *begin, const char *end, int &value)
+{
+    trim(begin, end);
+    if (begin == end)
+        return ParseStatus::EMPTY;
+
+    bool negative = false;
+    if (*begin == '-' || *begin == '+')
+    {
+        negative = (*begin == '-');
+        ++begin;
+    }
+    if (begin == end)
+        return ParseStatus::INVALID;
+
+    long long result = 0;
+    for (const char *cursor = begin; cursor < end; ++cursor)
+    {
+        if (!isDigit(*cursor))
+            return ParseStatus::INVALID;
+        result = result * 10 + (*cursor - '0');
+        if (result > static_cast<long long>(INT_MAX) + 1)
+            return ParseStatus::OUT_OF_RANGE;
+    }
+
+    if (negative)
+        result = -result;
+    if (result > INT_MAX || result < INT_MIN)
+        return ParseStatus::OUT_OF_RANGE;
+
+    value = static_cast<int>(result);
+    return ParseStatus::OK;
+}
+
+// Parse a decimal number such as "12", "-3.25" or "1.5e+06". Up to 19
+// significant digits are accumulated as an integer and scaled once, which
+// is exact for the short fixed-decimal values the data files contain.
+ParseStatus parseDecimal(const char *begin, const char *end, double &value)
+{
+    trim(begin, end);
+    if (begin == end)
+        return ParseStatus::EMPTY;
+
+    bool negative = false;
+    if (*begin == '-' || *begin == '+')
+    {
+        negative = (*begin == '-');
+        ++begin;
+    }
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+    const char *cursor = begin;
+
+    for (; cursor < end && isDigit(*cursor); ++cursor)
+    {
+        anyDigits = true;
+        if (significantDigits < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+            if (mantissa != 0)
+                ++significantDigits;
+        }
+        else
+        {
+            ++exponent; // Digits past the precision limit only scale
+        }
+    }
+
+    if (cursor < end && *cursor == '.')
+    {
+        for (++cursor; cursor < end && isDigit(*cursor); ++cursor)
+        {
+            anyDigits = true;
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+                if (mantissa != 0)
+                    ++significantDigits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!anyDigits)
+        return ParseStatus::INVALID;
+
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+    {
+        ++cursor;
+        bool negativeExponent = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+        {
+            negativeExponent = (*cursor == '-');
+            ++cursor;
+        }
+        if (cursor == end || !isDigit(*cursor))
+            return ParseStatus::INVALID;
+
+        int written = 0;
+        for (; cursor < end && isDigit(*cursor); ++cursor)
+        {
+            if (written < 10000)
+                written = written * 10 + (*cursor - '0');
+        }
+        exponent += negativeExponent ? -written : written;
+    }
+
+    if (cursor != end)
+        return ParseStatus::INVALID;
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0)
+    {
+        if (exponent + significantDigits > 310)
+            return ParseStatus::OUT_OF_RANGE;
+        if (exponent + significantDigits < -330)
+        {
+            value = negative ? -0.0 : 0.0; // Underflows to zero
+            return ParseStatus::OK;
+        }
+
+        while (exponent > MAX_EXACT_POWER)
+        {
+            result *= POWERS_OF_TEN[MAX_EXACT_POWER];
+            exponent -= MAX_EXACT_POWER;
+        }
+        while (exponent < -MAX_EXACT_POWER)
+        {
+            result /= POWERS_OF_TEN[MAX_EXACT_POWER];
+            exponent += MAX_EXACT_POWER;
+        }
+        result = exponent >= 0 ? result * POWERS_OF_TEN[exponent] : result / POWERS_OF_TEN[-exponent];
+
+        if (std::isinf(result))
+            return ParseStatus::OUT_OF_RANGE;
+    }
+
+    value = negative ? -result : result;
+    return ParseStatus::OK;
+}
+
+// Digits accumulate in an int64_t capped well above the int32_t range, so
+// long inputs cannot overflow and still come out OUT_OF_RANGE. Text with an
+// exponent, which formatDecimal writes only for extreme values, goes through
+// parseDecimal instead.
+ParseStatus parseFixedPoint(const char *begin, const char *end, int decimals, int32_t &units)
+{
+    bool exact;
+    return parseFixedPoint(begin, end, decimals, units, exact);
+}
+
+ParseStatus parseFixedPoint(const char *begin, const char *end, int decimals, int32_t &units, bool &exact)
+{
+    const int64_t DIGITS_CAP = 1000000000000LL; // 10^12; times 10^6 still fits
+    const int64_t POWERS[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+    trim(begin, end);
+    if (begin == end)
+        return ParseStatus::EMPTY;
+    if (decimals < 0 || decimals > 6)
+        return ParseStatus::INVALID;
+
+    const char *number = begin;
+    bool negative = *begin == '-';
+    begin += (*begin == '-' || *begin == '+');
+
+    int64_t value = 0;
+    int fractionDigits = 0;
+    int64_t roundUp = 0;
+    bool dropped = false;
+    bool anyDigits = false;
+    const char *cursor = begin;
+    for (; cursor < end && isDigit(*cursor); ++cursor)
+    {
+        anyDigits = true;
+        value = std::min(value * 10 + (*cursor - '0'), DIGITS_CAP);
+    }
+    if (cursor < end && *cursor == '.')
+    {
+        for (++cursor; cursor < end && isDigit(*cursor); ++cursor)
+        {
+            anyDigits = true;
+            int digit = *cursor - '0';
+            if (fractionDigits < decimals)
+            {
+                value = value * 10 + digit;
+                ++fractionDigits;
+            }
+            else if (fractionDigits == decimals)
+            {
+                roundUp = digit >= 5; // Only the first dropped digit decides
+                ++fractionDigits;
+            }
+            dropped = dropped || (fractionDigits > decimals && digit != 0);
+        }
+    }
+
+    if (!anyDigits)
+        return ParseStatus::INVALID;
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+    {
+        double decimal;
+        ParseStatus status = parseDecimal(number, end, decimal);
+        if (status != ParseStatus::OK)
+            return status;
+        double scaled = decimal * static_cast<double>(POWERS[decimals]);
+        if (!(std::fabs(scaled) < static_cast<double>(INT32_MAX) + 0.5))
+            return ParseStatus::OUT_OF_RANGE;
+        units = static_cast<int32_t>(std::llround(scaled));
+        exact = static_cast<double>(units) == scaled;
+        return ParseStatus::OK;
+    }
+    if (cursor != end)
+        return ParseStatus::INVALID;
+
+    if (fractionDigits < decimals)
+        value *= POWERS[decimals - fractionDigits];
+    value += roundUp;
+    if (value > INT32_MAX)
+        return ParseStatus::OUT_OF_RANGE;
+    units = static_cast<int32_t>(negative ? -value : value);
+    exact = !dropped;
+    return ParseStatus::OK;
+}
+
+// Parse YYYY-MM-DD
+ParseStatus parseDate(const char *begin, const char *end, int &year, int &month, int &day)
+{
+    trim(begin, end);
+    if (begin == end)
+        return ParseStatus::EMPTY;
+    if (end - begin != 10 || begin[4] != '-' || begin[7] != '-')
+        return ParseStatus::INVALID;
+
+    int y, m, d;
+    if (!readDigits(begin, 4, y) || !readDigits(begin + 5, 2, m) || !readDigits(begin + 8, 2, d))
+        return ParseStatus::INVALID;
+
+    if (m < 1 || m > 12 || d < 1)
+        return ParseStatus::OUT_OF_RANGE;
+
+    int maxDay = 31;
+    if (m == 4 || m == 6 || m == 9 || m == 11)
+    {
+        maxDay = 30;
+    }
+    else if (m == 2)
+    {
+        bool isLeapYear = (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0));
+        maxDay = isLeapYear ? 29 : 28;
+    }
+    if (d > maxDay)
+        return ParseStatus::OUT_OF_RANGE;
+
+    year = y;
+    month = m;
+    day = d;
+    return ParseStatus::OK;
+}
+
+// Split a CSV line on commas
+size_t splitFields(const char *begin, const char *end,
+                   const char **fieldBegin, const char **fieldEnd, size_t maxFields)
+{
+    size_t fieldCount = 0;
+    const char *cursor = begin;
+    while (cursor < end && fieldCount < maxFields)
+    {
+        const char *comma = static_cast<const char *>(
+            std::memchr(cursor, ',', static_cast<size_t>(end - cursor)));
+        fieldBegin[fieldCount] = cursor;
+        fieldEnd[fieldCount] = comma ? comma : end;
+        ++fieldCount;
+        if (!comma)
+            break;
+        cursor = comma + 1;
+    }
+    return fieldCount;
+}
@@ -0,0 +1,37 @@
+#ifndef FIELD_PARSER_H
+#define FIELD_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Outcome of converting one field; parsers never throw
+enum class ParseStatus
+{
+    OK,
+    EMPTY,       // Field has no characters besides blanks
+    INVALID,     // Unexpected character or malformed layout
+    OUT_OF_RANGE // Well formed, but the value does not fit
+};
+
+// Locale-independent conversions over raw character ranges. Leading and
+// trailing blanks are ignored; anything else after the number is an error.
+ParseStatus parseInt(const char *begin, const char *end, int &value);
+ParseStatus parseDecimal(const char *begin, const char *end, double &value);
+
+// Parse a decimal straight to a whole number of 10^-decimals units (0 to 6
+// decimals) with integer arithmetic: "5.25" with 3 decimals gives 5250.
+// Digits past the last unit round half away from zero; exact is false if
+// that dropped anything but zeros. Values outside the int32_t range are
+// OUT_OF_RANGE.
+ParseStatus parseFixedPoint(const char *begin, const char *end, int decimals, int32_t &units);
+ParseStatus parseFixedPoint(const char *begin, const char *end, int decimals, int32_t &units, bool &exact);
+
+// Parse a YYYY-MM-DD date and check that the day exists in that month
+ParseStatus parseDate(const char *begin, const char *end, int &year, int &month, int &day);
+
+// Split [begin, end) on commas into at most maxFields ranges and return the
+// number found. A trailing empty field is not counted, like std::getline.
+size_t splitFields(const char *begin, const char *end,
+                   const char **fieldBegin, const char **fieldEnd, size_t maxFields);
+
+#endif // FIELD_PARSER_H
@@ -0,0 +1,29 @@
+#include "file_info.h"
+#include <sys/stat.h>
+#include <sys/types.h>
+
+bool getFileInfo(const std::string &path, FileInfo &info)
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    info.size = static_cast<uint64_t>(status.st_size);
+    info.modifiedNs = static_cast<int64_t>(status.st_mtime) * 1000000000LL;
+#else
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    info.size = static_cast<uint64_t>(status.st_size);
+#ifdef __APPLE__
+    info.modifiedNs = static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000LL + status.st_mtimespec.tv_nsec;
+#else
+    info.modifiedNs = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000LL + status.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
@@ -0,0 +1,17 @@
+#ifndef FILE_INFO_H
+#define FILE_INFO_H
+
+#include <cstdint>
+#include <string>
+
+// Size and modification time of a file on disk
+struct FileInfo
+{
+    uint64_t size = 0;
+    int64_t modifiedNs = 0; // Nanoseconds since the epoch where available
+};
+
+// Look up a file; returns false if it does not exist
+bool getFileInfo(const std::string &path, FileInfo &info);
+
+#endif // FILE_INFO_H
@@ -0,0 +1,101 @@
+#include "file_lock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+std::string writerLockPathFor(const std::string &dataPath)
+{
+    return dataPath + ".lock";
+}
+
+std::string publishLockPathFor(const std::string &dataPath)
+{
+    return dataPath + ".publish";
+}
+
+#ifdef _WIN32
+FileLock::FileLock() : handle(INVALID_HANDLE_VALUE), locked(false)
+{
+}
+#else
+FileLock::FileLock() : fd(-1), locked(false)
+{
+}
+#endif
+
+FileLock::~FileLock()
+{
+    unlock();
+}
+
+bool FileLock::lock(const std::string &lockPath, LockMode mode, bool create)
+{
+    unlock();
+
+#ifdef _WIN32
+    handle = CreateFileA(lockPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         nullptr, create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    OVERLAPPED overlapped = {};
+    DWORD flags = mode == LockMode::EXCLUSIVE ? LOCKFILE_EXCLUSIVE_LOCK : 0;
+    if (!LockFileEx(handle, flags, 0, 1, 0, &overlapped))
+    {
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+        return false;
+    }
+#else
+    fd = create ? ::open(lockPath.c_str(), O_RDWR | O_CREAT, 0644) : ::open(lockPath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    // flock locks belong to this descriptor, so two FileLocks in one
+    // process do not release each other the way fcntl locks would
+    int operation = mode == LockMode::EXCLUSIVE ? LOCK_EX : LOCK_SH;
+    int result;
+    do
+    {
+        result = flock(fd, operation);
+    } while (result != 0 && errno == EINTR);
+    if (result != 0)
+    {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+#endif
+
+    locked = true;
+    return true;
+}
+
+void FileLock::unlock()
+{
+#ifdef _WIN32
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        OVERLAPPED overlapped = {};
+        UnlockFileEx(handle, 0, 1, 0, &overlapped);
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd >= 0)
+    {
+        ::close(fd); // Closing the descriptor releases the lock
+        fd = -1;
+    }
+#endif
+    locked = false;
+}
@@ -0,0 +1,76 @@
+#ifndef FILE_LOCK_H
+#define FILE_LOCK_H
+
+#include <string>
+
+// Inter-process coordination for one collection (activities or goals).
+//
+// Writers hold the collection's writer lock, <file>.lock, from before they
+// load the data they are about to change until the change is on disk, so
+// concurrent read-modify-write commands cannot lose each other's updates.
+//
+// Readers never wait for writers. Every change becomes visible through an
+// atomic rename or a single line append, and a reader keeps using the file
+// version it mapped. The only step that touches two files at once is
+// folding a journal or tombstones into the data file: a rename followed by
+// a delete. Writers take the publish lock, <file>.publish, exclusively for
+// just that step. Readers take it shared while they open the files of one
+// version, which takes microseconds, and then read without any lock.
+// Readers never create a lock file; see openPublishedVersion.
+enum class LockMode
+{
+    SHARED,
+    EXCLUSIVE
+};
+
+std::string writerLockPathFor(const std::string &dataPath);
+std::string publishLockPathFor(const std::string &dataPath);
+
+// Advisory lock on a lock file, released by unlock(), the destructor or
+// the process exiting
+class FileLock
+{
+public:
+    FileLock();
+    ~FileLock();
+
+    // Block until the lock is held; creates the lock file if needed, unless
+    // create is false, in which case a missing lock file fails the call
+    bool lock(const std::string &lockPath, LockMode mode, bool create = true);
+    void unlock();
+
+    bool isLocked() const { return locked; }
+
+private:
+#ifdef _WIN32
+    void *handle;
+#else
+    int fd;
+#endif
+    bool locked;
+
+    FileLock(const FileLock &) = delete;
+    FileLock &operator=(const FileLock &) = delete;
+};
+
+// Call open(), which opens the files of one version of dataPath, under a
+// shared publish lock. Until a writer first publishes there is no lock
+// file and nothing to wait for, so open() runs unlocked; it runs again
+// under the lock if a writer created the file meanwhile, since that
+// writer's swap may have been seen half done.
+template <typename Opener>
+void openPublishedVersion(const std::string &dataPath, Opener open)
+{
+    FileLock publish;
+    if (!publish.lock(publishLockPathFor(dataPath), LockMode::SHARED, false))
+    {
+        open();
+        if (!publish.lock(publishLockPathFor(dataPath), LockMode::SHARED, false))
+        {
+            return;
+        }
+    }
+    open();
+}
+
+#endif // FILE_LOCK_H
@@ -0,0 +1,79 @@
+#include "fixed_point.h"
+#include "number_format.h"
+#include <cmath>
+
+namespace
+{
+    const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+
+    ParseStatus parseUnits(const char *begin, const char *end, int decimals, double &value)
+    {
+        int32_t units;
+        bool exact;
+        ParseStatus status = parseFixedPoint(begin, end, decimals, units, exact);
+        if (status == ParseStatus::OK && !exact)
+        {
+            return parseDecimal(begin, end, value); // Keep the digits past the units
+        }
+        if (status == ParseStatus::OK)
+        {
+            value = fromFixedPoint(units, decimals);
+        }
+        return status;
+    }
+}
+
+int32_t toFixedPoint(double value, int decimals)
+{
+    double scaled = value * POWERS_OF_TEN[decimals];
+    if (!(scaled == scaled))
+    {
+        return 0;
+    }
+    if (scaled >= INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (scaled <= INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return static_cast<int32_t>(std::lround(scaled));
+}
+
+bool fitsFixedPoint(double value, int decimals)
+{
+    // Rounds to at most INT32_MAX in magnitude; NaN fails both tests
+    double scaled = value * POWERS_OF_TEN[decimals];
+    return scaled < INT32_MAX + 0.5 && scaled > INT32_MIN - 0.5;
+}
+
+bool isWholeUnits(double value, int decimals)
+{
+    return fitsFixedPoint(value, decimals) && fromFixedPoint(toFixedPoint(value, decimals), decimals) == value;
+}
+
+size_t formatMeasure(double value, int decimals, char *out)
+{
+    if (isWholeUnits(value, decimals))
+    {
+        return formatFixedPoint(toFixedPoint(value, decimals), decimals, out);
+    }
+    return formatDecimal(value, out);
+}
+
+double fromFixedPoint(int64_t units, int decimals)
+{
+    // Both operands are exact, so the quotient is correctly rounded
+    return static_cast<double>(units) / POWERS_OF_TEN[decimals];
+}
+
+ParseStatus parseDuration(const char *begin, const char *end, double &minutes)
+{
+    return parseUnits(begin, end, DURATION_DECIMALS, minutes);
+}
+
+ParseStatus parseDistance(const char *begin, const char *end, double &kilometres)
+{
+    return parseUnits(begin, end, DISTANCE_DECIMALS, kilometres);
+}
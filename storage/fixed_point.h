@@ -0,0 +1,57 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include "field_parser.h"
+#include <cstddef>
+#include <cstdint>
+
+// Durations and distances are held as whole units: hundredths of a minute
+// (centiminutes) and metres. Files are parsed straight to units and written
+// from them, and the column stores keep and add them as integers, so a value
+// reads back exactly and totals do not depend on the order rows are added
+// in. Front-end records still carry doubles, normally the double nearest to
+// a whole number of units. A value written with more decimals than that
+// (30.125 minutes) is not rounded: it is read and written as a plain
+// decimal, and the store keeps it beside its columns. Values too large for
+// the units are rejected where they enter, never clamped.
+const int DURATION_DECIMALS = 2; // Minutes to centiminutes
+const int DISTANCE_DECIMALS = 3; // Kilometres to metres
+
+// Largest values the units hold: INT32_MAX centiminutes and metres
+const double MAX_DURATION_MINUTES = 21474836.47;
+const double MAX_DISTANCE_KILOMETRES = 2147483.647;
+
+// value * 10^decimals rounded half away from zero. Input is checked with
+// fitsFixedPoint first; the clamp to int32_t and NaN giving 0 only keep the
+// conversion defined.
+int32_t toFixedPoint(double value, int decimals);
+
+// True if value is finite and its units fit in int32_t
+bool fitsFixedPoint(double value, int decimals);
+
+// True if value is exactly the double for a whole number of units
+bool isWholeUnits(double value, int decimals);
+
+// Write value as its units (see formatFixedPoint) when it is a whole number
+// of them, or else as the shortest decimal that reads back the same (see
+// formatDecimal). Returns the number of characters.
+size_t formatMeasure(double value, int decimals, char *out);
+
+// The double nearest to units / 10^decimals
+double fromFixedPoint(int64_t units, int decimals);
+
+inline int32_t toCentiminutes(double minutes) { return toFixedPoint(minutes, DURATION_DECIMALS); }
+inline int32_t toMetres(double kilometres) { return toFixedPoint(kilometres, DISTANCE_DECIMALS); }
+inline double minutesFrom(int64_t centiminutes) { return fromFixedPoint(centiminutes, DURATION_DECIMALS); }
+inline double kilometresFrom(int64_t metres) { return fromFixedPoint(metres, DISTANCE_DECIMALS); }
+inline bool durationFits(double minutes) { return fitsFixedPoint(minutes, DURATION_DECIMALS); }
+inline bool distanceFits(double kilometres) { return fitsFixedPoint(kilometres, DISTANCE_DECIMALS); }
+
+// Parse a duration in minutes or a distance in kilometres to whole units
+// (see parseFixedPoint) and give the double those units stand for. Text
+// with more decimals than the units gives the double it spells instead.
+// Values the units cannot hold are OUT_OF_RANGE.
+ParseStatus parseDuration(const char *begin, const char *end, double &minutes);
+ParseStatus parseDistance(const char *begin, const char *end, double &kilometres);
+
+#endif // FIXED_POINT_H
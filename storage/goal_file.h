@@ -0,0 +1,86 @@
+#ifndef GOAL_FILE_H
+#define GOAL_FILE_H
+
+#include "activity_csv.h"
+#include "file_lock.h"
+#include "mapped_file.h"
+#include "tombstones.h"
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <unordered_set>
+
+// What a pass over a goals file saw besides the live rows
+struct GoalFileStats
+{
+    size_t lines = 0;    // Lines in the file, known before the first row is visited
+    size_t deadRows = 0; // Rows with a tombstone, still in the file
+    int nextId = 0;      // One past the highest ID in the file or ever handed out
+};
+
+// Stream the live rows of an app_1/app_2 goals file. Rows written before
+// goals had stable IDs take their position among the valid rows, which is
+// the ID they were always shown with. Rows whose ID has a tombstone are
+// skipped and counted in stats, and IDs that compaction dropped are still
+// counted for stats.nextId (see tombstones.h). TRACKER files have no IDs,
+// so every row takes its position. Returns false if the file cannot be
+// opened.
+template <typename RowVisitor, typename InvalidVisitor>
+bool forEachLiveGoal(const std::string &goalsPath, GoalFileStats &stats,
+                     RowVisitor onRow, InvalidVisitor onInvalid, GoalLayout layout = GoalLayout::SHARED)
+{
+    // The saved next ID only grows, so it needs no lock; the goals file and
+    // its tombstones are read as one version
+    stats.nextId = loadNextId(goalsPath);
+    MappedFile file;
+    std::unordered_set<int> dead;
+    openPublishedVersion(goalsPath, [&]()
+    {
+        if (file.open(goalsPath))
+        {
+            dead = loadTombstones(tombstonePathFor(goalsPath));
+        }
+    });
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    stats.lines = countLines(file.begin(), file.end());
+    int position = 0;
+    forEachLine(file.begin(), file.end(), [&](const char *lineBegin, const char *lineEnd)
+    {
+        GoalRow row;
+        RowStatus status = parseGoalRow(lineBegin, lineEnd, row, layout);
+        if (status == RowStatus::INVALID)
+        {
+            onInvalid(lineBegin, lineEnd);
+            return;
+        }
+        if (status != RowStatus::OK)
+        {
+            return;
+        }
+
+        if (row.id < 0)
+        {
+            row.id = position;
+        }
+        ++position;
+        if (row.id >= stats.nextId)
+        {
+            // The highest ID leaves no next one; adding a goal then fails
+            stats.nextId = row.id < std::numeric_limits<int>::max() ? row.id + 1 : row.id;
+        }
+
+        if (dead.count(row.id) != 0)
+        {
+            ++stats.deadRows;
+            return;
+        }
+        onRow(row);
+    });
+    return true;
+}
+
+#endif // GOAL_FILE_H
@@ -0,0 +1,28 @@
+#include "io_stats.h"
+#include <atomic>
+
+namespace
+{
+    std::atomic<uint64_t> totalBytesWritten(0);
+    std::atomic<uint64_t> totalWriteNs(0);
+}
+
+void recordBytesWritten(uint64_t bytes)
+{
+    totalBytesWritten += bytes;
+}
+
+uint64_t bytesWritten()
+{
+    return totalBytesWritten.load();
+}
+
+void recordWriteTime(uint64_t nanoseconds)
+{
+    totalWriteNs += nanoseconds;
+}
+
+double writeSeconds()
+{
+    return static_cast<double>(totalWriteNs.load()) / 1e9;
+}
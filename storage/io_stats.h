@@ -0,0 +1,15 @@
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <cstdint>
+
+// Running total of bytes this process has written to data files, so each
+// command can report how much I/O it caused
+void recordBytesWritten(uint64_t bytes);
+uint64_t bytesWritten();
+
+// Running total of time spent writing data files
+void recordWriteTime(uint64_t nanoseconds);
+double writeSeconds();
+
+#endif // IO_STATS_H
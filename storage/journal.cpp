@@ -0,0 +1,110 @@
+#include "journal.h"
+#include "buffered_writer.h"
+#include "durability.h"
+#include "file_info.h"
+#include "mapped_file.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+std::string journalPathFor(const std::string &dataPath)
+{
+    return dataPath + ".journal";
+}
+
+namespace
+{
+    // Cut the file at path back to its first length bytes
+    bool truncateFile(const std::string &path, uint64_t length)
+    {
+#ifdef _WIN32
+        int fd;
+        if (_sopen_s(&fd, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+        {
+            return false;
+        }
+        bool truncated = _chsize_s(fd, static_cast<__int64>(length)) == 0;
+        _close(fd);
+        return truncated;
+#else
+        return ::truncate(path.c_str(), static_cast<off_t>(length)) == 0;
+#endif
+    }
+
+    // A record torn by a crash during an earlier append was never reported
+    // as written and is not replayed; cut it off so the next record starts
+    // on a line of its own instead of being glued to it
+    bool dropTornRecord(const std::string &journalPath)
+    {
+        MappedFile journal;
+        if (!journal.open(journalPath))
+        {
+            return true; // No journal yet
+        }
+        const char *complete = completeLinesEnd(journal.begin(), journal.end());
+        if (complete == journal.end())
+        {
+            return true;
+        }
+        uint64_t length = static_cast<uint64_t>(complete - journal.begin());
+        journal.close();
+        return truncateFile(journalPath, length);
+    }
+}
+
+// Write the record and its newline with a single append, after any torn
+// record left at the end
+bool appendJournalRecord(const std::string &journalPath, const std::string &record)
+{
+    if (!dropTornRecord(journalPath))
+    {
+        return false;
+    }
+
+    BufferedWriter outFile(record.size() + 1);
+    if (!outFile.open(journalPath, WriteMode::APPEND))
+    {
+        return false;
+    }
+
+    outFile.write(record);
+    outFile.put('\n');
+    return outFile.close();
+}
+
+bool isJournalCompactionDue(const std::string &journalPath)
+{
+    FileInfo info;
+    return getFileInfo(journalPath, info) && info.size >= JOURNAL_COMPACT_BYTES;
+}
+
+bool removeJournal(const std::string &journalPath)
+{
+    FileInfo info;
+    if (!getFileInfo(journalPath, info))
+    {
+        return true; // Nothing to remove
+    }
+    // The folded rows must be on disk before the journal goes away
+    if (!commitNow(journalPath))
+    {
+        return false;
+    }
+    return std::remove(journalPath.c_str()) == 0 && syncDirectoryOf(journalPath);
+}
+
+const char *completeLinesEnd(const char *begin, const char *end)
+{
+    while (end > begin && *(end - 1) != '\n')
+    {
+        --end;
+    }
+    return end;
+}
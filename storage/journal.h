@@ -0,0 +1,34 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Append-only journal kept next to a data file as <file>.journal. New
+// records are appended as single lines in the data file's own format, so
+// adding one costs the same however large the history is. Loaders read the
+// data file first and then replay the journal; compaction rewrites the data
+// file with everything and removes the journal.
+
+// Compact once the journal grows past this many bytes
+const uint64_t JOURNAL_COMPACT_BYTES = 1 << 20;
+
+std::string journalPathFor(const std::string &dataPath);
+
+// Append one formatted record; a newline is added. A torn record at the
+// end, left by a crash during an earlier append, is cut off first. Callers
+// hold the writer lock (see file_lock.h).
+bool appendJournalRecord(const std::string &journalPath, const std::string &record);
+
+// True if the journal is large enough to fold into the data file
+bool isJournalCompactionDue(const std::string &journalPath);
+
+// Delete the journal after its records have been folded into the data file
+bool removeJournal(const std::string &journalPath);
+
+// End of the last complete line in [begin, end). A record cut short by a
+// crash during append has no newline yet and must not be replayed.
+const char *completeLinesEnd(const char *begin, const char *end);
+
+#endif // JOURNAL_H
@@ -0,0 +1,174 @@
+#include "lz_codec.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    const size_t MIN_MATCH = 4;
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 14;
+
+    uint32_t read32(const char *p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash4(const char *p)
+    {
+        return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Lengths of 15 and more continue in bytes of up to 255
+    void writeLength(std::vector<char> &out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        out.push_back(static_cast<char>(length));
+    }
+
+    void writeSequence(std::vector<char> &out, const char *literals, size_t literalCount,
+                       size_t offset, size_t matchLength)
+    {
+        size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+        unsigned char token = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+        if (matchLength > 0)
+        {
+            token |= static_cast<unsigned char>(matchCode < 15 ? matchCode : 15);
+        }
+        out.push_back(static_cast<char>(token));
+        if (literalCount >= 15)
+        {
+            writeLength(out, literalCount - 15);
+        }
+        out.insert(out.end(), literals, literals + literalCount);
+        if (matchLength == 0)
+        {
+            return; // Last sequence
+        }
+        out.push_back(static_cast<char>(offset & 0xFF));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (matchCode >= 15)
+        {
+            writeLength(out, matchCode - 15);
+        }
+    }
+
+    // Read a length continued in extra bytes; false past the end
+    bool readLength(const unsigned char *&in, const unsigned char *end, size_t &length)
+    {
+        unsigned char byte;
+        do
+        {
+            if (in == end)
+            {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+void lzCompress(const char *data, size_t length, std::vector<char> &out)
+{
+    out.clear();
+    out.reserve(length / 2 + 16);
+
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+    size_t literalStart = 0;
+    size_t pos = 0;
+    while (length >= MIN_MATCH && pos <= length - MIN_MATCH)
+    {
+        uint32_t hash = hash4(data + pos);
+        size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(pos);
+
+        if (candidate < pos && pos - candidate <= MAX_OFFSET && read32(data + candidate) == read32(data + pos))
+        {
+            size_t matchLength = MIN_MATCH;
+            while (pos + matchLength < length && data[candidate + matchLength] == data[pos + matchLength])
+            {
+                ++matchLength;
+            }
+            writeSequence(out, data + literalStart, pos - literalStart, pos - candidate, matchLength);
+            pos += matchLength;
+            literalStart = pos;
+        }
+        else
+        {
+            ++pos;
+        }
+    }
+    writeSequence(out, data + literalStart, length - literalStart, 0, 0);
+}
+
+bool lzDecompress(const char *data, size_t length, char *out, size_t outLength)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *inEnd = in + length;
+    size_t written = 0;
+
+    while (in < inEnd)
+    {
+        unsigned char token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(in, inEnd, literalCount))
+        {
+            return false;
+        }
+        if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > outLength - written)
+        {
+            return false;
+        }
+        std::memcpy(out + written, in, literalCount);
+        in += literalCount;
+        written += literalCount;
+
+        if (in == inEnd)
+        {
+            break; // The last sequence has no match
+        }
+
+        if (inEnd - in < 2)
+        {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+        in += 2;
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+        {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > written || matchLength > outLength - written)
+        {
+            return false;
+        }
+
+        // Overlapping matches repeat the bytes just written, so they are
+        // copied forwards one byte at a time
+        char *target = out + written;
+        const char *source = target - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(target, source, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+            {
+                target[i] = source[i];
+            }
+        }
+        written += matchLength;
+    }
+    return written == outLength;
+}
@@ -0,0 +1,26 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstddef>
+#include <vector>
+
+// A small LZ77 byte codec in the style of LZ4, so compressed files need no
+// external library. The stream is a run of sequences:
+//
+//   token    high nibble: literal count, low nibble: match length - 4;
+//            15 in either means extra length bytes follow (255 = more)
+//   literals copied as they are
+//   offset   two bytes, little endian, back into the output
+//
+// The last sequence has literals only. Matches are found greedily through a
+// hash of the next four bytes, which favours speed over ratio.
+
+// Compress [data, data + length) into out, replacing its contents
+void lzCompress(const char *data, size_t length, std::vector<char> &out);
+
+// Decompress exactly outLength bytes into out. Every length and offset is
+// checked, so damaged input makes this return false instead of reading or
+// writing out of bounds.
+bool lzDecompress(const char *data, size_t length, char *out, size_t outLength);
+
+#endif // LZ_CODEC_H
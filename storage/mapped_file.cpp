@@ -0,0 +1,113 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char emptyData[1] = {'\0'};
+}
+
+MappedFile::MappedFile() : data(emptyData), length(0), opened(false), mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+// Map the whole file read-only
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    info.size = static_cast<uint64_t>(status.st_size);
+#ifdef __APPLE__
+    info.modifiedNs = static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000LL + status.st_mtimespec.tv_nsec;
+#else
+    info.modifiedNs = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000LL + status.st_mtim.tv_nsec;
+#endif
+
+    if (status.st_size > 0)
+    {
+        void *address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED)
+        {
+            // Loaders walk the file front to back exactly once
+            madvise(address, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char *>(address);
+            length = static_cast<size_t>(status.st_size);
+            mapped = true;
+        }
+    }
+
+    ::close(fd);
+
+    if (status.st_size > 0 && !mapped)
+    {
+        return false;
+    }
+#else
+    // No mmap here, so read the file in one go instead
+    std::ifstream inFile(filename, std::ios::binary | std::ios::ate);
+    if (!inFile.is_open())
+    {
+        return false;
+    }
+
+    getFileInfo(filename, info);
+    std::streamsize fileSize = inFile.tellg();
+    inFile.seekg(0, std::ios::beg);
+    if (fileSize > 0)
+    {
+        buffer.resize(static_cast<size_t>(fileSize));
+        if (!inFile.read(&buffer[0], fileSize))
+        {
+            buffer.clear();
+            return false;
+        }
+        data = &buffer[0];
+        length = buffer.size();
+    }
+#endif
+
+    opened = true;
+    return true;
+}
+
+// Release the mapping
+void MappedFile::close()
+{
+#ifndef _WIN32
+    if (mapped)
+    {
+        munmap(const_cast<char *>(data), length);
+    }
+#endif
+    buffer.clear();
+    data = emptyData;
+    length = 0;
+    opened = false;
+    mapped = false;
+    info = FileInfo();
+}
@@ -0,0 +1,42 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "file_info.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is mapped into
+// memory so callers can parse records in place instead of copying lines.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Open and map a file; returns false if it cannot be opened
+    bool open(const std::string &filename);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char *begin() const { return data; }
+    const char *end() const { return data + length; }
+    size_t size() const { return length; }
+
+    // Size and modification time of the version that was opened, which
+    // may since have been replaced on disk
+    const FileInfo &fileInfo() const { return info; }
+
+private:
+    const char *data;
+    size_t length;
+    bool opened;
+    bool mapped;
+    FileInfo info;
+    std::vector<char> buffer; // Used where mmap is not available
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,127 @@
+#include "number_format.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+namespace
+{
+    const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    const int MAX_FRACTION_DIGITS = 9;
+
+    // Above this, value * 10^9 no longer fits the exact integer range
+    const double MAX_SCALED_MAGNITUDE = 9007199254740992.0; // 2^53
+
+    // Write digits of value right to left ending at end; returns the start
+    char *writeDigits(uint64_t value, char *end)
+    {
+        do
+        {
+            *--end = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        return end;
+    }
+
+    // Write mantissa / 10^decimals with a decimal point
+    size_t writeScaled(bool negative, uint64_t mantissa, int decimals, char *out)
+    {
+        char digits[NUMBER_BUFFER_BYTES];
+        char *end = digits + sizeof(digits);
+        char *begin = writeDigits(mantissa, end);
+        while (end - begin <= decimals)
+        {
+            *--begin = '0'; // Leading zeros for values below 1
+        }
+
+        size_t length = 0;
+        if (negative)
+        {
+            out[length++] = '-';
+        }
+        size_t integerDigits = static_cast<size_t>(end - begin) - static_cast<size_t>(decimals);
+        for (size_t i = 0; i < integerDigits; ++i)
+        {
+            out[length++] = begin[i];
+        }
+        if (decimals > 0)
+        {
+            out[length++] = '.';
+            for (const char *cursor = begin + integerDigits; cursor < end; ++cursor)
+            {
+                out[length++] = *cursor;
+            }
+        }
+        return length;
+    }
+}
+
+size_t formatInt(long long value, char *out)
+{
+    char digits[NUMBER_BUFFER_BYTES];
+    char *end = digits + sizeof(digits);
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    char *begin = writeDigits(magnitude, end);
+
+    size_t length = 0;
+    if (value < 0)
+    {
+        out[length++] = '-';
+    }
+    while (begin < end)
+    {
+        out[length++] = *begin++;
+    }
+    return length;
+}
+
+// Try 0, 1, 2, ... fractional digits and keep the first that divides back
+// to the same double. Both this check and a correctly rounded parser round
+// the same exact fraction, so the text reads back exactly.
+size_t formatDecimal(double value, char *out)
+{
+    double magnitude = std::fabs(value);
+    if (magnitude * POWERS_OF_TEN[MAX_FRACTION_DIGITS] < MAX_SCALED_MAGNITUDE)
+    {
+        bool negative = std::signbit(value) && value != 0.0;
+        for (int decimals = 0; decimals <= MAX_FRACTION_DIGITS; ++decimals)
+        {
+            double scaled = std::floor(magnitude * POWERS_OF_TEN[decimals] + 0.5);
+            if (scaled / POWERS_OF_TEN[decimals] == magnitude)
+            {
+                return writeScaled(negative, static_cast<uint64_t>(scaled), decimals, out);
+            }
+        }
+    }
+
+    int length = std::snprintf(out, NUMBER_BUFFER_BYTES, "%.17g", value);
+    return length > 0 ? static_cast<size_t>(length) : 0;
+}
+
+size_t formatFixedPoint(long long units, int decimals, char *out)
+{
+    uint64_t magnitude = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+    while (decimals > 0 && magnitude % 10 == 0)
+    {
+        magnitude /= 10;
+        --decimals;
+    }
+    return writeScaled(units < 0, magnitude, decimals, out);
+}
+
+size_t formatFixed(double value, int decimals, char *out)
+{
+    double magnitude = std::fabs(value);
+    if (decimals >= 0 && decimals <= MAX_FRACTION_DIGITS &&
+        magnitude * POWERS_OF_TEN[decimals] < MAX_SCALED_MAGNITUDE)
+    {
+        uint64_t scaled = static_cast<uint64_t>(std::floor(magnitude * POWERS_OF_TEN[decimals] + 0.5));
+        return writeScaled(value < 0 && scaled != 0, scaled, decimals, out);
+    }
+
+    int length = std::snprintf(out, NUMBER_BUFFER_BYTES, "%.*f", decimals, value);
+    if (length <= 0 || length >= static_cast<int>(NUMBER_BUFFER_BYTES))
+    {
+        length = std::snprintf(out, NUMBER_BUFFER_BYTES, "%.17g", value); // Too wide for fixed notation
+    }
+    return length > 0 ? static_cast<size_t>(length) : 0;
+}
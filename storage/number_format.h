@@ -0,0 +1,27 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <cstddef>
+
+// Room for any number the formatters below produce
+const size_t NUMBER_BUFFER_BYTES = 32;
+
+// Write an integer in base 10; returns the number of characters
+size_t formatInt(long long value, char *out);
+
+// Write the shortest plain decimal (at most 9 fractional digits) that reads
+// back as exactly the same double, e.g. "30", "5.25", "0.1". Values that
+// have no such form fall back to 17 significant digits, which also round
+// trip. Returns the number of characters.
+size_t formatDecimal(double value, char *out);
+
+// Write units / 10^decimals with trailing fractional zeros dropped, e.g.
+// 3050 with 2 decimals as "30.5" and 5000 with 3 as "5", using integer
+// arithmetic only. Returns the number of characters.
+size_t formatFixedPoint(long long units, int decimals, char *out);
+
+// Write a value rounded to a fixed number of decimals, like
+// std::fixed << std::setprecision(decimals). Returns the number of characters.
+size_t formatFixed(double value, int decimals, char *out);
+
+#endif // NUMBER_FORMAT_H
@@ -0,0 +1,70 @@
+#include "parallel_parse.h"
+#include <cstring>
+
+// Cut the buffer into roughly equal pieces, moving each cut forward to the
+// next line start
+std::vector<TextRange> splitAtLines(const char *begin, const char *end, size_t parts)
+{
+    std::vector<TextRange> ranges;
+    if (begin >= end)
+    {
+        return ranges;
+    }
+    if (parts == 0)
+    {
+        parts = 1;
+    }
+
+    size_t target = static_cast<size_t>(end - begin) / parts;
+    const char *chunkBegin = begin;
+
+    for (size_t i = 1; i < parts && chunkBegin < end; ++i)
+    {
+        const char *cut = begin + target * i;
+        if (cut <= chunkBegin)
+        {
+            continue;
+        }
+        if (cut >= end)
+        {
+            break;
+        }
+
+        const char *newline = static_cast<const char *>(
+            std::memchr(cut, '\n', static_cast<size_t>(end - cut)));
+        if (!newline)
+        {
+            break;
+        }
+
+        TextRange range = {chunkBegin, newline + 1};
+        ranges.push_back(range);
+        chunkBegin = newline + 1;
+    }
+
+    if (chunkBegin < end)
+    {
+        TextRange range = {chunkBegin, end};
+        ranges.push_back(range);
+    }
+
+    return ranges;
+}
+
+// One chunk per core, but never less than MIN_PARALLEL_CHUNK_BYTES each
+size_t parallelChunkCount(size_t bytes)
+{
+    size_t cores = std::thread::hardware_concurrency();
+    if (cores == 0)
+    {
+        cores = 1;
+    }
+
+    size_t bySize = bytes / MIN_PARALLEL_CHUNK_BYTES;
+    if (bySize == 0)
+    {
+        bySize = 1;
+    }
+
+    return bySize < cores ? bySize : cores;
+}
@@ -0,0 +1,103 @@
+#ifndef PARALLEL_PARSE_H
+#define PARALLEL_PARSE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// A byte range inside a loaded file
+struct TextRange
+{
+    const char *begin;
+    const char *end;
+};
+
+// Files smaller than this per worker are not worth a thread
+const size_t MIN_PARALLEL_CHUNK_BYTES = 1 << 20;
+
+// Split [begin, end) into at most `parts` ranges of similar size. Every
+// range except the last ends just after a newline, so no line is split.
+std::vector<TextRange> splitAtLines(const char *begin, const char *end, size_t parts);
+
+// Number of chunks to use for a buffer of `bytes`, bounded by core count
+size_t parallelChunkCount(size_t bytes);
+
+// Parse [begin, end) in line-aligned chunks on worker threads. parseChunk
+// is called as parseChunk(chunkBegin, chunkEnd, result) and must only touch
+// its own result. Results are returned in file order so callers can append
+// them and get the same row order as a serial pass.
+template <typename ChunkResult, typename ParseChunk>
+std::vector<ChunkResult> parseInParallel(const char *begin, const char *end, ParseChunk parseChunk)
+{
+    std::vector<TextRange> chunks = splitAtLines(begin, end, parallelChunkCount(static_cast<size_t>(end - begin)));
+    std::vector<ChunkResult> results(chunks.size());
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size());
+    for (size_t i = 1; i < chunks.size(); ++i)
+    {
+        workers.emplace_back([&chunks, &results, &parseChunk, i]()
+        {
+            parseChunk(chunks[i].begin, chunks[i].end, results[i]);
+        });
+    }
+
+    // The calling thread takes the first chunk itself
+    if (!chunks.empty())
+    {
+        parseChunk(chunks[0].begin, chunks[0].end, results[0]);
+    }
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    return results;
+}
+
+// Call task(i) for every i in [0, count) on at most one thread per core.
+// Threads take the next index as they finish one, so a few large tasks do
+// not hold up the small ones behind them. task must only touch state that
+// belongs to its index.
+template <typename Task>
+void runInParallel(size_t count, Task task)
+{
+    size_t threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+    if (threads > count)
+    {
+        threads = count;
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&next, &task, count]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            task(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 1; i < threads; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    if (threads > 0)
+    {
+        work();
+    }
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+#endif // PARALLEL_PARSE_H
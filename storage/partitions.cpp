@@ -0,0 +1,248 @@
+#include "partitions.h"
+#include "block_checksums.h"
+#include "buffered_writer.h"
+#include "calendar.h"
+#include "field_parser.h"
+#include "journal.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    const char PARTITION_CATALOG_MAGIC[] = "tracker-partitions";
+
+    // Days of the year or month a key names; every day for the undated
+    // partition
+    void periodOf(const std::string &key, int32_t &firstDay, int32_t &lastDay)
+    {
+        int year = 0;
+        int month = 0;
+        const char *begin = key.data();
+        if (key.size() == 4 && parseInt(begin, begin + 4, year) == ParseStatus::OK)
+        {
+            firstDay = daysFromCivil(year, 1, 1);
+            lastDay = daysFromCivil(year + 1, 1, 1) - 1;
+            return;
+        }
+        if (key.size() == 7 && key[4] == '-' && parseInt(begin, begin + 4, year) == ParseStatus::OK &&
+            parseInt(begin + 5, begin + 7, month) == ParseStatus::OK && month >= 1 && month <= 12)
+        {
+            firstDay = daysFromCivil(year, month, 1);
+            lastDay = month == 12 ? daysFromCivil(year + 1, 1, 1) - 1 : daysFromCivil(year, month + 1, 1) - 1;
+            return;
+        }
+        firstDay = std::numeric_limits<int32_t>::min();
+        lastDay = std::numeric_limits<int32_t>::max();
+    }
+
+    bool parseScheme(const std::string &name, PartitionScheme &scheme)
+    {
+        if (name == partitionSchemeName(PartitionScheme::YEAR))
+        {
+            scheme = PartitionScheme::YEAR;
+            return true;
+        }
+        if (name == partitionSchemeName(PartitionScheme::MONTH))
+        {
+            scheme = PartitionScheme::MONTH;
+            return true;
+        }
+        return false;
+    }
+
+    bool keyBefore(const Partition &partition, const std::string &key)
+    {
+        return partition.key < key;
+    }
+}
+
+std::string partitionCatalogPathFor(const std::string &dataPath)
+{
+    return dataPath + ".catalog";
+}
+
+std::string partitionPathFor(const std::string &dataPath, const std::string &key)
+{
+    return dataPath + "." + key;
+}
+
+const char *partitionSchemeName(PartitionScheme scheme)
+{
+    switch (scheme)
+    {
+    case PartitionScheme::YEAR:
+        return "year";
+    case PartitionScheme::MONTH:
+        return "month";
+    case PartitionScheme::NONE:
+        break;
+    }
+    return "single file";
+}
+
+std::string partitionKeyFor(PartitionScheme scheme, Date date)
+{
+    int year, month, day;
+    if (!date.isValid())
+    {
+        return UNDATED_PARTITION;
+    }
+    civilFromDays(date.dayNumber(), year, month, day);
+    if (year < 0 || year > 9999)
+    {
+        return UNDATED_PARTITION;
+    }
+
+    char key[8];
+    if (scheme == PartitionScheme::MONTH)
+    {
+        std::snprintf(key, sizeof(key), "%04d-%02d", year, month);
+    }
+    else
+    {
+        std::snprintf(key, sizeof(key), "%04d", year);
+    }
+    return key;
+}
+
+bool loadPartitionCatalog(const std::string &dataPath, PartitionCatalog &catalog)
+{
+    catalog = PartitionCatalog();
+    std::ifstream file(partitionCatalogPathFor(dataPath));
+    std::string magic;
+    std::string schemeName;
+    int version = 0;
+    if (!(file >> magic >> version >> schemeName) || magic != PARTITION_CATALOG_MAGIC ||
+        version != PARTITION_CATALOG_VERSION || !parseScheme(schemeName, catalog.scheme))
+    {
+        catalog = PartitionCatalog();
+        return false;
+    }
+
+    std::string kind;
+    while (file >> kind)
+    {
+        Partition partition;
+        if (kind != "partition" ||
+            !(file >> partition.key >> partition.rows >> partition.firstDay >> partition.lastDay >>
+              partition.version.size >> partition.version.modifiedNs) ||
+            (!catalog.partitions.empty() && catalog.partitions.back().key >= partition.key))
+        {
+            catalog = PartitionCatalog();
+            return false;
+        }
+        catalog.partitions.push_back(partition);
+    }
+    return true;
+}
+
+bool savePartitionCatalog(const std::string &dataPath, const PartitionCatalog &catalog)
+{
+    BufferedWriter file;
+    if (!file.open(partitionCatalogPathFor(dataPath)))
+    {
+        return false;
+    }
+    file.write(PARTITION_CATALOG_MAGIC);
+    file.put(' ');
+    file.writeInt(PARTITION_CATALOG_VERSION);
+    file.put(' ');
+    file.write(partitionSchemeName(catalog.scheme));
+    file.put('\n');
+    for (const Partition &partition : catalog.partitions)
+    {
+        file.write("partition ");
+        file.write(partition.key);
+        file.put(' ');
+        file.writeInt(static_cast<long long>(partition.rows));
+        file.put(' ');
+        file.writeInt(partition.firstDay);
+        file.put(' ');
+        file.writeInt(partition.lastDay);
+        file.put(' ');
+        file.writeInt(static_cast<long long>(partition.version.size));
+        file.put(' ');
+        file.writeInt(static_cast<long long>(partition.version.modifiedNs));
+        file.put('\n');
+    }
+    return file.close();
+}
+
+void recordPartition(const std::string &dataPath, PartitionCatalog &catalog, const std::string &key,
+                     uint64_t rows, int32_t firstDay, int32_t lastDay)
+{
+    auto position = std::lower_bound(catalog.partitions.begin(), catalog.partitions.end(), key, keyBefore);
+    if (position == catalog.partitions.end() || position->key != key)
+    {
+        Partition added;
+        added.key = key;
+        position = catalog.partitions.insert(position, added);
+    }
+    position->rows = rows;
+    position->firstDay = firstDay;
+    position->lastDay = lastDay;
+    if (!getFileInfo(partitionPathFor(dataPath, key), position->version))
+    {
+        position->version = FileInfo();
+    }
+}
+
+bool recordJournaledRow(PartitionCatalog &catalog, const std::string &key, int32_t firstDay, int32_t lastDay)
+{
+    auto position = std::lower_bound(catalog.partitions.begin(), catalog.partitions.end(), key, keyBefore);
+    if (position == catalog.partitions.end() || position->key != key)
+    {
+        return false;
+    }
+    ++position->rows;
+    position->firstDay = std::min(position->firstDay, firstDay);
+    position->lastDay = std::max(position->lastDay, lastDay);
+    return true;
+}
+
+std::vector<size_t> partitionsOverlapping(const std::string &dataPath, const PartitionCatalog &catalog,
+                                          int32_t firstDay, int32_t lastDay)
+{
+    std::vector<size_t> overlapping;
+    for (size_t i = 0; i < catalog.partitions.size(); ++i)
+    {
+        const Partition &partition = catalog.partitions[i];
+        int32_t partitionFirst = partition.firstDay;
+        int32_t partitionLast = partition.lastDay;
+
+        FileInfo current;
+        if (!getFileInfo(partitionPathFor(dataPath, partition.key), current))
+        {
+            continue; // Nothing to read
+        }
+        if (current.size != partition.version.size || current.modifiedNs != partition.version.modifiedNs)
+        {
+            periodOf(partition.key, partitionFirst, partitionLast);
+        }
+
+        if (partitionFirst <= lastDay && partitionLast >= firstDay)
+        {
+            overlapping.push_back(i);
+        }
+    }
+    return overlapping;
+}
+
+uint64_t partitionedRowCount(const PartitionCatalog &catalog)
+{
+    uint64_t rows = 0;
+    for (const Partition &partition : catalog.partitions)
+    {
+        rows += partition.rows;
+    }
+    return rows;
+}
+
+void removePartition(const std::string &dataPath, const std::string &key)
+{
+    std::string path = partitionPathFor(dataPath, key);
+    std::remove(path.c_str());
+    std::remove(blockChecksumPathFor(path).c_str());
+    std::remove(journalPathFor(path).c_str());
+}
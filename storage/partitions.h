@@ -0,0 +1,98 @@
+#ifndef PARTITIONS_H
+#define PARTITIONS_H
+
+#include "date.h"
+#include "file_info.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Activities stored as one CSV file per year or per month instead of a
+// single data file. Partition <key> lives in <file>.<key>, where the key is
+// "2024" or "2024-03" and rows whose date does not parse go to
+// <file>.undated. The partitions are listed in <file>.catalog:
+//
+//   tracker-partitions 1 <year|month>
+//   partition <key> <rows> <first day> <last day> <size> <mtime>
+//
+// one line per partition in key order, with the day numbers (see
+// calendar.h) of its earliest and latest row and the size and mtime of the
+// partition file they were recorded for. Queries bounded by date read only
+// the partitions whose days overlap their range. Like the ID index, the
+// recorded days describe one version of the file: once a partition file no
+// longer matches, the whole year or month of its key is assumed instead.
+//
+// Rows added since a partition was last written are appended to its
+// journal, <file>.<key>.journal (see journal.h), and loaders replay it after
+// the partition. The catalog counts them and its days include theirs; the
+// recorded version stays that of the partition file, which they leave as it
+// is. Rewriting a partition folds its journal into it.
+//
+// The catalog decides the layout: while it exists the single data file is
+// not read. It is replaced after the partitions it lists are written, so a
+// save that stops part way leaves every row readable.
+const int PARTITION_CATALOG_VERSION = 1;
+
+enum class PartitionScheme
+{
+    NONE, // One data file
+    YEAR,
+    MONTH
+};
+
+// Key of the partition for rows without a valid date
+const char UNDATED_PARTITION[] = "undated";
+
+struct Partition
+{
+    std::string key;
+    uint64_t rows = 0;
+    int32_t firstDay = std::numeric_limits<int32_t>::min();
+    int32_t lastDay = std::numeric_limits<int32_t>::max();
+    FileInfo version; // Partition file the rows and days were recorded for
+};
+
+struct PartitionCatalog
+{
+    PartitionScheme scheme = PartitionScheme::NONE;
+    std::vector<Partition> partitions; // In key order
+};
+
+std::string partitionCatalogPathFor(const std::string &dataPath);
+std::string partitionPathFor(const std::string &dataPath, const std::string &key);
+
+// "year" or "month"; "single file" for NONE
+const char *partitionSchemeName(PartitionScheme scheme);
+
+// Key of the partition a row dated `date` belongs to
+std::string partitionKeyFor(PartitionScheme scheme, Date date);
+
+// False if there is no catalog, i.e. the data is in the single file
+bool loadPartitionCatalog(const std::string &dataPath, PartitionCatalog &catalog);
+bool savePartitionCatalog(const std::string &dataPath, const PartitionCatalog &catalog);
+
+// Update the catalog entry of a partition file that was just written,
+// adding it if the key is new
+void recordPartition(const std::string &dataPath, PartitionCatalog &catalog, const std::string &key,
+                     uint64_t rows, int32_t firstDay, int32_t lastDay);
+
+// Count a row dated firstDay to lastDay (both the day, or the whole range
+// for an undated row) in the catalog entry of a partition after it was
+// appended to the partition's journal. Returns false if the key is not in
+// the catalog.
+bool recordJournaledRow(PartitionCatalog &catalog, const std::string &key, int32_t firstDay, int32_t lastDay);
+
+// Positions in catalog.partitions of the partitions that can hold rows
+// dated firstDay to lastDay, both included
+std::vector<size_t> partitionsOverlapping(const std::string &dataPath, const PartitionCatalog &catalog,
+                                          int32_t firstDay, int32_t lastDay);
+
+// Rows in every partition, as recorded
+uint64_t partitionedRowCount(const PartitionCatalog &catalog);
+
+// Delete a partition file, its checksums and its journal
+void removePartition(const std::string &dataPath, const std::string &key);
+
+#endif // PARTITIONS_H
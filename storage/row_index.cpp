@@ -0,0 +1,112 @@
+#include "row_index.h"
+#include "buffered_writer.h"
+#include "file_info.h"
+#include <cstring>
+
+namespace
+{
+    const char ROW_INDEX_MAGIC[4] = {'T', 'R', 'K', 'I'};
+
+    struct RowIndexHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t rowCount;
+        uint64_t sourceSize;
+        int64_t sourceModifiedNs;
+    };
+}
+
+std::string rowIndexPathFor(const std::string &dataPath)
+{
+    return dataPath + ".idx";
+}
+
+void collectRowOffsets(const char *begin, const char *end, const CsvDialect &dialect,
+                       std::vector<uint64_t> &offsets)
+{
+    offsets.clear();
+    forEachLine(firstDataRow(begin, end, dialect), end, [&](const char *lineBegin, const char *lineEnd)
+    {
+        ActivityRow row;
+        if (parseActivityRow(lineBegin, lineEnd, dialect, row) == RowStatus::OK)
+        {
+            offsets.push_back(static_cast<uint64_t>(lineBegin - begin));
+        }
+    });
+}
+
+bool saveRowIndex(const std::string &dataPath, const std::vector<uint64_t> &offsets)
+{
+    FileInfo dataInfo;
+    return getFileInfo(dataPath, dataInfo) && saveRowIndex(dataPath, dataInfo, offsets);
+}
+
+bool saveRowIndex(const std::string &dataPath, const FileInfo &dataInfo, const std::vector<uint64_t> &offsets)
+{
+    RowIndexHeader header;
+    std::memcpy(header.magic, ROW_INDEX_MAGIC, sizeof(header.magic));
+    header.version = ROW_INDEX_VERSION;
+    header.rowCount = offsets.size();
+    header.sourceSize = dataInfo.size;
+    header.sourceModifiedNs = dataInfo.modifiedNs;
+
+    BufferedWriter outFile;
+    if (!outFile.open(rowIndexPathFor(dataPath)))
+    {
+        return false;
+    }
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    return outFile.close();
+}
+
+RowIndex::RowIndex()
+    : offsets(nullptr), rows(0)
+{
+}
+
+bool RowIndex::open(const std::string &dataPath, const FileInfo &dataInfo)
+{
+    RowIndexHeader header;
+    if (!file.open(rowIndexPathFor(dataPath)) || file.size() < sizeof(header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, file.begin(), sizeof(header));
+    if (std::memcmp(header.magic, ROW_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ROW_INDEX_VERSION ||
+        header.sourceSize != dataInfo.size || header.sourceModifiedNs != dataInfo.modifiedNs ||
+        file.size() - sizeof(header) != header.rowCount * sizeof(uint64_t))
+    {
+        file.close();
+        return false;
+    }
+
+    offsets = file.begin() + sizeof(header);
+    rows = header.rowCount;
+    return true;
+}
+
+uint64_t RowIndex::offset(uint64_t id) const
+{
+    uint64_t value;
+    std::memcpy(&value, offsets + id * sizeof(uint64_t), sizeof(value));
+    return value;
+}
+
+void lineAt(const char *begin, const char *end, uint64_t offset,
+            const char *&lineBegin, const char *&lineEnd)
+{
+    lineBegin = begin + offset;
+    lineEnd = static_cast<const char *>(std::memchr(lineBegin, '\n', static_cast<size_t>(end - lineBegin)));
+    if (!lineEnd)
+    {
+        lineEnd = end;
+    }
+    if (lineEnd > lineBegin && *(lineEnd - 1) == '\r')
+    {
+        --lineEnd;
+    }
+}
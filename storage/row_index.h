@@ -0,0 +1,67 @@
+#ifndef ROW_INDEX_H
+#define ROW_INDEX_H
+
+#include "activity_csv.h"
+#include "file_info.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Activity IDs: activities are never deleted, and compaction appends the
+// journal to the data file in order, so the position of an activity among
+// the valid rows of the data file followed by its journal is assigned once,
+// grows monotonically and never changes. That position is its ID.
+//
+// ID-to-offset index of a data file, stored as <file>.idx:
+//
+//   header   magic "TRKI", version, row count, size and mtime of the file
+//   offsets  one uint64_t byte offset per valid row, in ID order
+//
+// Like the snapshot it is a cache: it is only used while the size and
+// modification time still match, and is rebuilt otherwise.
+const uint32_t ROW_INDEX_VERSION = 1;
+
+std::string rowIndexPathFor(const std::string &dataPath);
+
+// Offsets of the valid rows in [begin, end), as loaders would count them
+void collectRowOffsets(const char *begin, const char *end, const CsvDialect &dialect,
+                       std::vector<uint64_t> &offsets);
+
+// Write offsets as the index of dataPath, which must already be written
+bool saveRowIndex(const std::string &dataPath, const std::vector<uint64_t> &offsets);
+
+// Same, for the version of dataPath described by dataInfo
+bool saveRowIndex(const std::string &dataPath, const FileInfo &dataInfo, const std::vector<uint64_t> &offsets);
+
+// A mapped index; lookups touch one entry, however many rows there are
+class RowIndex
+{
+public:
+    RowIndex();
+
+    // Map the index of the version of dataPath described by dataInfo, as
+    // mapped by the caller; false if it is missing, damaged or describes
+    // another version
+    bool open(const std::string &dataPath, const FileInfo &dataInfo);
+
+    uint64_t rowCount() const { return rows; }
+
+    // Byte offset of row id, which must be below rowCount()
+    uint64_t offset(uint64_t id) const;
+
+private:
+    MappedFile file;
+    const char *offsets;
+    uint64_t rows;
+
+    RowIndex(const RowIndex &) = delete;
+    RowIndex &operator=(const RowIndex &) = delete;
+};
+
+// Row starting at offset in [begin, end), without its line terminator
+void lineAt(const char *begin, const char *end, uint64_t offset,
+            const char *&lineBegin, const char *&lineEnd);
+
+#endif // ROW_INDEX_H
@@ -0,0 +1,382 @@
+#include "snapshot.h"
+#include "file_info.h"
+#include "io_stats.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const char SNAPSHOT_MAGIC[4] = {'T', 'R', 'K', 'S'};
+
+    struct SnapshotHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t rowCount;
+        uint64_t sourceSize;
+        int64_t sourceModifiedNs;
+        uint32_t blockRows;
+        uint32_t reserved;
+    };
+
+    // Bytes of one row across the columns, not counting block headers
+    const size_t SNAPSHOT_BYTES_PER_ROW = sizeof(uint8_t) + 4 * sizeof(int32_t);
+
+    struct BlockHeader
+    {
+        uint32_t rows;
+        uint32_t reserved;
+    };
+
+    bool readHeader(const MappedFile &file, SnapshotHeader &header)
+    {
+        if (file.size() < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, file.begin(), sizeof(header));
+        return std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+               header.version == SNAPSHOT_VERSION && header.blockRows > 0;
+    }
+
+    uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count());
+    }
+
+    void fillHeader(SnapshotHeader &header, uint64_t rowCount, const FileInfo &source)
+    {
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.rowCount = rowCount;
+        header.sourceSize = source.size;
+        header.sourceModifiedNs = source.modifiedNs;
+        header.blockRows = SNAPSHOT_BLOCK_ROWS;
+        header.reserved = 0;
+    }
+
+    template <typename T>
+    void writeColumn(std::ofstream &outFile, const std::vector<T> &column, size_t first, size_t rows)
+    {
+        outFile.write(reinterpret_cast<const char *>(&column[first]), static_cast<std::streamsize>(rows * sizeof(T)));
+    }
+
+    // Write rows [first, first + rows) of columns as one block
+    void writeBlock(std::ofstream &outFile, const ActivityColumns &columns, size_t first, size_t rows)
+    {
+        BlockHeader block;
+        block.rows = static_cast<uint32_t>(rows);
+        block.reserved = 0;
+        outFile.write(reinterpret_cast<const char *>(&block), sizeof(block));
+
+        writeColumn(outFile, columns.type, first, rows);
+        writeColumn(outFile, columns.day, first, rows);
+        writeColumn(outFile, columns.duration, first, rows);
+        writeColumn(outFile, columns.distance, first, rows);
+        writeColumn(outFile, columns.repetitions, first, rows);
+    }
+
+    // Append `rows` values from the cursor to a column, checking bounds
+    template <typename T>
+    bool readColumn(const char *&cursor, const char *end, std::vector<T> &column, size_t rows)
+    {
+        size_t bytes = rows * sizeof(T);
+        if (static_cast<size_t>(end - cursor) < bytes)
+        {
+            return false;
+        }
+        size_t offset = column.size();
+        column.resize(offset + rows);
+        std::memcpy(&column[offset], cursor, bytes);
+        cursor += bytes;
+        return true;
+    }
+
+    // Append the block at the cursor to columns and move past it
+    bool readBlock(const char *&cursor, const char *end, uint32_t maxRows, ActivityColumns &columns)
+    {
+        BlockHeader block;
+        if (static_cast<size_t>(end - cursor) < sizeof(block))
+        {
+            return false;
+        }
+        std::memcpy(&block, cursor, sizeof(block));
+        cursor += sizeof(block);
+
+        return block.rows <= maxRows &&
+               readColumn(cursor, end, columns.type, block.rows) &&
+               readColumn(cursor, end, columns.day, block.rows) &&
+               readColumn(cursor, end, columns.duration, block.rows) &&
+               readColumn(cursor, end, columns.distance, block.rows) &&
+               readColumn(cursor, end, columns.repetitions, block.rows);
+    }
+}
+
+void ActivityColumns::clear()
+{
+    type.clear();
+    day.clear();
+    duration.clear();
+    distance.clear();
+    repetitions.clear();
+}
+
+void ActivityColumns::reserve(size_t rows)
+{
+    type.reserve(rows);
+    day.reserve(rows);
+    duration.reserve(rows);
+    distance.reserve(rows);
+    repetitions.reserve(rows);
+}
+
+std::string snapshotPathFor(const std::string &csvPath)
+{
+    return csvPath + ".snap";
+}
+
+// Compare the CSV file with the size and mtime recorded at snapshot time
+bool isSnapshotFresh(const std::string &snapshotPath, const std::string &csvPath)
+{
+    FileInfo csvInfo;
+    if (!getFileInfo(csvPath, csvInfo))
+    {
+        return false;
+    }
+
+    std::ifstream inFile(snapshotPath, std::ios::binary);
+    SnapshotHeader header;
+    if (!inFile.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return false;
+    }
+
+    return std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+           header.version == SNAPSHOT_VERSION &&
+           header.sourceSize == csvInfo.size &&
+           header.sourceModifiedNs == csvInfo.modifiedNs;
+}
+
+// Write header and blocks to a temporary file, then move it into place
+bool writeActivitySnapshot(const std::string &snapshotPath, const std::string &csvPath,
+                           const ActivityColumns &columns)
+{
+    FileInfo csvInfo;
+    return getFileInfo(csvPath, csvInfo) && writeActivitySnapshot(snapshotPath, csvInfo, columns);
+}
+
+bool writeActivitySnapshot(const std::string &snapshotPath, const FileInfo &csvInfo,
+                           const ActivityColumns &columns)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string tempPath = snapshotPath + ".tmp";
+    std::ofstream outFile(tempPath, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+
+    SnapshotHeader header;
+    fillHeader(header, columns.size(), csvInfo);
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (size_t first = 0; first < columns.size(); first += SNAPSHOT_BLOCK_ROWS)
+    {
+        writeBlock(outFile, columns, first, std::min<size_t>(SNAPSHOT_BLOCK_ROWS, columns.size() - first));
+    }
+
+    recordBytesWritten(static_cast<uint64_t>(outFile.tellp()));
+    outFile.close();
+    recordWriteTime(nanosecondsSince(start));
+    if (!outFile)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    return std::rename(tempPath.c_str(), snapshotPath.c_str()) == 0;
+}
+
+// Map the snapshot and copy each block's columns out in one pass
+bool readActivitySnapshot(const std::string &snapshotPath, ActivityColumns &columns)
+{
+    columns.clear();
+
+    MappedFile inFile;
+    SnapshotHeader header;
+    if (!inFile.open(snapshotPath) || !readHeader(inFile, header))
+    {
+        return false;
+    }
+
+    // A row count the file is too small to hold is damage, not a reason to
+    // reserve; every row takes at least its column values
+    if (header.rowCount > (inFile.size() - sizeof(header)) / SNAPSHOT_BYTES_PER_ROW)
+    {
+        return false;
+    }
+    columns.reserve(static_cast<size_t>(header.rowCount));
+    const char *cursor = inFile.begin() + sizeof(header);
+    const char *end = inFile.end();
+
+    while (cursor < end)
+    {
+        if (!readBlock(cursor, end, header.blockRows, columns))
+        {
+            columns.clear();
+            return false;
+        }
+    }
+
+    if (columns.size() != header.rowCount)
+    {
+        columns.clear();
+        return false;
+    }
+    return true;
+}
+
+bool hasSnapshotMagic(const char *begin, const char *end)
+{
+    return static_cast<size_t>(end - begin) >= sizeof(SNAPSHOT_MAGIC) &&
+           std::memcmp(begin, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+SnapshotWriter::SnapshotWriter() : rows(0)
+{
+}
+
+// An unfinished snapshot is never left behind under its real name
+SnapshotWriter::~SnapshotWriter()
+{
+    if (outFile.is_open())
+    {
+        outFile.close();
+        std::remove(tempPath.c_str());
+    }
+}
+
+bool SnapshotWriter::open(const std::string &snapshotPath, const FileInfo &source)
+{
+    path = snapshotPath;
+    tempPath = snapshotPath + ".tmp";
+    sourceInfo = source;
+    rows = 0;
+    block.clear();
+    block.reserve(SNAPSHOT_BLOCK_ROWS);
+
+    outFile.open(tempPath, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+
+    // The row count is patched in by close()
+    SnapshotHeader header;
+    fillHeader(header, 0, sourceInfo);
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    return static_cast<bool>(outFile);
+}
+
+bool SnapshotWriter::append(int type, int32_t day, double duration, double distance, int repetitions)
+{
+    if (type < 0 || type > 255 || !isWholeUnits(duration, DURATION_DECIMALS) ||
+        !isWholeUnits(distance, DISTANCE_DECIMALS))
+    {
+        return false;
+    }
+    block.type.push_back(static_cast<uint8_t>(type));
+    block.day.push_back(day);
+    block.duration.push_back(toCentiminutes(duration));
+    block.distance.push_back(toMetres(distance));
+    block.repetitions.push_back(repetitions);
+    ++rows;
+
+    return block.size() < SNAPSHOT_BLOCK_ROWS || flushBlock();
+}
+
+bool SnapshotWriter::flushBlock()
+{
+    if (block.size() > 0)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        writeBlock(outFile, block, 0, block.size());
+        block.clear();
+        recordWriteTime(nanosecondsSince(start));
+    }
+    return static_cast<bool>(outFile);
+}
+
+bool SnapshotWriter::close()
+{
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+
+    bool ok = flushBlock();
+    SnapshotHeader header;
+    fillHeader(header, rows, sourceInfo);
+    outFile.seekp(0);
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    outFile.seekp(0, std::ios::end);
+
+    recordBytesWritten(static_cast<uint64_t>(outFile.tellp()));
+    outFile.close();
+    if (!ok || !outFile)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+SnapshotReader::SnapshotReader()
+    : cursor(nullptr), expectedRows(0), rowsRead(0), blockRows(0), damaged(false)
+{
+}
+
+bool SnapshotReader::open(const std::string &snapshotPath)
+{
+    SnapshotHeader header;
+    if (!file.open(snapshotPath) || !readHeader(file, header))
+    {
+        damaged = true;
+        return false;
+    }
+    cursor = file.begin() + sizeof(header);
+    expectedRows = header.rowCount;
+    blockRows = header.blockRows;
+    rowsRead = 0;
+    damaged = false;
+    return true;
+}
+
+bool SnapshotReader::nextBlock(ActivityColumns &block)
+{
+    block.clear();
+    if (damaged || cursor == nullptr || cursor >= file.end())
+    {
+        return false;
+    }
+
+    if (!readBlock(cursor, file.end(), blockRows, block))
+    {
+        damaged = true;
+        block.clear();
+        return false;
+    }
+    rowsRead += block.size();
+    return true;
+}
+
+bool SnapshotReader::complete() const
+{
+    return !damaged && cursor == file.end() && rowsRead == expectedRows;
+}
@@ -0,0 +1,201 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "date.h"
+#include "file_info.h"
+#include "fixed_point.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Activities laid out column by column, as they are stored in a snapshot
+struct ActivityColumns
+{
+    std::vector<uint8_t> type;
+    std::vector<int32_t> day;      // Day number, see calendar.h
+    std::vector<int32_t> duration; // Centiminutes, see fixed_point.h
+    std::vector<int32_t> distance; // Metres
+    std::vector<int32_t> repetitions;
+
+    size_t size() const { return type.size(); }
+    void clear();
+    void reserve(size_t rows);
+};
+
+// Binary snapshot of an activities CSV file, stored as <csv>.snap:
+//
+//   header  magic "TRKS", version, row count, size and mtime of the CSV
+//   blocks  up to SNAPSHOT_BLOCK_ROWS rows each, with one array per column
+//           (type, day, duration, distance, repetitions)
+//
+// Values are stored in native byte order; a snapshot is a cache of the CSV
+// on the same machine, not an interchange format.
+const uint32_t SNAPSHOT_VERSION = 2; // 2: durations and distances as int32_t units
+const uint32_t SNAPSHOT_BLOCK_ROWS = 65536;
+
+std::string snapshotPathFor(const std::string &csvPath);
+
+// True if the snapshot was written from the CSV file as it is now
+bool isSnapshotFresh(const std::string &snapshotPath, const std::string &csvPath);
+
+// Write columns as a snapshot of csvPath (via a temporary file and rename)
+bool writeActivitySnapshot(const std::string &snapshotPath, const std::string &csvPath,
+                           const ActivityColumns &columns);
+
+// Same, for the version of the CSV described by csvInfo, e.g. one that was
+// read before a newer version replaced it
+bool writeActivitySnapshot(const std::string &snapshotPath, const FileInfo &csvInfo,
+                           const ActivityColumns &columns);
+
+// Read a whole snapshot; returns false if it is missing or damaged
+bool readActivitySnapshot(const std::string &snapshotPath, ActivityColumns &columns);
+
+// True if [begin, end) starts like a snapshot file
+bool hasSnapshotMagic(const char *begin, const char *end);
+
+// Writes a snapshot one block at a time, so a file of any size needs only a
+// block of memory. Rows go to a temporary file that close() moves into place.
+class SnapshotWriter
+{
+public:
+    SnapshotWriter();
+    ~SnapshotWriter();
+
+    // Start a snapshot; source is the CSV it will stand for (zero if none)
+    bool open(const std::string &snapshotPath, const FileInfo &source);
+
+    // Buffer one row, writing the block out when it is full. Fails for a
+    // duration or distance that is not a whole number of units.
+    bool append(int type, int32_t day, double duration, double distance, int repetitions);
+
+    // Write the last block and the final row count, then rename into place
+    bool close();
+
+    uint64_t rowCount() const { return rows; }
+
+private:
+    std::string path;
+    std::string tempPath;
+    std::ofstream outFile;
+    FileInfo sourceInfo;
+    ActivityColumns block;
+    uint64_t rows;
+
+    bool flushBlock();
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+};
+
+// Reads a snapshot one block at a time through a mapping, so a file of any
+// size is decoded with a block of memory
+class SnapshotReader
+{
+public:
+    SnapshotReader();
+
+    // Map the snapshot and check its header
+    bool open(const std::string &snapshotPath);
+
+    // Replace block with the next block's rows; false at the end or on damage
+    bool nextBlock(ActivityColumns &block);
+
+    // True once every block was read and the row count matched the header
+    bool complete() const;
+
+    uint64_t rowCount() const { return expectedRows; }
+
+private:
+    MappedFile file;
+    const char *cursor;
+    uint64_t expectedRows;
+    uint64_t rowsRead;
+    uint32_t blockRows;
+    bool damaged;
+
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+};
+
+// Convert a vector of any Activity-like record (type, Date, duration,
+// distance, repetitions) to columns. Fails if a date is invalid, a type
+// does not fit or a value is not a whole number of units, since the
+// snapshot could not reproduce that row.
+template <typename ActivityVector>
+bool activitiesToColumns(const ActivityVector &activities, ActivityColumns &columns)
+{
+    columns.clear();
+    columns.reserve(activities.size());
+    for (const auto &activity : activities)
+    {
+        int type = static_cast<int>(activity.type);
+        if (type < 0 || type > 255 || !activity.date.isValid() ||
+            !isWholeUnits(activity.duration, DURATION_DECIMALS) || !isWholeUnits(activity.distance, DISTANCE_DECIMALS))
+        {
+            return false;
+        }
+        columns.type.push_back(static_cast<uint8_t>(type));
+        columns.day.push_back(activity.date.dayNumber());
+        columns.duration.push_back(toCentiminutes(activity.duration));
+        columns.distance.push_back(toMetres(activity.distance));
+        columns.repetitions.push_back(activity.repetitions);
+    }
+    return true;
+}
+
+// Rebuild records from columns
+template <typename ActivityVector>
+void columnsToActivities(const ActivityColumns &columns, ActivityVector &activities)
+{
+    typedef typename ActivityVector::value_type Record;
+
+    activities.clear();
+    activities.reserve(columns.size());
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        Record activity;
+        activity.type = static_cast<decltype(activity.type)>(columns.type[i]);
+        activity.date = Date(columns.day[i]);
+        activity.duration = minutesFrom(columns.duration[i]);
+        activity.distance = kilometresFrom(columns.distance[i]);
+        activity.repetitions = columns.repetitions[i];
+        activities.push_back(std::move(activity));
+    }
+}
+
+// Load activities from the snapshot of csvPath if it is up to date
+template <typename ActivityVector>
+bool loadActivitySnapshot(const std::string &csvPath, ActivityVector &activities)
+{
+    std::string snapshotPath = snapshotPathFor(csvPath);
+    ActivityColumns columns;
+    if (!isSnapshotFresh(snapshotPath, csvPath) || !readActivitySnapshot(snapshotPath, columns))
+    {
+        return false;
+    }
+    columnsToActivities(columns, activities);
+    return true;
+}
+
+// Record activities as the snapshot of csvPath, which must already be written
+template <typename ActivityVector>
+bool saveActivitySnapshot(const std::string &csvPath, const ActivityVector &activities)
+{
+    ActivityColumns columns;
+    return activitiesToColumns(activities, columns) &&
+           writeActivitySnapshot(snapshotPathFor(csvPath), csvPath, columns);
+}
+
+// Record activities as the snapshot of the version of csvPath in csvInfo
+template <typename ActivityVector>
+bool saveActivitySnapshot(const std::string &csvPath, const FileInfo &csvInfo, const ActivityVector &activities)
+{
+    ActivityColumns columns;
+    return activitiesToColumns(activities, columns) &&
+           writeActivitySnapshot(snapshotPathFor(csvPath), csvInfo, columns);
+}
+
+#endif // SNAPSHOT_H
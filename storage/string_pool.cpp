@@ -0,0 +1,139 @@
+#include "string_pool.h"
+#include "checksum.h"
+#include <algorithm>
+#include <ostream>
+
+namespace
+{
+    const size_t FIRST_BLOCK_BYTES = 4096;
+    const size_t MAX_BLOCK_BYTES = 1 << 20;
+    const size_t FIRST_TABLE_SLOTS = 64;
+    const size_t MAX_INTERNED_LENGTH = UINT32_MAX;
+}
+
+std::ostream &operator<<(std::ostream &out, PooledString text)
+{
+    std::streamsize length = static_cast<std::streamsize>(text.size());
+    std::streamsize padding = out.width() > length ? out.width() - length : 0;
+    bool padRight = (out.flags() & std::ios_base::adjustfield) == std::ios_base::left;
+    out.width(0);
+    if (!padRight)
+    {
+        for (std::streamsize i = 0; i < padding; ++i)
+        {
+            out.put(out.fill());
+        }
+    }
+    out.write(text.data(), length);
+    if (padRight)
+    {
+        for (std::streamsize i = 0; i < padding; ++i)
+        {
+            out.put(out.fill());
+        }
+    }
+    return out;
+}
+
+StringPool::StringPool()
+    : next(nullptr), left(0), blockBytes(FIRST_BLOCK_BYTES), allocated(0), count(0)
+{
+}
+
+PooledString StringPool::intern(const char *text, size_t length)
+{
+    if (length == 0)
+    {
+        return PooledString();
+    }
+    if (length > MAX_INTERNED_LENGTH)
+    {
+        return PooledString(copy(text, length), length);
+    }
+    if ((count + 1) * 2 > slots.size())
+    {
+        growTable();
+    }
+
+    // Linear probing from the CRC of the text
+    uint32_t hash = crc32c(text, length);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        Slot &slot = slots[i];
+        if (slot.text == nullptr)
+        {
+            slot.text = copy(text, length);
+            slot.length = static_cast<uint32_t>(length);
+            slot.hash = hash;
+            ++count;
+            return PooledString(slot.text, length);
+        }
+        if (slot.hash == hash && slot.length == length && std::memcmp(slot.text, text, length) == 0)
+        {
+            return PooledString(slot.text, length);
+        }
+    }
+}
+
+void StringPool::clear()
+{
+    blocks.clear();
+    next = nullptr;
+    left = 0;
+    blockBytes = FIRST_BLOCK_BYTES;
+    allocated = 0;
+    slots.clear();
+    count = 0;
+}
+
+// Bump-allocate room for text and copy it in. Blocks double in size up to
+// MAX_BLOCK_BYTES; a string too long for a block gets a block of its own.
+char *StringPool::copy(const char *text, size_t length)
+{
+    if (length > left)
+    {
+        size_t bytes = std::max(blockBytes, length);
+        blocks.emplace_back(new char[bytes]);
+        allocated += bytes;
+        if (bytes == blockBytes)
+        {
+            next = blocks.back().get();
+            left = bytes;
+            blockBytes = std::min(blockBytes * 2, MAX_BLOCK_BYTES);
+        }
+        else
+        {
+            std::memcpy(blocks.back().get(), text, length);
+            return blocks.back().get();
+        }
+    }
+    char *stored = next;
+    std::memcpy(stored, text, length);
+    next += length;
+    left -= length;
+    return stored;
+}
+
+// Double the table, re-placing every string by its stored hash
+void StringPool::growTable()
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+    Slot empty = {nullptr, 0, 0};
+    slots.assign(old.empty() ? FIRST_TABLE_SLOTS : old.size() * 2, empty);
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : old)
+    {
+        if (slot.text == nullptr)
+        {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].text != nullptr)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
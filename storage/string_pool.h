@@ -0,0 +1,85 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Text held by a StringPool: a pointer and a length into the pool's memory,
+// valid until the pool is cleared or destroyed. Copies share the text.
+class PooledString
+{
+public:
+    PooledString() : text(""), length(0) {}
+
+    const char *data() const { return text; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    std::string str() const { return std::string(text, length); }
+
+    friend bool operator==(PooledString a, PooledString b)
+    {
+        return a.length == b.length && std::memcmp(a.text, b.text, a.length) == 0;
+    }
+    friend bool operator!=(PooledString a, PooledString b) { return !(a == b); }
+
+private:
+    friend class StringPool;
+    PooledString(const char *text, size_t length) : text(text), length(length) {}
+
+    const char *text;
+    size_t length;
+};
+
+// Writes the text, honouring the stream's width and alignment
+std::ostream &operator<<(std::ostream &out, PooledString text);
+
+// Short strings that live as long as a collection, such as goal
+// descriptions. Text is copied into large blocks by bumping a pointer, so n
+// strings cost a few block allocations instead of n, and a string equal to
+// one already in the pool is not copied again: the pool hands back the
+// earlier copy.
+class StringPool
+{
+public:
+    StringPool();
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    // The pool's copy of text, added if it is not there yet
+    PooledString intern(const char *text, size_t length);
+    PooledString intern(const std::string &text) { return intern(text.data(), text.size()); }
+
+    // Drop every string; PooledStrings taken from the pool become invalid
+    void clear();
+
+    // Distinct strings held, and bytes of block memory allocated for them
+    size_t strings() const { return count; }
+    size_t bytesAllocated() const { return allocated; }
+
+private:
+    // One slot of the open-addressing table; text is null when empty
+    struct Slot
+    {
+        const char *text;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *next;          // Free space in the current block
+    size_t left;
+    size_t blockBytes;   // Size of the next block
+    size_t allocated;
+    std::vector<Slot> slots; // Power-of-two size, at most half full
+    size_t count;
+
+    char *copy(const char *text, size_t length);
+    void growTable();
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,112 @@
+#include "tombstones.h"
+#include "activity_csv.h"
+#include "buffered_writer.h"
+#include "field_parser.h"
+#include "file_lock.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "number_format.h"
+
+std::string tombstonePathFor(const std::string &dataPath)
+{
+    return dataPath + ".tombstones";
+}
+
+std::string nextIdPathFor(const std::string &dataPath)
+{
+    return dataPath + ".nextid";
+}
+
+int loadNextId(const std::string &dataPath)
+{
+    MappedFile file;
+    int nextId;
+    if (!file.open(nextIdPathFor(dataPath)))
+    {
+        return 0;
+    }
+    const char *end = completeLinesEnd(file.begin(), file.end());
+    if (end == file.begin() || parseInt(file.begin(), end - 1, nextId) != ParseStatus::OK || nextId < 0)
+    {
+        return 0;
+    }
+    return nextId;
+}
+
+// One short append, synced under the same group-commit policy as the journal
+bool appendTombstone(const std::string &tombstonePath, int id)
+{
+    char text[NUMBER_BUFFER_BYTES];
+    return appendJournalRecord(tombstonePath, std::string(text, formatInt(id, text)));
+}
+
+std::unordered_set<int> loadTombstones(const std::string &tombstonePath)
+{
+    std::unordered_set<int> ids;
+    MappedFile file;
+    if (!file.open(tombstonePath))
+    {
+        return ids;
+    }
+
+    forEachLine(file.begin(), completeLinesEnd(file.begin(), file.end()),
+                [&ids](const char *lineBegin, const char *lineEnd)
+    {
+        int id;
+        if (parseInt(lineBegin, lineEnd, id) == ParseStatus::OK)
+        {
+            ids.insert(id);
+        }
+    });
+    return ids;
+}
+
+bool isTombstoneCompactionDue(size_t deadRows, size_t totalRows)
+{
+    return deadRows > 0 && static_cast<double>(deadRows) > TOMBSTONE_COMPACT_FRACTION * static_cast<double>(totalRows);
+}
+
+// Same rules as the journal: the rewritten data file is committed first
+bool removeTombstones(const std::string &tombstonePath)
+{
+    return removeJournal(tombstonePath);
+}
+
+bool commitCompactedFile(const std::string &dataPath, BufferedWriter &out, size_t &deadRows, int nextId)
+{
+    // Saved before the swap: a crash in between leaves it above every ID
+    // of the old file, which is harmless
+    if (deadRows > 0 && nextId > loadNextId(dataPath))
+    {
+        BufferedWriter nextIdFile;
+        if (!nextIdFile.open(nextIdPathFor(dataPath)))
+        {
+            return false;
+        }
+        nextIdFile.writeInt(nextId);
+        nextIdFile.put('\n');
+        if (!nextIdFile.close())
+        {
+            return false;
+        }
+    }
+
+    FileLock publish;
+    if (deadRows > 0)
+    {
+        publish.lock(publishLockPathFor(dataPath), LockMode::EXCLUSIVE);
+    }
+    if (!out.close())
+    {
+        return false;
+    }
+    if (deadRows > 0)
+    {
+        if (!removeTombstones(tombstonePathFor(dataPath)))
+        {
+            return false;
+        }
+        deadRows = 0;
+    }
+    return true;
+}
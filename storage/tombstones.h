@@ -0,0 +1,85 @@
+#ifndef TOMBSTONES_H
+#define TOMBSTONES_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class BufferedWriter;
+
+// Deleted record IDs kept next to a data file as <file>.tombstones, one ID
+// per line. A delete appends one line instead of rewriting the data file;
+// the dead rows stay in the data file, are skipped by loaders, and are only
+// dropped when the file is compacted. Records keep their IDs throughout.
+
+// Compaction drops dead rows, and with them possibly the highest ID ever
+// handed out. So that it is not handed out again, one past it is kept in
+// <file>.nextid, which compaction writes and never lowers; loaders start
+// counting new IDs from the larger of it and the IDs still in the file.
+
+// Compact once dead rows make up more than this share of the data file
+const double TOMBSTONE_COMPACT_FRACTION = 0.25;
+
+std::string tombstonePathFor(const std::string &dataPath);
+
+std::string nextIdPathFor(const std::string &dataPath);
+
+// The next ID saved by the last compaction, or 0 if there is none
+int loadNextId(const std::string &dataPath);
+
+// Record one deleted ID
+bool appendTombstone(const std::string &tombstonePath, int id);
+
+// IDs recorded so far; a line torn by a crash is ignored
+std::unordered_set<int> loadTombstones(const std::string &tombstonePath);
+
+// True if deadRows of totalRows is enough to rewrite the data file
+bool isTombstoneCompactionDue(size_t deadRows, size_t totalRows);
+
+// Delete the tombstones once the data file has been rewritten without the
+// dead rows
+bool removeTombstones(const std::string &tombstonePath);
+
+// Rebuild the ID -> position lookup of records, which have an int id
+template <typename Record>
+void indexRecordIds(const std::vector<Record> &records, std::unordered_map<int, size_t> &positions)
+{
+    positions.clear();
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        positions[records[i].id] = i;
+    }
+}
+
+// Delete records[position] from the data file at dataPath: its tombstone is
+// appended, then it leaves records and positions and counts as one more
+// dead row. False, changing nothing, if the tombstone cannot be written.
+// compactionDue is set once the dead rows call for rewriting the file,
+// which the caller does and then commits with commitCompactedFile.
+template <typename Record>
+bool deleteRecordWithTombstone(const std::string &dataPath, std::vector<Record> &records,
+                               std::unordered_map<int, size_t> &positions, size_t position,
+                               size_t &deadRows, bool &compactionDue)
+{
+    if (!appendTombstone(tombstonePathFor(dataPath), records[position].id))
+    {
+        return false;
+    }
+    records.erase(records.begin() + static_cast<std::ptrdiff_t>(position));
+    indexRecordIds(records, positions);
+    ++deadRows;
+    compactionDue = isTombstoneCompactionDue(deadRows, records.size() + deadRows);
+    return true;
+}
+
+// Replace the data file with out, a rewrite holding only live records. With
+// dead rows nextId, one past the highest ID handed out, is saved first; the
+// swap happens under the publish lock and the tombstones go with the old
+// file, so readers never pair the new file with stale tombstones; deadRows
+// is then 0. False if nextId, out or the removal of the tombstones cannot
+// be committed.
+bool commitCompactedFile(const std::string &dataPath, BufferedWriter &out, size_t &deadRows, int nextId);
+
+#endif // TOMBSTONES_H
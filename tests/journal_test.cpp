@@ -0,0 +1,58 @@
+// Appending to a journal whose last record was torn by a crash
+#include "journal.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    std::string readFile(const std::string &path)
+    {
+        std::ifstream inFile(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << inFile.rdbuf();
+        return contents.str();
+    }
+
+    bool check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << what << std::endl;
+        }
+        return condition;
+    }
+}
+
+int main()
+{
+    const std::string journalPath = journalPathFor("journal_test_activities.csv");
+    std::remove(journalPath.c_str());
+    bool passed = true;
+
+    // A fresh journal
+    passed &= check(appendJournalRecord(journalPath, "0,2024-05-20,30,5,0"), "append to a new journal");
+    passed &= check(readFile(journalPath) == "0,2024-05-20,30,5,0\n", "new journal holds one record");
+
+    // A crash cut the second record short; the next append replaces it
+    {
+        std::ofstream torn(journalPath, std::ios::binary | std::ios::app);
+        torn << "1,2024-05-21,3";
+    }
+    passed &= check(appendJournalRecord(journalPath, "0,2024-05-22,15,2,0"), "append after a torn record");
+    passed &= check(readFile(journalPath) == "0,2024-05-20,30,5,0\n0,2024-05-22,15,2,0\n",
+                    "torn record is dropped and the new one is on its own line");
+
+    // A journal that is nothing but a torn record
+    {
+        std::ofstream torn(journalPath, std::ios::binary | std::ios::trunc);
+        torn << "1,2024";
+    }
+    passed &= check(appendJournalRecord(journalPath, "2,2024-05-23,45,1,0"), "append after a lone torn record");
+    passed &= check(readFile(journalPath) == "2,2024-05-23,45,1,0\n", "lone torn record is dropped");
+
+    std::remove(journalPath.c_str());
+    return passed ? 0 : 1;
+}
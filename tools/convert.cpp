@@ -0,0 +1,308 @@
+// Converts activity files between the integer-coded CSV written by app_1,
+// app_2 and sports_tracker_cpp, the name-coded CSV written by the PP
+// applications, the binary snapshot and the compressed store. The input
+// format is detected from its first bytes. Rows are streamed one at a time,
+// so memory use does not depend on the size of the file.
+//
+// Usage: ./tracker_convert <input> <output> <codes|names|snapshot|compressed>
+#include "activity_csv.h"
+#include "buffered_writer.h"
+#include "compressed_store.h"
+#include "file_info.h"
+#include "fixed_point.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    enum class Format
+    {
+        CODES,
+        NAMES,
+        SNAPSHOT,
+        COMPRESSED
+    };
+
+    struct Counts
+    {
+        uint64_t rows = 0;
+        uint64_t skipped = 0;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage:" << std::endl;
+        std::cout << "./tracker_convert <input> <output> <codes|names|snapshot|compressed>" << std::endl;
+        std::cout << "  codes     0,2024-05-20,... without a header (app_1, app_2, sports_tracker_cpp)" << std::endl;
+        std::cout << "  names     Running,2024-05-20,... with a header (PP applications)" << std::endl;
+        std::cout << "  snapshot    binary columnar snapshot (.snap)" << std::endl;
+        std::cout << "  compressed  compressed data file, read by every front end but sports_tracker_cpp" << std::endl;
+    }
+
+    bool parseFormat(const std::string &name, Format &format)
+    {
+        if (name == "codes")
+            format = Format::CODES;
+        else if (name == "names")
+            format = Format::NAMES;
+        else if (name == "snapshot")
+            format = Format::SNAPSHOT;
+        else if (name == "compressed")
+            format = Format::COMPRESSED;
+        else
+            return false;
+        return true;
+    }
+
+    // Destination for converted rows; CSV goes through a BufferedWriter,
+    // which replaces the output only once it is complete, snapshots through
+    // SnapshotWriter and compressed files through CompressedWriter
+    class RowSink
+    {
+    public:
+        RowSink(Format format, const std::string &path)
+            : format(format), path(path),
+              dialect(format == Format::NAMES ? NAME_DIALECT : CODE_DIALECT)
+        {
+        }
+
+        bool open()
+        {
+            if (format == Format::SNAPSHOT)
+            {
+                return snapshot.open(path, FileInfo());
+            }
+            if (format == Format::COMPRESSED)
+            {
+                return compressed.open(path);
+            }
+
+            if (!csv.open(path))
+            {
+                return false;
+            }
+            if (dialect.hasHeader)
+            {
+                csv.write(ACTIVITY_CSV_HEADER);
+                csv.put('\n');
+            }
+            return true;
+        }
+
+        // Returns false if the row cannot be represented in the output
+        // format
+        bool write(int type, Date date, double duration, double distance, int repetitions)
+        {
+            if (format == Format::SNAPSHOT)
+            {
+                return snapshot.append(type, date.dayNumber(), duration, distance, repetitions);
+            }
+            if (format == Format::COMPRESSED)
+            {
+                return compressed.append(type, date.dayNumber(), duration, distance, repetitions);
+            }
+            writeActivityRow(csv, dialect, type, date, duration, distance, repetitions);
+            csv.put('\n');
+            return true;
+        }
+
+        bool close()
+        {
+            if (format == Format::SNAPSHOT)
+            {
+                return snapshot.close();
+            }
+            if (format == Format::COMPRESSED)
+            {
+                return compressed.close();
+            }
+            return csv.close();
+        }
+
+        // Drop a partial output; the real output path is never touched
+        void discard()
+        {
+            if (format == Format::SNAPSHOT)
+            {
+                return; // SnapshotWriter removes its temporary file
+            }
+            if (format == Format::COMPRESSED)
+            {
+                return; // Its BufferedWriter drops the temporary file
+            }
+            csv.discard();
+        }
+
+    private:
+        Format format;
+        std::string path;
+        CsvDialect dialect;
+        BufferedWriter csv;
+        SnapshotWriter snapshot;
+        CompressedWriter compressed;
+    };
+
+    // Stream a CSV in either dialect into the sink
+    void convertCsv(const MappedFile &input, RowSink &sink, Counts &counts)
+    {
+        CsvDialect dialect = detectDialect(input.begin(), input.end(), CODE_DIALECT);
+        std::cerr << "Input: " << (dialect.typeEncoding == TypeEncoding::NAME ? "names" : "codes")
+                  << " CSV" << (dialect.hasHeader ? " with header" : "") << std::endl;
+
+        forEachActivityRow(input.begin(), input.end(), dialect, [&](const ActivityRow &row) -> bool
+        {
+            if (!sink.write(row.type, row.date, row.duration, row.distance, row.repetitions))
+            {
+                std::cerr << "Skipping row with date " << row.date << ": cannot be stored in this format" << std::endl;
+                ++counts.skipped;
+                return true;
+            }
+            ++counts.rows;
+            return true;
+        },
+        [&](const char *lineBegin, const char *lineEnd)
+        {
+            std::cerr << "Skipping malformed line: " << std::string(lineBegin, lineEnd) << std::endl;
+            ++counts.skipped;
+        });
+    }
+
+    // Stream a snapshot block by block into the sink
+    bool convertSnapshot(const std::string &inputPath, RowSink &sink, Counts &counts)
+    {
+        std::cerr << "Input: snapshot" << std::endl;
+
+        SnapshotReader reader;
+        if (!reader.open(inputPath))
+        {
+            return false;
+        }
+
+        ActivityColumns block;
+        while (reader.nextBlock(block))
+        {
+            for (size_t i = 0; i < block.size(); ++i)
+            {
+                sink.write(block.type[i], Date(block.day[i]),
+                           minutesFrom(block.duration[i]), kilometresFrom(block.distance[i]), block.repetitions[i]);
+                ++counts.rows;
+            }
+        }
+
+        if (!reader.complete())
+        {
+            std::cerr << "Error: " << inputPath << " is damaged." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Stream a compressed file block by block into the sink
+    bool convertCompressed(const std::string &inputPath, const MappedFile &input, RowSink &sink, Counts &counts)
+    {
+        std::cerr << "Input: compressed" << std::endl;
+
+        CompressedReader reader;
+        if (!reader.open(input.begin(), input.end()))
+        {
+            return false;
+        }
+
+        CompressedBlock block;
+        ActivityColumns columns;
+        while (reader.nextBlock(block))
+        {
+            if (!reader.readBlock(columns))
+            {
+                std::cerr << "Error: Block at row " << block.firstRow << " of " << inputPath << " is damaged." << std::endl;
+                return false;
+            }
+            for (size_t i = 0; i < columns.size(); ++i)
+            {
+                sink.write(columns.type[i], Date(columns.day[i]),
+                           minutesFrom(columns.duration[i]), kilometresFrom(columns.distance[i]), columns.repetitions[i]);
+                ++counts.rows;
+            }
+        }
+
+        if (!reader.complete())
+        {
+            std::cerr << "Error: " << inputPath << " is damaged." << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Format format;
+    if (argc != 4 || !parseFormat(argv[3], format))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+    if (inputPath == outputPath)
+    {
+        std::cerr << "Error: Input and output must be different files." << std::endl;
+        return 1;
+    }
+
+    MappedFile input;
+    if (!input.open(inputPath))
+    {
+        std::cerr << "Error: Could not open file " << inputPath << " for reading." << std::endl;
+        return 1;
+    }
+
+    RowSink sink(format, outputPath);
+    if (!sink.open())
+    {
+        std::cerr << "Error: Could not open file " << outputPath << " for writing." << std::endl;
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Counts counts;
+    bool converted = true;
+    if (hasSnapshotMagic(input.begin(), input.end()))
+    {
+        converted = convertSnapshot(inputPath, sink, counts);
+    }
+    else if (hasCompressedMagic(input.begin(), input.end()))
+    {
+        converted = convertCompressed(inputPath, input, sink, counts);
+    }
+    else
+    {
+        convertCsv(input, sink, counts);
+    }
+
+    if (!converted)
+    {
+        sink.discard();
+        std::cerr << "Error: Conversion to " << outputPath << " failed." << std::endl;
+        return 1;
+    }
+    if (!sink.close())
+    {
+        std::cerr << "Error: Conversion to " << outputPath << " failed." << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Converted " << counts.rows << " rows";
+    if (counts.skipped > 0)
+    {
+        std::cout << " (" << counts.skipped << " skipped)";
+    }
+    std::cout << " in " << seconds << " s" << std::endl;
+    return 0;
+}